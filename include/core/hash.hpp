@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+namespace marathon {
+
+/// NOTE: not cryptographic, only for content keys e.g. caches
+// 64-bit FNV-1a, pass a previous hash as the seed to hash multiple pieces of data
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = FNV_OFFSET_BASIS) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+inline uint64_t HashString(std::string_view str, uint64_t seed = FNV_OFFSET_BASIS) {
+    return HashBytes(str.data(), str.size(), seed);
+}
+
+} // marathon
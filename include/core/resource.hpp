@@ -3,17 +3,23 @@
 #include <string>
 
 #include "core/object.hpp"
+#include "core/slot_map.hpp"
 
 namespace marathon {
 
 struct Resource : public Object {
 private:
     std::string _mPath = "./";
+    // handle to renderer internal data, set by the renderer on first upload
+    Handle _mRendererHandle = Handle();
 
 public:
     Resource(const std::string& type);
     ~Resource() = default;
 
+    Handle GetRendererHandle() const;
+    void SetRendererHandle(Handle handle);
+
 };
 
 } // marathon
\ No newline at end of file
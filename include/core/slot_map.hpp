@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+namespace marathon {
+
+/// NOTE: handles are generational so a handle to a removed slot is detected as stale
+/// even after the slot has been reused by a new value
+// index 0 is never allocated so a default handle is always invalid
+struct Handle {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return index != 0; }
+    bool operator==(const Handle& other) const = default;
+};
+
+// values addressed by generational handles, stored in slots that may be left empty by removal
+// iteration with ForEach skips empty slots so values are not contiguous
+// insert, remove and lookup are all O(1)
+template <typename T>
+class SlotMap {
+private:
+    struct Slot {
+        T value = T();
+        uint32_t generation = 1;
+        bool occupied = false;
+    };
+
+    // slot 0 reserved as the invalid slot
+    std::vector<Slot> _slots = std::vector<Slot>(1);
+    std::vector<uint32_t> _freeSlots = {};
+    size_t _size = 0;
+
+public:
+    Handle Insert(T value) {
+        uint32_t index;
+        if (!_freeSlots.empty()) {
+            index = _freeSlots.back();
+            _freeSlots.pop_back();
+        } else {
+            index = _slots.size();
+            _slots.emplace_back();
+        }
+        Slot& slot = _slots[index];
+        slot.value = std::move(value);
+        slot.occupied = true;
+        _size++;
+        return Handle{index, slot.generation};
+    }
+
+    // returns false if handle is stale
+    bool Remove(Handle handle) {
+        if (!Contains(handle))
+            return false;
+        Slot& slot = _slots[handle.index];
+        // release held value and invalidate all outstanding handles
+        slot.value = T();
+        slot.occupied = false;
+        slot.generation++;
+        _freeSlots.push_back(handle.index);
+        _size--;
+        return true;
+    }
+
+    bool Contains(Handle handle) const {
+        return handle.index != 0
+            && handle.index < _slots.size()
+            && _slots[handle.index].occupied
+            && _slots[handle.index].generation == handle.generation;
+    }
+
+    // returns nullptr if handle is stale
+    /// NOTE: pointer is invalidated by the next Insert, do not hold onto it
+    T* Get(Handle handle) {
+        if (!Contains(handle))
+            return nullptr;
+        return &_slots[handle.index].value;
+    }
+    const T* Get(Handle handle) const {
+        if (!Contains(handle))
+            return nullptr;
+        return &_slots[handle.index].value;
+    }
+
+    size_t Size() const {
+        return _size;
+    }
+
+    // call fn(Handle, T&) for every occupied slot
+    template <typename Fn>
+    void ForEach(Fn fn) {
+        for (uint32_t i = 1; i < _slots.size(); i++) {
+            if (_slots[i].occupied)
+                fn(Handle{i, _slots[i].generation}, _slots[i].value);
+        }
+    }
+
+    void Clear() {
+        for (uint32_t i = 1; i < _slots.size(); i++) {
+            if (_slots[i].occupied)
+                Remove(Handle{i, _slots[i].generation});
+        }
+    }
+};
+
+} // marathon
@@ -19,17 +19,20 @@ struct UUID {
 private:
     int64_t _uuid = 0;
 
+    // generators are per thread so UUIDs can be created on worker threads
+    // e.g. materials built while recording command lists
+
     // Non-deterministic random number
     // Seed the pseudo number gen
-    static inline std::random_device _trueRandom;
+    static inline thread_local std::random_device _trueRandom;
 
     // Psuedo random generator
     // Mersenne Twister algorithm
     // 2^19937 - 1 before repeating
-	static inline std::mt19937_64 _psuedoGenerator{_trueRandom()};
+	static inline thread_local std::mt19937_64 _psuedoGenerator{_trueRandom()};
 
     // even chance across whole UUID space
-	static inline std::uniform_int_distribution<int64_t> _uniformDistributer;
+	static inline thread_local std::uniform_int_distribution<int64_t> _uniformDistributer;
 
 public:
 
@@ -0,0 +1,81 @@
+#pragma once
+
+// PUBLIC HEADER
+
+#include <vector>
+
+#include "core/resource.hpp"
+#include "renderer/texture.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+/// NOTE: a canvas only describes a render target, backends allocate the storage when it is first bound
+/// window sized canvases follow the window size, their storage is reallocated lazily on the next bind after a resize
+/// transient canvases give their storage back at the end of each frame so contents don't persist between frames,
+/// backends hand the same storage to any canvas with matching size & formats e.g. successive post processing passes
+
+/// TODO:
+// multisampled canvases with resolve on unbind
+// sampling depth attachments
+// mipmap generation of colour attachments
+
+// returns true if format can be used as a canvas colour attachment
+bool IsColorFormat(TexPixelFormat format);
+// returns true if format can be used as a canvas depth/stencil attachment
+bool IsDepthFormat(TexPixelFormat format);
+
+// offscreen render target of colour & optional depth/stencil attachments
+class Canvas : public Resource {
+protected:
+    // fixed size, ignored if window sized
+    int _width = 0;
+    int _height = 0;
+    // multiplier of window size, 0 if fixed size
+    float _windowScale = 1.0f;
+    std::vector<TexPixelFormat> _colorFormats = { TexPixelFormat::RGBA_8u };
+    TexPixelFormat _depthFormat = TexPixelFormat::DEPTH_24f_STENCIL_8u;
+    // filter used when colour attachments are sampled
+    TexFilter _filter = TexFilter::LINEAR;
+    bool _isTransient = false;
+
+public:
+    static constexpr int MAX_COLOR_ATTACHMENTS = 4;
+
+    // window sized
+    Canvas();
+    // fixed size
+    Canvas(int width, int height);
+    ~Canvas();
+
+    // fixed size, 0 if window sized
+    int GetWidth() const;
+    int GetHeight() const;
+    void SetSize(int width, int height);
+    // size in pixels given the current window size
+    void GetPixelSize(int windowWidth, int windowHeight, int& width, int& height) const;
+
+    // e.g. 0.5 for half resolution effects, 0 if fixed size
+    float GetWindowScale() const;
+    void SetWindowScale(float scale);
+    bool IsWindowSized() const;
+
+    // at least one colour attachment, up to MAX_COLOR_ATTACHMENTS
+    // returns false & leaves formats unchanged if any are not colour formats
+    const std::vector<TexPixelFormat>& GetColorFormats() const;
+    bool SetColorFormats(const std::vector<TexPixelFormat>& formats);
+    // NONE for no depth/stencil attachment, returns false if not a depth/stencil format
+    TexPixelFormat GetDepthFormat() const;
+    bool SetDepthFormat(TexPixelFormat format);
+
+    TexFilter GetFilter() const;
+    void SetFilter(TexFilter filter);
+
+    bool GetTransient() const;
+    void SetTransient(bool isTransient);
+};
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,126 @@
+#pragma once
+
+// PUBLIC HEADER
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stack>
+#include <span>
+#include <utility>
+#include <unordered_map>
+
+#include "la_extended.h"
+#include "renderer/mesh.hpp"
+#include "renderer/material.hpp"
+#include "renderer/frustum.hpp"
+#include "renderer/draw_queue.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+/// NOTE: recording touches no backend state so lists can be filled on any thread, one thread per list
+/// lists are submitted with Renderer::Submit on the render thread, which merges them into the draw queue
+/// meshes & materials must not be modified while lists recording them are in flight
+/// bounds of edited meshes are stale until drawn by the renderer or Mesh::UpdateBounds is called
+/// so update them before recording for lists to cull with the edited positions
+/// transforms are absolute, the renderer's transform stack is not applied on submission
+
+/// TODO:
+// record state changes e.g. depth & cull modes once draws carry their own state
+// record occluders for the cpu occlusion culler
+
+// per thread recording of draws with its own transform stack, replayed by the renderer
+class CommandList {
+public:
+    // recorded draw, instance data lives in the list's instance buffer
+    struct Entry {
+        std::shared_ptr<Mesh> mesh = nullptr;
+        // mesh material with the list's uniform overrides applied, if any
+        std::shared_ptr<Material> material = nullptr;
+        LA::mat4 model = LA::mat4();
+        // instancing, count of 0 is a regular draw, layout matches DrawQueue
+        uint32_t instanceCount = 0;
+        uint32_t instanceOffset = 0;
+        uint32_t instanceSize = 0;
+        uint8_t instanceStreamMask = 0;
+        // identifies the object for gpu occlusion queries, 0 uses mesh & model
+        uint64_t occlusionId = 0;
+    };
+
+private:
+    // material built from a source material & one set of overrides, reused between recordings
+    struct OverrideMaterial {
+        std::weak_ptr<Material> source;
+        uint32_t sourceVersion = 0;
+        std::vector<std::pair<std::string, UniformProperty>> overrides;
+        std::shared_ptr<Material> material = nullptr;
+        bool isUsed = false;
+    };
+
+    std::vector<Entry> _entries;
+    std::vector<uint8_t> _instanceData;
+    std::stack<LA::mat4> _transforms = std::stack<LA::mat4>({LA::mat4()});
+
+    // sorted by name so equal sets hash the same
+    std::vector<std::pair<std::string, UniformProperty>> _overrides;
+    uint64_t _overridesHash = 0;
+    std::unordered_map<uint64_t, OverrideMaterial> _overrideMaterials;
+
+    Frustum _frustum = Frustum();
+    bool _hasFrustum = false;
+    int _culledCount = 0;
+
+    void HashOverrides();
+    // material to record for source, builds the override material if needed
+    std::shared_ptr<Material> ResolveMaterial(std::shared_ptr<Material> source);
+    uint32_t PushInstanceData(const void* data, size_t size);
+
+public:
+    CommandList() = default;
+    ~CommandList() = default;
+
+    /// --- Recording ---
+    // occlusionId matches Renderer::Draw
+    void Draw(std::shared_ptr<Mesh> mesh, uint64_t occlusionId = 0);
+    // each instance is relative to the current model transform, instances are not culled
+    void DrawInstanced(std::shared_ptr<Mesh> mesh, std::span<const LA::mat4> transforms, std::span<const InstanceStream> streams = {});
+    // forget all recorded draws, transforms & overrides, keeps allocations & override materials still in use
+    void Reset();
+
+    /// --- Transforms ---
+    LA::mat4 GetModel() const;
+    LA::mat4 PopTransform();
+    void PushTransform(const LA::mat4& transform);
+    void PushTranslate(float x, float y, float z);
+    void PushTranslate(LA::vec3 translate);
+    void PushRotate(float x, float y, float z);
+    void PushRotate(LA::vec3 rotate);
+    void PushScale(float x, float y, float z);
+    void PushScale(LA::vec3 scale);
+
+    /// --- Uniform Overrides ---
+    // overrides the material uniform for draws recorded after, until cleared
+    void SetUniform(const std::string& key, const UniformProperty& value);
+    void ClearUniform(const std::string& key);
+    void ClearUniforms();
+
+    /// --- Culling ---
+    // cull draws against frustum while recording, so culling is spread across threads too
+    // otherwise the renderer culls them on submission
+    void SetFrustum(const Frustum& frustum);
+    void ClearFrustum();
+    bool HasFrustum() const;
+    int GetCulledCount() const;
+
+    const std::vector<Entry>& GetEntries() const;
+    const std::vector<uint8_t>& GetInstanceData() const;
+    size_t Size() const;
+    bool Empty() const;
+};
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <memory>
+#include <unordered_map>
+
+#include "la_extended.h"
+#include "core/slot_map.hpp"
+#include "renderer/material.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+// per instance vec4 data bound to the shader's instance_data{slot} attribute
+struct InstanceStream {
+    static constexpr int MAX_SLOTS = 4;
+    int slot = 0;
+    std::span<const LA::vec4> data = {};
+};
+
+/// NOTE: commands reference backend data by handle so the queue is backend agnostic
+/// commands should stay small, they are copied into the queue on every draw
+struct DrawCommand {
+    uint64_t sortKey = 0;
+    Handle mesh = Handle();
+    Handle shader = Handle();
+    // index into queue material table
+    uint32_t material = 0;
+    LA::mat4 model = LA::mat4();
+    // instancing, count of 0 is a regular draw
+    // instance data is laid out as transforms followed by each stream in slot order
+    uint32_t instanceCount = 0;
+    uint32_t instanceOffset = 0;
+    uint8_t instanceStreamMask = 0;
+    // backend occlusion query of the draw, invalid if not queried
+    Handle occlusion = Handle();
+};
+
+/// TODO:
+// support transparent draws sorted back to front
+// add layers/passes to the top bits of the sort key
+
+// per frame buffer of draw commands, sorted to minimise state changes before submission
+class DrawQueue {
+private:
+    std::vector<DrawCommand> _commands;
+    // command indices in submission order after Sort
+    std::vector<uint32_t> _order;
+    std::vector<uint32_t> _scratch;
+    bool _isSorted = true;
+
+    // materials referenced by commands, kept alive until cleared
+    std::vector<std::shared_ptr<Material>> _materials;
+    std::unordered_map<const Material*, uint32_t> _materialIndices;
+
+    // per instance data of all instanced commands, uploaded once on submission
+    std::vector<uint8_t> _instanceData;
+
+public:
+    DrawQueue() = default;
+    ~DrawQueue() = default;
+
+    // key layout (msb -> lsb): program 16 | material 16 | geometry 16 | depth 16
+    // geometry is whatever the backend binds per mesh e.g. a vao shared by pooled meshes
+    static uint64_t MakeSortKey(uint32_t program, uint32_t material, uint32_t geometry, float depth);
+    // view space distance of model origin from camera
+    static float ComputeViewDepth(const LA::mat4& view, const LA::mat4& model);
+
+    // returns index of material in table, adding it if not already present
+    uint32_t AddMaterial(std::shared_ptr<Material> material);
+    const std::shared_ptr<Material>& GetMaterial(uint32_t index) const;
+
+    // copies data into instance buffer, returns byte offset of the copy
+    uint32_t PushInstanceData(const void* data, size_t size);
+    const std::vector<uint8_t>& GetInstanceData() const;
+
+    void Push(const DrawCommand& command);
+    // drop commands matching predicate, returns number removed, must be sorted again after
+    template <typename Predicate>
+    size_t RemoveIf(Predicate predicate) {
+        size_t count = _commands.size();
+        _commands.erase(std::remove_if(_commands.begin(), _commands.end(), predicate), _commands.end());
+        _isSorted = false;
+        return count - _commands.size();
+    }
+    // stable radix sort of commands by sort key
+    void Sort();
+    void Clear();
+
+    size_t Size() const;
+    bool Empty() const;
+    // get command in sorted order, only valid after Sort
+    const DrawCommand& GetSorted(size_t i) const;
+
+    // number of program/material/geometry changes required to submit commands
+    int CountStateChanges(bool sorted) const;
+};
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,46 @@
+#pragma once
+
+// PUBLIC HEADER
+
+#include <vector>
+
+#include "la_extended.h"
+#include "renderer/command_list.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+/// NOTE: a packet is filled by the simulation and only read when submitted, possibly on another thread
+/// so draws must be recorded into its lists rather than made through the Renderer directly
+/// resources referenced by a packet must not be modified until it has been submitted
+/// the camera & clear are applied when the packet is submitted, after any draws made directly through the Renderer
+
+// everything needed to submit one frame, values not set leave the renderer's as they are
+struct FramePacket {
+    int frameIndex = 0;
+    // simulation time the frame was recorded at, used for the frame globals
+    double time = 0.0;
+    double deltaTime = 0.0;
+
+    // camera
+    bool hasCamera = false;
+    LA::mat4 view = LA::mat4();
+    LA::mat4 projection = LA::mat4();
+
+    // clear the bound canvas before the packet's draws
+    bool clear = false;
+    LA::vec4 clearColor = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    // one per recording thread, submitted in order
+    std::vector<CommandList> lists;
+
+    void SetCamera(const LA::mat4& view, const LA::mat4& projection);
+    void SetClear(const LA::vec4& colour);
+    // list count is grown to at least count, lists are reset so can be reused between frames
+    void Reset(size_t count = 1);
+};
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+
+#include "la_extended.h"
+#include "renderer/mesh.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+// ax + by + cz + d >= 0 for points on the inner side, normal is unit length
+struct Plane {
+    float a = 0.0f;
+    float b = 0.0f;
+    float c = 0.0f;
+    float d = 0.0f;
+};
+
+/// NOTE: tests are conservative, bounds straddling a corner of the frustum may be reported visible
+/// a default constructed frustum has degenerate planes so reports everything visible
+
+// world space view volume for culling bounds
+class Frustum {
+private:
+    // left, right, bottom, top, near, far
+    std::array<Plane, 6> _planes = {};
+
+public:
+    Frustum() = default;
+    // planes extracted from projection * view
+    explicit Frustum(const LA::mat4& viewProjection);
+    ~Frustum() = default;
+
+    const std::array<Plane, 6>& GetPlanes() const;
+    // bounds are in mesh space & transformed by model, invalid bounds are always visible
+    bool IsVisible(const Bounds& bounds, const LA::mat4& model) const;
+};
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,83 @@
+#pragma once
+
+// PUBLIC HEADER
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+namespace marathon {
+
+namespace renderer {
+
+namespace headless {
+
+// backend work the headless renderer would have sent to a gpu
+enum class CallType {
+    CLEAR,
+    DRAW,
+    DRAW_INSTANCED,
+    SET_STATE,
+    BIND_SHADER,
+    BIND_MESH,
+    BIND_CANVAS,
+    BIND_TEXTURE,
+    SET_UNIFORM,
+    UPLOAD_MESH,
+    UPLOAD_UNIFORM_BLOCK,
+    UPLOAD_INSTANCE_DATA,
+    COMPILE_SHADER,
+    BEGIN_ZONE,
+    END_ZONE,
+    COUNT
+};
+
+struct RecordedCall {
+    CallType type = CallType::DRAW;
+    int frameIndex = 0;
+    // bytes the call would have sent to the gpu
+    size_t bytes = 0;
+    // name of the state, uniform, resource or zone, if any
+    std::string label = "";
+};
+
+/// NOTE: counts & byte totals are always kept, individual calls can be dropped
+/// e.g. for long benchmarks where storing every call would dominate the cost being measured
+
+// inspectable log of calls recorded by the headless renderer
+class CommandLog {
+private:
+    std::vector<RecordedCall> _calls;
+    std::array<size_t, (size_t)CallType::COUNT> _counts = {};
+    std::array<size_t, (size_t)CallType::COUNT> _bytes = {};
+    bool _isKeepingCalls = true;
+
+public:
+    CommandLog() = default;
+    ~CommandLog() = default;
+
+    static const char* GetCallName(CallType type);
+
+    void Record(CallType type, int frameIndex, size_t bytes = 0, const std::string& label = "");
+    void Clear();
+
+    bool GetKeepCalls() const;
+    void SetKeepCalls(bool enabled);
+    // empty if calls are not being kept
+    const std::vector<RecordedCall>& GetCalls() const;
+    size_t GetCount(CallType type) const;
+    size_t GetBytes(CallType type) const;
+    size_t GetTotalCount() const;
+    size_t GetTotalBytes() const;
+
+    // one row per kept call, in order
+    bool ExportCsv(const std::filesystem::path& path) const;
+};
+
+} // headless
+
+} // renderer
+
+} // marathon
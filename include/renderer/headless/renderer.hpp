@@ -0,0 +1,266 @@
+#pragma once
+
+// PUBLIC HEADER
+
+#include <chrono>
+#include <unordered_map>
+
+#include "core/slot_map.hpp"
+#include "renderer/mesh.hpp"
+#include "renderer/shader.hpp"
+#include "renderer/material.hpp"
+#include "renderer/frustum.hpp"
+#include "renderer/occlusion_culler.hpp"
+#include "renderer/renderer.hpp"
+#include "renderer/headless/command_log.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace headless {
+
+/// NOTE: implements the renderer on the cpu alone so it runs without a gpu, window or context
+/// validation, culling, sorting & uniform packing run as in the gpu backends so their cost can be measured
+/// anything that would reach the gpu is recorded in the command log instead
+/// shaders are reflected by parsing their uniform declarations, they are never compiled so are READY
+/// once parsed, gpu occlusion queries have no results so never hide draws
+
+/// TODO:
+// optionally simulate asynchronous compiles to exercise placeholder paths
+
+class Renderer : public renderer::Renderer {
+private:
+    static const std::vector<std::string> s_reservedUniforms;
+    static const std::string s_materialBlockName;
+    // zone samples kept per name
+    static constexpr size_t s_zoneHistorySize = 240;
+
+    struct MeshHandler {
+        std::shared_ptr<Mesh> mesh = nullptr;
+        uint32_t attributeMask = 0;
+        // flush the mesh was last queued in, edits flush first if it is the current one
+        int queuedFlush = -1;
+        std::string warnings = "";
+        bool isValid = false;
+    };
+
+    struct ShaderHandler {
+        std::weak_ptr<Shader> shader;
+        // kept to clean up the lookup once the shader expires
+        int64_t uuid = 0;
+        ShaderStatus status = ShaderStatus::INVALID;
+        std::string warnings = "";
+        bool isValid = false;
+        // indexed by uniform id, true if the shader declares the uniform outside a block
+        std::vector<bool> uniforms;
+        UniformBlockLayout materialBlock = UniformBlockLayout();
+        // equal for shaders whose material blocks pack identically, so they can share material buffers
+        uint64_t materialBlockHash = 0;
+    };
+
+    // packed material block, repacked only when the material version changes
+    // one per material & block layout so variants sharing a layout share the upload
+    struct MaterialBuffer {
+        std::weak_ptr<Material> material;
+        uint64_t layoutHash = 0;
+        uint32_t version = 0;
+        std::vector<uint8_t> data;
+    };
+
+    struct OpenZone {
+        std::string name = "";
+        std::chrono::time_point<std::chrono::steady_clock> start;
+    };
+
+    CommandLog _commandLog = CommandLog();
+
+    SlotMap<MeshHandler> _meshHandlers;
+    std::unordered_map<int64_t, Handle> _meshLookup;
+    SlotMap<ShaderHandler> _shaderHandlers;
+    std::unordered_map<int64_t, Handle> _shaderLookup;
+    // keyed by material uuid & block layout hash
+    std::unordered_map<uint64_t, MaterialBuffer> _materialBuffers;
+    Handle _shaderHandle = Handle();
+    std::shared_ptr<Canvas> _canvas = nullptr;
+    // stands in for the window
+    int _width = 1280;
+    int _height = 720;
+
+    // incremented by each flush that submits draws
+    int _flushIndex = 0;
+
+    Frustum _frustum = Frustum();
+    bool _isFrustumDirty = true;
+    OcclusionCuller _occlusionCuller = OcclusionCuller();
+    bool _isOcclusionDirty = true;
+
+    std::vector<OpenZone> _openZones;
+    std::unordered_map<std::string, std::vector<GpuZoneSample>> _zoneHistory;
+
+    void Record(CallType type, size_t bytes = 0, const std::string& label = "");
+    // records a state change & flushes if value differs, returns false if unchanged
+    template <typename T>
+    bool ChangeState(T& current, const T& value, const std::string& label) {
+        if (current == value) {
+            _stats.stateCallsSkipped++;
+            return false;
+        }
+        Flush();
+        current = value;
+        Record(CallType::SET_STATE, 0, label);
+        return true;
+    }
+
+    MeshHandler BuildMeshHandler(std::shared_ptr<Mesh> mesh);
+    Handle FindOrCreateMeshHandler(std::shared_ptr<Mesh> mesh);
+    // record uploads of pending mesh edits & revalidate if reallocated
+    void UpdateMeshHandler(MeshHandler& meshHandler);
+    Handle FindOrCreateShaderHandler(std::shared_ptr<Shader> shader);
+    // parse uniforms & material block from the sources
+    void ReflectShader(ShaderHandler& shaderHandler, const Shader& shader);
+    ShaderHandler* GetBoundShaderHandler();
+    void CollectHandlers();
+
+    bool PrepareDrawCommand(std::shared_ptr<Mesh> mesh, const LA::mat4& model, DrawCommand& cmd, std::shared_ptr<Material> material = nullptr);
+    bool IsCulled(const Mesh& mesh, const LA::mat4& model);
+    void CullOccluded();
+    void CountDraw(const Mesh& mesh, int instanceCount);
+
+    bool IsReservedUniform(UniformId id) const;
+    // checks the bound shader declares the uniform, then records a write of size bytes
+    bool WriteUniform(UniformId id, size_t size);
+    bool SetMaterialUniforms(std::shared_ptr<Material> material);
+
+public:
+    Renderer();
+    ~Renderer() = default;
+
+    // module interface
+    bool Boot() override;
+    bool Shutdown() override;
+
+    /// --- Headless ---
+    CommandLog& GetCommandLog();
+    // size of the window canvases are sized relative to, the viewport while no canvas is bound
+    void SetResolution(int width, int height);
+    void GetResolution(int& width, int& height) const;
+
+    /// --- Validation ---
+    bool ValidateShader(std::shared_ptr<Shader> shader, std::string& err_msg) override;
+    bool ValidateMesh(std::shared_ptr<Mesh> mesh, std::string& err_msg) override;
+
+    /// --- Drawing ---
+    void Clear() override;
+    void Clear(bool clearColor, bool clearStencil, bool clearDepth) override;
+
+    /// --- Draw Calls ---
+    void Draw(std::shared_ptr<Mesh> mesh, uint64_t occlusionId = 0) override;
+    void DrawInstanced(std::shared_ptr<Mesh> mesh, std::span<const LA::mat4> transforms, std::span<const InstanceStream> streams = {}) override;
+    void DrawOccluder(std::shared_ptr<Mesh> mesh) override;
+    void Submit(std::span<const CommandList> lists) override;
+    void Flush() override;
+
+    /// --- State Management ---
+    void SetState(RendererState state) override;
+    void ResetState() override;
+    bool IsUsable() override;
+    // colour
+    LA::vec4 GetClearColor() override;
+    LA::vec4 GetColorMask() override;
+    void SetClearColor(const LA::vec4& colour) override;
+    void SetColorMask(const LA::vec4& mask) override;
+    // culling
+    bool GetCullTest() override;
+    CullFace GetCullFace() override;
+    CullWinding GetCullWinding() override;
+    void SetCullTest(bool enabled) override;
+    void SetCullFace(CullFace face) override;
+    void SetCullWinding(CullWinding winding) override;
+    // depth
+    bool GetDepthTest() override;
+    DepthFunc GetDepthFunction() override;
+    bool GetDepthMask() override;
+    void SetDepthTest(bool enabled) override;
+    void SetDepthFunction(DepthFunc func) override;
+    void SetDepthMask(bool enabled) override;
+    // rasterization
+    float GetLineWidth() override;
+    float GetPointSize() override;
+    bool GetIsWireframe() override;
+    void SetLineWidth(float width) override;
+    void SetPointSize(float size) override;
+    void SetIsWireframe(bool enabled) override;
+    // visibility
+    bool GetFrustumCulling() override;
+    void SetFrustumCulling(bool enabled) override;
+    bool GetOcclusionCulling() override;
+    void SetOcclusionCulling(bool enabled) override;
+    bool GetOcclusionQueries() override;
+    void SetOcclusionQueries(bool enabled) override;
+    // bound objects
+    std::shared_ptr<Canvas> GetCanvas() override;
+    std::shared_ptr<Shader> GetShader() override;
+    void SetCanvas(std::shared_ptr<Canvas> canvas) override;
+    void SetShader(std::shared_ptr<Shader> shader) override;
+    bool BindCanvasTexture(std::shared_ptr<Canvas> canvas, int attachment, int unit) override;
+
+    /// --- Shader Compilation ---
+    ShaderStatus GetShaderStatus(std::shared_ptr<Shader> shader) override;
+    ShaderStatus GetMaterialStatus(std::shared_ptr<Material> material, std::shared_ptr<Mesh> mesh) override;
+    int PrecompileMaterials(const std::vector<PrecompileRequest>& requests) override;
+    bool GetCompilePlaceholder() override;
+    void SetCompilePlaceholder(bool enabled) override;
+
+    /// --- Transforms ---
+    void SetProjection(const LA::mat4& proj) override;
+    void SetView(const LA::mat4& view) override;
+
+    /// --- Shader Methods ---
+    bool HasUniform(const std::string& key) override;
+    bool HasUniform(UniformId id) override;
+
+    bool SetUniform(const std::string& key, int value) override;
+    bool SetUniform(const std::string& key, uint32_t value) override;
+    bool SetUniform(const std::string& key, float value) override;
+    bool SetUniform(const std::string& key, double value) override;
+    bool SetUniform(const std::string& key, const LA::vec2& v) override;
+    bool SetUniform(const std::string& key, float x, float y) override;
+    bool SetUniform(const std::string& key, const LA::vec3& v) override;
+    bool SetUniform(const std::string& key, float x, float y, float z) override;
+    bool SetUniform(const std::string& key, const LA::vec4& v) override;
+    bool SetUniform(const std::string& key, float x, float y, float z, float w) override;
+    bool SetUniform(const std::string& key, const LA::mat2& m) override;
+    bool SetUniform(const std::string& key, const LA::mat3& m) override;
+    bool SetUniform(const std::string& key, const LA::mat4& m) override;
+    bool SetUniform(const std::string& key, const UniformProperty& value) override;
+
+    bool SetUniform(UniformId id, int value) override;
+    bool SetUniform(UniformId id, uint32_t value) override;
+    bool SetUniform(UniformId id, float value) override;
+    bool SetUniform(UniformId id, double value) override;
+    bool SetUniform(UniformId id, const LA::vec2& v) override;
+    bool SetUniform(UniformId id, const LA::vec3& v) override;
+    bool SetUniform(UniformId id, const LA::vec4& v) override;
+    bool SetUniform(UniformId id, const LA::mat2& m) override;
+    bool SetUniform(UniformId id, const LA::mat3& m) override;
+    bool SetUniform(UniformId id, const LA::mat4& m) override;
+    bool SetUniform(UniformId id, const UniformProperty& value) override;
+
+    /// --- Debug Info ---
+    void NextFrame() override;
+
+    /// --- Profiling ---
+    // zones only have cpu times, gpu times are 0
+    void BeginGpuZone(const std::string& name) override;
+    void EndGpuZone() override;
+    std::vector<std::string> GetGpuZoneNames() override;
+    std::vector<GpuZoneSample> GetGpuZoneHistory(const std::string& name) override;
+    bool ExportGpuZones(const std::filesystem::path& path) override;
+};
+
+} // headless
+
+} // renderer
+
+} // marathon
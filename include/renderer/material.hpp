@@ -4,6 +4,8 @@
 #include <memory>
 #include <unordered_map>
 #include <variant>
+#include <vector>
+#include <cstdint>
 
 #include "la_extended.h"
 #include "core/resource.hpp"
@@ -15,12 +17,41 @@ namespace renderer {
 
 typedef std::variant<int, uint32_t, float, double, LA::vec2, LA::vec3, LA::vec4, LA::mat2, LA::mat3, LA::mat4> UniformProperty;
 
+// member of a uniform block as laid out by the backend, offsets & strides in bytes
+struct UniformBlockMember {
+    std::string name = "";
+    size_t offset = 0;
+    size_t matrixStride = 0;
+    // vectors are a single column of rows components
+    int rows = 1;
+    int columns = 1;
+    bool isInteger = false;
+};
+
+// layout of a uniform block reflected from a shader
+struct UniformBlockLayout {
+    std::string name = "";
+    size_t size = 0;
+    std::vector<UniformBlockMember> members = {};
+
+    // returns nullptr if block has no such member
+    const UniformBlockMember* FindMember(const std::string& name) const;
+    // equal for layouts that pack identically, members must be in offset order
+    uint64_t Hash() const;
+};
+
 /// TODO: implement automatic uniforms setup from shader
 
+/// NOTE: shaders can declare a "MaterialProperties" std140 block, properties in it are packed
+/// into a buffer re-uploaded only when the material version changes, others are set as plain uniforms
 class Material : public Resource {
 protected:
     std::shared_ptr<renderer::Shader> _mShader;
     std::unordered_map<std::string, UniformProperty> _mUniforms;
+    // bumped whenever the shader or a uniform value actually changes
+    uint32_t _mVersion = 1;
+    // shader features enabled for draws with this material
+    std::vector<std::string> _mFeatures;
 
 public:
     Material();
@@ -33,6 +64,17 @@ public:
     const std::unordered_map<std::string, UniformProperty>& GetUniforms() const;
     UniformProperty GetUniform(const std::string& key) const;
     void SetUniform(const std::string& key, UniformProperty value);
+
+    const std::vector<std::string>& GetFeatures() const;
+    bool IsFeatureEnabled(const std::string& feature) const;
+    void SetFeatureEnabled(const std::string& feature, bool enabled);
+    // bit per enabled feature indexed by the shader's declared features, undeclared features are ignored
+    uint32_t GetFeatureMask() const;
+
+    uint32_t GetVersion() const;
+    // writes uniforms that are members of the block into data, resized to block size
+    // members without a matching uniform are zeroed, returns false if any uniform type mismatches
+    bool PackUniformBlock(const UniformBlockLayout& layout, std::vector<uint8_t>& data) const;
 };
 
 
@@ -79,6 +79,13 @@ enum class VertexAttribute {
     TEXCOORD3
 };
 
+// expected update frequency of mesh data, backends use it to pick buffer placement
+enum class BufferUsage {
+    STATIC,     // set once, never modified e.g. level geometry
+    DYNAMIC,    // modified occasionally
+    STREAM      // modified every frame
+};
+
 enum class DataDirty {
     INVALID,
     DIRTY_REALLOC,
@@ -87,6 +94,40 @@ enum class DataDirty {
     CLEAN
 };
 
+/// Byte range of buffer data
+struct DataRange {
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+/// Sorted set of disjoint modified byte ranges, overlapping/touching ranges are merged
+/// once over capacity the closest ranges are merged, trading extra upload for fewer calls
+/// renderers upload pending ranges at the next draw of the mesh, draws queued before the edit are flushed first
+class DirtyRangeSet {
+private:
+    static constexpr size_t s_maxRanges = 8;
+    std::vector<DataRange> _ranges = {};
+
+public:
+    void Add(size_t offset, size_t size);
+    void Clear();
+    bool Empty() const;
+    const std::vector<DataRange>& GetRanges() const;
+    // total bytes covered by ranges
+    size_t GetSize() const;
+};
+
+// axis aligned box & enclosing sphere of vertex positions in mesh space
+struct Bounds {
+    LA::vec3 min = {0.0f, 0.0f, 0.0f};
+    LA::vec3 max = {0.0f, 0.0f, 0.0f};
+    // sphere shares the box centre
+    LA::vec3 center = {0.0f, 0.0f, 0.0f};
+    float radius = 0.0f;
+    // false if positions can't be read e.g. no vertices or non float format, such meshes are never culled
+    bool isValid = false;
+};
+
 /// Vertex attribute descriptor for mesh vertex data layout
 /// describes a single vertex attribute
 struct VertexAttributeDescriptor {
@@ -97,15 +138,12 @@ struct VertexAttributeDescriptor {
 
 /// TODO:
 /// allow for multiple vertex buffers/data streams rather than a single interleaved vbo
-/// allow for buffer usage to be set (currently STATIC only)
 /// should centralise all raw data handling into a single buffer class
 /// replace void* with c++ standard alternatives e.g. std::array for runtime allocated fixed array or std::vector for dynamicly sized array
 
 /// TODO: 
-/// - add bound calculations for physics to use
 /// - add instancing support
 /// - implement support for multiple vbos
-/// - add support for setting buffer usage (currently STATIC only)
 /// - add validation on data being input, accepts absolute shit atm, throw errors for the factor to catch
 /// - additionally add flags to allow for data validation checks to be skipped for performance
 /// - improve performance by using ptr array fills for gets and passing const references
@@ -120,6 +158,7 @@ protected:
     // buffer
     void* _vertexData = nullptr; 
     DataDirty _vertexDataDirty = DataDirty::CLEAN;
+    DirtyRangeSet _vertexDirtyRanges = DirtyRangeSet();
     // vertex params
     int _vertexCount = 0;
     std::vector<VertexAttributeDescriptor> _vertexAttributeDescriptors = {};
@@ -131,6 +170,7 @@ protected:
     // buffer
     void* _indexData = nullptr;
     DataDirty _indexDataDirty = DataDirty::CLEAN;
+    DirtyRangeSet _indexDirtyRanges = DirtyRangeSet();
     // index params
     int _indexCount = 0;
     IndexFormat _indexFormat = IndexFormat::UINT16;
@@ -145,8 +185,6 @@ protected:
     /// --- VBO ---
     // release memory and reset params
     void ClearVertices();
-    // call to stop data being uploaded to GPU next frame
-    void ClearVertexDirtyFlag();
     // INTERNAL get attribute index in descriptor list
     int GetVertexAttributeIndex(VertexAttribute attr) const;
     // allocates memory according to attributes, vertex data expected to be interleaved in provided order
@@ -158,8 +196,6 @@ protected:
     /// --- IBO ---
     // release memory and reset params
     void ClearIndices();
-    // call to stop data being uploaded to GPU next frame
-    void ClearIndexDirtyFlag();
     // set index data formatting
     void SetIndexParams(int indexCount, IndexFormat format, PrimitiveType primitive);
     // will error if size/offset data range outside expected
@@ -168,6 +204,20 @@ protected:
 
     /// --- Material ---
     std::shared_ptr<Material> _material = nullptr;
+
+    /// --- Usage ---
+    BufferUsage _usage = BufferUsage::STATIC;
+
+    /// --- Occlusion ---
+    bool _occlusionQuery = false;
+
+    /// --- Bounds ---
+    // recalculated by UpdateBounds on the render thread so reading is safe from any thread
+    Bounds _bounds = Bounds();
+    bool _isBoundsDirty = false;
+    void CalculateBounds();
+    // true if the byte range of vertex data overlaps any vertex position
+    bool IsPositionRange(size_t offset, size_t size) const;
     
 public:
     // create empty mesh
@@ -179,6 +229,10 @@ public:
     int GetVertexCount() const;
     std::vector<VertexAttributeDescriptor> GetVertexAttributes() const;
     DataDirty GetVertexDirtyFlag() const;
+    // byte ranges modified since the last upload, only meaningful for DIRTY_UPDATE
+    const DirtyRangeSet& GetVertexDirtyRanges() const;
+    // call to stop data being uploaded to GPU next frame, called by the renderer after upload
+    void ClearVertexDirtyFlag();
     bool HasVertexAttribute(VertexAttribute attr) const;
     int GetVertexAttributeLocation(VertexAttribute attr) const;
     int GetVertexAttributeComponents(VertexAttribute attr) const;
@@ -193,10 +247,28 @@ public:
     IndexFormat GetIndexFormat() const;
     PrimitiveType GetPrimitiveType() const;
     DataDirty GetIndexDirtyFlag() const;
+    const DirtyRangeSet& GetIndexDirtyRanges() const;
+    void ClearIndexDirtyFlag();
 
     // material
     std::shared_ptr<Material> GetMaterial() const;
     void SetMaterial(std::shared_ptr<Material> material);
+
+    // usage, static meshes may be batched into shared buffers by the renderer
+    BufferUsage GetBufferUsage() const;
+    void SetBufferUsage(BufferUsage usage);
+
+    // draws of the mesh are skipped while gpu occlusion queries of its bounds report it hidden
+    // suits large or expensive meshes, a query is issued per draw so it costs more than it saves on small ones
+    // each draw is tracked by the occlusion id passed to Draw, or by its model transform without one
+    bool GetOcclusionQuery() const;
+    void SetOcclusionQuery(bool enabled);
+
+    // bounds of vertex positions, including vertices not referenced by indices
+    // stale after positions are set until UpdateBounds, which the renderer calls before culling or uploading
+    const Bounds& GetBounds() const;
+    // recalculate bounds if positions were set since the last update
+    void UpdateBounds();
 };
 
 /// TODO: implement mesh subdivision
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "la_extended.h"
+#include "renderer/mesh.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+/// NOTE: runs entirely on the cpu so has no backend or gpu dependency
+/// occluders should be simplified, closed meshes that lie inside the geometry they stand in for
+/// otherwise objects may be culled that should be partially visible
+/// triangles crossing the near plane are skipped rather than clipped, which only loses occlusion
+
+/// TODO:
+// clip occluder triangles against the near plane
+// reproject the previous frame's buffer to avoid rasterising static occluders every frame
+
+// software depth buffer of occluder meshes with a min/max hierarchy for testing bounds against
+class OcclusionCuller {
+private:
+    // rasterisation is split into horizontal bands, one per thread
+    static constexpr int s_maxThreads = 4;
+    // below this many triangles threading costs more than it saves
+    static constexpr size_t s_minThreadedTriangles = 256;
+    // bounds covering more texels than this are tested at a coarser level
+    static constexpr int s_maxTestTexels = 4;
+
+    // screen space triangle, z is depth in [0, 1]
+    struct Triangle {
+        float x[3];
+        float y[3];
+        float z[3];
+    };
+
+    struct Level {
+        int width = 0;
+        int height = 0;
+        // nearest & furthest occluder depth within each texel
+        std::vector<float> minDepth;
+        std::vector<float> maxDepth;
+    };
+
+    int _width = 0;
+    int _height = 0;
+    int _threadCount = 1;
+    // occluder geometry this frame, transformed to world space
+    std::vector<LA::vec3> _vertices;
+    std::vector<uint32_t> _indices;
+    LA::mat4 _viewProjection = LA::mat4();
+    std::vector<Triangle> _triangles;
+    // level 0 is full resolution
+    std::vector<Level> _levels;
+
+    // persistent workers rasterising bands 1 to _threadCount - 1, band 0 is the calling thread
+    std::vector<std::thread> _workers;
+    std::mutex _workerMutex;
+    std::condition_variable _workCondition;
+    std::condition_variable _doneCondition;
+    // incremented for each dispatch so workers know there is new work
+    int _dispatch = 0;
+    int _bandCount = 0;
+    int _bandHeight = 0;
+    int _pendingBands = 0;
+    bool _isStopping = false;
+
+    void StartWorkers();
+    void StopWorkers();
+    void WorkerLoop(int band);
+    void SetupTriangles();
+    // rasterise all triangles into rows [rowBegin, rowEnd) of level 0
+    void RasteriseRows(int rowBegin, int rowEnd);
+    void BuildHierarchy();
+
+public:
+    OcclusionCuller(int width = 256, int height = 128);
+    ~OcclusionCuller();
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    void SetResolution(int width, int height);
+    // 0 uses the hardware concurrency, capped
+    // workers are started by the first threaded rasterise & kept until the count changes
+    void SetThreadCount(int threadCount);
+
+    // reads positions & indices of the cpu side mesh data, float or double positions of any primitive type
+    // returns false if the mesh can't be used as an occluder
+    bool AddOccluder(const Mesh& mesh, const LA::mat4& model);
+    void ClearOccluders();
+    bool HasOccluders() const;
+    size_t GetTriangleCount() const;
+
+    // rasterise occluders from the view & build the hierarchy, must be called before testing
+    void Rasterise(const LA::mat4& viewProjection);
+    // false only if the transformed bounds are entirely behind occluders, invalid bounds are visible
+    bool IsVisible(const Bounds& bounds, const LA::mat4& model) const;
+
+    int GetWidth() const;
+    int GetHeight() const;
+    // level 0 nearest depth per pixel, row major from the bottom of the screen, 1 where empty
+    const std::vector<float>& GetDepthBuffer() const;
+};
+
+} // renderer
+
+} // marathon
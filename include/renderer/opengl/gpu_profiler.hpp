@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// include opengl deps
+#define GL_VERSION_4_4
+#include <GL/glew.h>
+
+#include "renderer/renderer.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace opengl {
+
+/// NOTE: zones are timed with a GL_TIMESTAMP query at each end rather than GL_TIME_ELAPSED
+/// as elapsed queries can't be nested, results are read back a few frames later once available
+/// so reading never stalls the pipeline, frames that fall too far behind are dropped
+
+/// TODO:
+// disjoint timer query support for platforms where the gpu clock can be reset
+
+// gpu & cpu timings of named, nestable zones
+class GpuProfiler {
+private:
+    // frames of results in flight before the oldest is dropped
+    static constexpr size_t s_maxPendingFrames = 6;
+    // samples kept per zone
+    static constexpr size_t s_historySize = 240;
+
+    struct Zone {
+        std::string name = "";
+        int depth = 0;
+        GLuint beginQuery = 0;
+        GLuint endQuery = 0;
+        std::chrono::steady_clock::time_point cpuBegin;
+        std::chrono::steady_clock::time_point cpuEnd;
+    };
+
+    struct Frame {
+        int frameIndex = 0;
+        std::vector<Zone> zones;
+        // end query of the zone closed last
+        GLuint lastQuery = 0;
+    };
+
+    // query objects not in use
+    std::vector<GLuint> _queryPool;
+    std::vector<GLuint> _queries;
+    Frame _frame = Frame();
+    // indices into _frame.zones of open zones
+    std::vector<size_t> _openZones;
+    std::deque<Frame> _pendingFrames;
+    std::unordered_map<std::string, std::deque<GpuZoneSample>> _history;
+
+    GLuint AcquireQuery();
+    void ReleaseFrame(Frame& frame);
+    // true if read, false if results not available yet
+    bool ReadFrame(Frame& frame);
+
+public:
+    GpuProfiler() = default;
+    ~GpuProfiler();
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // work must be submitted before beginning & ending a zone for it to be attributed correctly
+    void BeginZone(const std::string& name);
+    void EndZone();
+    // closes open zones & collects results of earlier frames that are ready
+    void NextFrame(int frameIndex);
+
+    std::vector<std::string> GetZoneNames() const;
+    // oldest first, empty if zone unknown
+    std::vector<GpuZoneSample> GetHistory(const std::string& name) const;
+    // csv of all samples in history, one row per zone per frame
+    bool Export(const std::filesystem::path& path) const;
+};
+
+} // opengl
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// include opengl deps
+#define GL_VERSION_4_4
+#include <GL/glew.h>
+
+#include "renderer/mesh.hpp"
+#include "renderer/opengl/state_cache.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace opengl {
+
+// resolved opengl vertex attribute pointer for a vertex layout
+struct VertexBinding {
+    GLuint location = 0;
+    GLint components = 0;
+    GLenum type = 0;
+    size_t offset = 0;
+};
+
+/// TODO:
+// defragment pools when free ranges are scattered
+// support non-indexed meshes
+
+// shared vao/vbo/ibo for all static meshes with the same vertex layout and index format
+// meshes are addressed by base vertex and first index so a pool needs a single vao bind
+class MeshPool {
+public:
+    struct Allocation {
+        GLint baseVertex = 0;
+        GLuint firstIndex = 0;
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+    };
+
+private:
+    struct Range {
+        size_t start = 0;
+        size_t count = 0;
+    };
+
+    static constexpr size_t s_initialVertexCapacity = 1 << 16;
+    static constexpr size_t s_initialIndexCapacity = 3 << 16;
+
+    StateCache& _glState;
+    std::vector<VertexBinding> _bindings;
+    size_t _vertexSize = 0;
+    size_t _indexSize = 0;
+
+    GLuint _vao = 0;
+    GLuint _vbo = 0;
+    GLuint _ibo = 0;
+    // capacity and used space in elements, not bytes
+    size_t _vertexCapacity = 0;
+    size_t _indexCapacity = 0;
+    size_t _vertexEnd = 0;
+    size_t _indexEnd = 0;
+    std::vector<Range> _freeVertices;
+    std::vector<Range> _freeIndices;
+
+    // first fit from free ranges, otherwise appended to the end, returns false if buffer must grow
+    static bool AllocateRange(std::vector<Range>& freeRanges, size_t& end, size_t capacity, size_t count, size_t& start);
+    static void FreeRange(std::vector<Range>& freeRanges, size_t& end, Range range);
+    // reallocate buffer with larger capacity, copying existing contents on the gpu
+    void Grow(GLenum target, GLuint& buffer, size_t& capacity, size_t required, size_t elementSize);
+    void BindVertexLayout();
+
+public:
+    MeshPool(StateCache& glState, const std::vector<VertexBinding>& bindings, size_t vertexSize, size_t indexSize);
+    ~MeshPool();
+    MeshPool(const MeshPool&) = delete;
+    MeshPool& operator=(const MeshPool&) = delete;
+
+    // key of meshes that can share a pool
+    static std::string MakeLayoutKey(const Mesh& mesh);
+
+    // allocates space and uploads mesh data
+    bool Allocate(const Mesh& mesh, Allocation& allocation);
+    void Free(const Allocation& allocation);
+
+    GLuint GetVertexArray() const;
+    // buffers are replaced when the pool grows so don't hold onto them
+    GLuint GetVertexBuffer() const;
+    GLuint GetIndexBuffer() const;
+    size_t GetIndexSize() const;
+};
+
+} // opengl
+
+} // renderer
+
+} // marathon
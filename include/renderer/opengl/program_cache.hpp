@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <filesystem>
+
+// include opengl deps
+#define GL_VERSION_4_4
+#include <GL/glew.h>
+
+namespace marathon {
+
+namespace renderer {
+
+namespace opengl {
+
+/// NOTE: binaries are only valid for the driver that produced them, the driver strings are part of
+/// the key so a driver update misses rather than loading an incompatible binary
+/// a binary can still be rejected by the driver, in which case the entry is deleted and the caller recompiles
+
+/// TODO:
+// evict old entries, the cache currently grows unbounded
+
+// on-disk cache of linked program binaries keyed by a hash of the final sources
+class ProgramCache {
+private:
+    static constexpr uint32_t s_magic = 0x4250544D; // "MTPB"
+    static constexpr uint32_t s_version = 1;
+
+    struct FileHeader {
+        uint32_t magic = s_magic;
+        uint32_t version = s_version;
+        uint64_t key = 0;
+        uint32_t format = 0;
+        uint32_t length = 0;
+    };
+
+    std::filesystem::path _directory = "";
+    uint64_t _driverHash = 0;
+    bool _isEnabled = false;
+
+    std::filesystem::path GetEntryPath(uint64_t key) const;
+
+public:
+    ProgramCache() = default;
+    ~ProgramCache() = default;
+
+    // per user cache location, MARATHON_SHADER_CACHE if set, otherwise the platform's cache directory
+    // so the cache never depends on the working directory the app was launched from
+    static std::filesystem::path GetDefaultDirectory();
+
+    // enabled if program binaries are supported and the directory can be created
+    // requires a current context to query the driver
+    bool Init(const std::filesystem::path& directory);
+    bool IsEnabled() const;
+
+    uint64_t MakeKey(const std::string& vertexSource, const std::string& fragmentSource) const;
+    // returns linked program from cached binary, 0 on miss or rejected binary
+    GLuint Load(uint64_t key);
+    // program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    void Store(uint64_t key, GLuint program);
+};
+
+} // opengl
+
+} // renderer
+
+} // marathon
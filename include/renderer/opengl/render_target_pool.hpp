@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+// include opengl deps
+#define GL_VERSION_4_4
+#include <GL/glew.h>
+
+#include "core/slot_map.hpp"
+#include "renderer/texture.hpp"
+#include "renderer/opengl/state_cache.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace opengl {
+
+// size & formats of a framebuffer, targets are only shared between identical descriptions
+struct RenderTargetDesc {
+    int width = 0;
+    int height = 0;
+    std::vector<TexPixelFormat> colorFormats = {};
+    TexPixelFormat depthFormat = TexPixelFormat::NONE;
+
+    bool operator==(const RenderTargetDesc& other) const = default;
+};
+
+// framebuffer with colour textures & a depth/stencil renderbuffer
+struct RenderTarget {
+    RenderTargetDesc desc = RenderTargetDesc();
+    GLuint framebuffer = 0;
+    std::vector<GLuint> colorTextures = {};
+    GLuint depthRenderbuffer = 0;
+    bool isInUse = false;
+    // frame it was last released, free targets idle too long are destroyed
+    int releasedFrame = 0;
+};
+
+/// TODO:
+// alias free targets of different formats but equal byte size
+// budget total pooled memory
+
+// reuses framebuffers & their attachments between acquires of matching descriptions
+// so transient targets don't allocate gpu memory every frame
+class RenderTargetPool {
+private:
+    // roughly 2 seconds, long enough to survive short gaps in use but frees sizes from before a resize
+    static constexpr int s_maxIdleFrames = 120;
+
+    struct PixelFormatInfo {
+        GLenum internalFormat = 0;
+        GLenum format = 0;
+        GLenum type = 0;
+        // depth/stencil only
+        GLenum attachment = 0;
+    };
+    static const std::unordered_map<TexPixelFormat, PixelFormatInfo> s_pixelFormatMap;
+
+    StateCache& _glState;
+    SlotMap<RenderTarget> _targets;
+    size_t _createdCount = 0;
+
+    // returns false if the framebuffer is incomplete, target is left empty
+    bool Create(RenderTarget& target);
+    void Destroy(RenderTarget& target);
+
+public:
+    RenderTargetPool(StateCache& glState);
+    ~RenderTargetPool();
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    // false if any format has no opengl equivalent or the size is invalid
+    static bool IsSupported(const RenderTargetDesc& desc);
+
+    // free target matching desc, creating one if none, invalid handle on failure
+    Handle Acquire(const RenderTargetDesc& desc);
+    void Release(Handle handle, int frameIndex);
+    // nullptr if handle is stale
+    const RenderTarget* Get(Handle handle) const;
+    // destroy free targets unused for too long, call once per frame
+    void Trim(int frameIndex);
+
+    size_t Size() const;
+    // total targets ever created, pooled reuse doesn't count
+    size_t GetCreatedCount() const;
+};
+
+} // opengl
+
+} // renderer
+
+} // marathon
@@ -7,10 +7,19 @@
 #define GL_VERSION_4_4
 #include <GL/glew.h>
 
+#include "core/slot_map.hpp"
 #include "renderer/mesh.hpp"
 #include "renderer/shader.hpp"
 #include "renderer/material.hpp"
+#include "renderer/frustum.hpp"
+#include "renderer/occlusion_culler.hpp"
 #include "renderer/renderer.hpp"
+#include "renderer/opengl/state_cache.hpp"
+#include "renderer/opengl/mesh_pool.hpp"
+#include "renderer/opengl/stream_buffer.hpp"
+#include "renderer/opengl/program_cache.hpp"
+#include "renderer/opengl/gpu_profiler.hpp"
+#include "renderer/opengl/render_target_pool.hpp"
 
 namespace marathon {
 
@@ -26,6 +35,59 @@ protected:
     static const std::string s_globalHeader;
     static const std::string s_vertexHeader;
     static const std::string s_fragmentHeader;
+    // reserved vertex attribute locations, instance_model occupies 4 consecutive locations
+    static constexpr GLuint s_instanceModelLocation = 8;
+    static constexpr GLuint s_instanceDataLocation = 12;
+    // sort key geometry bits of meshes not in a pool, keeps them after all pools
+    static constexpr uint32_t s_unpooledGeometryKey = 0x8000;
+    // initial bytes per frame region of stream buffers, grown on demand
+    static constexpr size_t s_instanceStreamSize = 4 << 20;
+    static constexpr size_t s_uploadStreamSize = 1 << 20;
+    static constexpr size_t s_uniformStreamSize = 1 << 20;
+    static constexpr size_t s_indirectStreamSize = 1 << 20;
+    // shortest run of pooled draws worth a multi-draw
+    static constexpr size_t s_minMultiDrawRun = 2;
+    // fixed uniform block binding points
+    static constexpr GLuint s_frameGlobalsBinding = 0;
+    static constexpr GLuint s_materialBinding = 1;
+    static const std::string s_materialBlockName;
+    // serial compiles per frame without parallel compile support
+    static constexpr int s_compileBudget = 2;
+    static const std::string s_placeholderVertexSource;
+    static const std::string s_placeholderFragmentSource;
+    // frames a visible object's query result is trusted before it is tested again
+    static constexpr int s_occlusionRetestInterval = 4;
+    // frames an object may go undrawn before its query is released
+    static constexpr int s_occlusionQueryLifetime = 60;
+    // frames a shader variant may go undrawn before its program is released
+    static constexpr int s_variantLifetime = 60;
+
+    // glsl declaration of a standard vertex attribute, fallback is used by variants for meshes without it
+    struct VertexAttributeDecl {
+        VertexAttribute attribute;
+        GLuint location;
+        const char* type;
+        const char* name;
+        const char* fallback;
+        const char* define;
+    };
+    static const std::vector<VertexAttributeDecl> s_vertexAttributeDecls;
+    // variant key is the mesh attribute mask in the low bits and material feature mask in the high bits
+    // the base handler of a shader only holds its users & variants, it has no program of its own
+    // all attributes & no features is the variant bound by SetShader
+    static const uint32_t s_allAttributesMask;
+
+    // cpu mirror of the std140 FrameGlobals block in s_globalHeader
+    struct FrameGlobals {
+        float view[16];
+        float projection[16];
+        float resolution[2];
+        float time;
+        float timeDelta;
+        int32_t frameIndex;
+        int32_t padding[3];
+    };
+    static_assert(sizeof(FrameGlobals) == 160, "FrameGlobals must match std140 layout");
 
     /// ---- User Object Handling ---
     /// TODO: implement InternalHandler as a base struct
@@ -33,25 +95,120 @@ protected:
         // hold reference to user struct
         std::shared_ptr<Mesh> mesh = nullptr;
         // opengl internal
-
+        // vao is shared with other meshes if pooled, vbo/ibo are only owned if not pooled
         GLuint vao = 0;
         GLuint vbo = 0;
         GLuint ibo = 0;
+        // index into mesh pools, -1 if mesh owns its buffers
+        int pool = -1;
+        MeshPool::Allocation allocation = MeshPool::Allocation();
+        // bit per VertexAttribute present, selects the shader variant
+        uint32_t attributeMask = 0;
+        // flush the mesh was last queued in, edits flush first if it is the current one
+        int queuedFlush = -1;
         // error state info
         std::string warnings = "";
         bool isValid = false;
     };
 
+    // reflected active uniform of a linked program
+    struct UniformInfo {
+        std::string name = "";
+        UniformId id = -1;
+        GLenum type = 0;
+        GLint location = -1;
+        GLint arraySize = 0;
+    };
+
+    // weak so a shader is released once only the renderer would reference it
+    struct ShaderUser {
+        int64_t uuid = 0;
+        std::weak_ptr<Shader> shader;
+    };
+
     struct ShaderHandler {
-        // hold reference to user struct
-        std::shared_ptr<Shader> shader = nullptr;
+        // shaders with identical sources, only set on the base handler
+        std::vector<ShaderUser> users;
+        uint64_t sourceKey = 0;
+        uint64_t variantKey = 0;
+        // variants are owned by their base handler, invalid if this is the base
+        // only variants have programs, each compiled when first requested
+        Handle base = Handle();
+        std::unordered_map<uint64_t, Handle> variants;
+        // frame a variant was last drawn with, unused variants are released e.g. after a feature mask change
+        int usedFrame = 0;
+        // requested explicitly e.g. precompiled or bound, kept until the shader is released
+        bool isPinned = false;
+        // assembled sources, kept only until compiled
+        std::string vSource = "";
+        std::string fSource = "";
+        ShaderStatus status = ShaderStatus::INVALID;
+        uint64_t cacheKey = 0;
         // opengl internal
         GLuint program = 0;
+        // in flight compile, deleted once linked
+        GLuint vShader = 0;
+        GLuint fShader = 0;
+        // reflected after link
+        std::vector<UniformInfo> uniforms;
+        // indexed by UniformId, -1 if program does not have the uniform
+        std::vector<GLint> uniformLocations;
+        // material uniform block, size 0 if program does not declare one
+        UniformBlockLayout materialBlock;
+        // equal for programs whose material blocks pack identically, so they can share material buffers
+        uint64_t materialBlockHash = 0;
+        // program reads instance_model, so multi-draw batches can carry per draw transforms
+        bool hasInstanceModel = false;
         // error state info
         std::string warnings = "";
         bool isValid = false;
     };
     
+    // query of a single object, identified by its mesh & occlusion id, or its mesh & model transform without one
+    struct OcclusionQueryHandler {
+        GLuint query = 0;
+        uint64_t key = 0;
+        // frame the query was last issued, -1 if never tested
+        int issuedFrame = -1;
+        int usedFrame = 0;
+        bool isResultPending = false;
+        // last result read back, untested objects are visible
+        bool isVisible = true;
+    };
+
+    // pending proxy draw of a queried object's bounds
+    struct OcclusionTest {
+        Handle query = Handle();
+        Bounds bounds = Bounds();
+        LA::mat4 model = LA::mat4();
+    };
+
+    // storage of a canvas, kept until the canvas is freed or its description changes
+    // transient canvases give theirs back to the pool every frame
+    struct CanvasTarget {
+        std::weak_ptr<Canvas> canvas;
+        Handle target = Handle();
+    };
+
+    // layout defined by ARB_multi_draw_indirect
+    struct DrawElementsIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // gpu copy of a material's uniform block, repacked only when the material version changes
+    // one per material & block layout so variants sharing a layout share the upload
+    struct MaterialBuffer {
+        std::weak_ptr<Material> material;
+        uint64_t layoutHash = 0;
+        uint32_t version = 0;
+        GLuint buffer = 0;
+        size_t size = 0;
+    };
+    
     /// OpenGL Enum Lookup Maps
     static const std::unordered_map<VertexAttributeFormat, GLenum> s_vertexAttrFormatMap;
     static const std::unordered_map<IndexFormat, GLenum> s_indexFormatMap;
@@ -68,24 +225,149 @@ protected:
     LA::mat4 _projection = LA::mat4();
     LA::mat4 _view = LA::mat4();
     std::stack<LA::mat4> _transforms;
-    /// TODO: consider alternative to raw ptr, could use int idxer
-    /// also move to RenderState
-    ShaderHandler* _shaderHandler = nullptr;
+    /// TODO: move to RenderState
+    Handle _shaderHandle = Handle();
+    // shadow copy of gl state, all state changes must go through it
+    StateCache _glState = StateCache();
+    // per instance data, streamed each flush
+    std::unique_ptr<StreamBuffer> _instanceStream = nullptr;
+    // instance data of the current flush, later writes may grow the stream into a new buffer
+    GLuint _instanceStreamBuffer = 0;
+    size_t _instanceStreamOffset = 0;
+    // staging for partial updates of non-static meshes
+    std::unique_ptr<StreamBuffer> _uploadStream = nullptr;
+    // uniform block data
+    std::unique_ptr<StreamBuffer> _uniformStream = nullptr;
+    // multi-draw commands, nullptr if multi-draw indirect is unsupported
+    std::unique_ptr<StreamBuffer> _indirectStream = nullptr;
+    GLint _uniformAlignment = 256;
+    // set when any FrameGlobals value changes, uploaded before the next submission
+    bool _isFrameGlobalsDirty = true;
+    // incremented by each flush that submits draws
+    int _flushIndex = 0;
+    // world space view volume, rebuilt lazily after the view or projection changes
+    Frustum _frustum = Frustum();
+    bool _isFrustumDirty = true;
+    // occluders of this frame, rasterised lazily at flush after the view or occluders change
+    OcclusionCuller _occlusionCuller = OcclusionCuller();
+    bool _isOcclusionDirty = true;
+    // gpu occlusion queries, conservative sample counting if supported
+    SlotMap<OcclusionQueryHandler> _occlusionQueries;
+    std::unordered_map<uint64_t, Handle> _occlusionLookup;
+    std::vector<OcclusionTest> _occlusionTests;
+    GLenum _occlusionQueryTarget = GL_ANY_SAMPLES_PASSED;
+    // unit box drawn in place of queried objects
+    std::shared_ptr<Mesh> _occlusionProxyMesh = nullptr;
+
+    // default uniform ids, interned on construction
+    UniformId _modelUniformId = -1;
 
 
-    /// TODO: replace vectors with ordered map
-    std::vector<MeshHandler> _meshHandlers;
-    std::vector<ShaderHandler> _shaderHandlers;
+    // handlers addressed by the handle stored on the user resource
+    SlotMap<MeshHandler> _meshHandlers;
+    SlotMap<ShaderHandler> _shaderHandlers;
+    // shared buffers of static meshes, one pool per vertex layout & index format
+    std::vector<std::unique_ptr<MeshPool>> _meshPools;
+    std::unordered_map<std::string, int> _meshPoolLookup;
+    // handlers with status COMPILING
+    std::vector<Handle> _pendingShaders;
+    bool _hasParallelCompile = false;
+    // drawn in place of shaders that are still compiling
+    std::shared_ptr<Shader> _placeholderShader = nullptr;
+    Handle _placeholderHandle = Handle();
+    // linked program binaries from previous runs
+    ProgramCache _programCache = ProgramCache();
+    GpuProfiler _gpuProfiler;
+    // framebuffers of canvases, keyed by canvas uuid
+    RenderTargetPool _renderTargetPool = RenderTargetPool(_glState);
+    std::unordered_map<int64_t, CanvasTarget> _canvasTargets;
+    std::shared_ptr<Canvas> _canvas = nullptr;
+    // window sized canvases are resized lazily on their next bind
+    int _windowWidth = 0;
+    int _windowHeight = 0;
+    // keyed by material uuid
+    // keyed by material uuid & block layout hash
+    std::unordered_map<uint64_t, MaterialBuffer> _materialBuffers;
+    // fallback lookup by resource uuid if the stored handle is stale
+    std::unordered_map<int64_t, Handle> _meshLookup;
+    std::unordered_map<int64_t, Handle> _shaderLookup;
+    // base shader handlers by source key, shared by all shaders with those sources
+    std::unordered_map<uint64_t, Handle> _programLookup;
 
     /// internal user struct handler methods
-    int CreateShaderHandler(std::shared_ptr<Shader> shader);
-    int FindOrCreateShaderHandler(std::shared_ptr<Shader> shader);
+    ShaderHandler BuildShaderHandler(std::shared_ptr<Shader> shader, uint64_t variantKey);
+    // declarations & defines prepended to user sources of a variant
+    std::string BuildVariantHeader(std::shared_ptr<Shader> shader, uint64_t variantKey, bool isVertex);
+    void StartShaderCompile(ShaderHandler& shaderHandler);
+    bool IsShaderCompileDone(const ShaderHandler& shaderHandler);
+    void FinishShaderCompile(ShaderHandler& shaderHandler);
+    void PollShaderCompiles(int budget);
+    static uint64_t MakeSourceKey(const Shader& shader);
+    Handle CreateShaderHandler(uint64_t sourceKey);
+    // add shader as a user of the handler of its sources, creating it if needed
+    Handle AttachShader(std::shared_ptr<Shader> shader);
+    void DetachShader(Handle handle, std::shared_ptr<Shader> shader);
+    Handle FindOrCreateShaderHandler(std::shared_ptr<Shader> shader);
+    // variants compile lazily on first draw, SetShader or precompile
+    // pinned variants aren't released when undrawn, for programs requested ahead of their draws
+    Handle FindOrCreateShaderVariant(std::shared_ptr<Shader> shader, uint64_t variantKey, bool isPinned = false);
+    static uint32_t MakeAttributeMask(const Mesh& mesh);
+    static uint64_t MakeVariantKey(const Material& material, uint32_t attributeMask);
+    void DestroyShaderHandler(ShaderHandler& shaderHandler);
+    // returns nullptr if no shader bound
+    ShaderHandler* GetBoundShaderHandler();
+    void ReflectUniforms(ShaderHandler& shaderHandler);
+    void ReflectMaterialBlock(ShaderHandler& shaderHandler);
+    bool IsReservedUniform(UniformId id) const;
+    // location of uniform in bound shader, -1 if not settable
+    GLint GetUniformLocation(UniformId id);
+
+    Handle CreateMeshHandler(std::shared_ptr<Mesh> mesh);
+    MeshHandler BuildMeshHandler(std::shared_ptr<Mesh> mesh);
+    // upload dirty ranges or rebuild if reallocated
+    void UpdateMeshHandler(MeshHandler& meshHandler);
+    void UploadBufferRange(GLuint buffer, size_t offset, const void* data, size_t size, bool isStaged);
+    Handle FindOrCreateMeshHandler(std::shared_ptr<Mesh> mesh);
+    void DestroyMeshHandler(MeshHandler& meshHandler);
+    // resolve vertex attribute pointers of mesh layout, appends any problems to warnings
+    std::vector<VertexBinding> GetVertexBindings(std::shared_ptr<Mesh> mesh, std::string& warnings);
+    // returns index of pool for mesh layout, creating it if needed
+    int FindOrCreateMeshPool(std::shared_ptr<Mesh> mesh, const std::vector<VertexBinding>& bindings);
 
-    int CreateMeshHandler(std::shared_ptr<Mesh> mesh);
-    int FindOrCreateMeshHandler(std::shared_ptr<Mesh> mesh);
+    // release handlers no longer referenced outside the renderer
+    void CollectHandlers();
+
+    // target matching the canvas' current description, nullptr if it can't be created
+    const RenderTarget* FindOrCreateCanvasTarget(std::shared_ptr<Canvas> canvas);
+    // give targets back to the pool, the bound canvas keeps its target
+    void ReleaseCanvasTargets(bool transientOnly);
+    void UpdateWindowSize();
     
-    bool SetDefaultUniforms();
+    // material overrides the mesh material if set
+    bool PrepareDrawCommand(std::shared_ptr<Mesh> mesh, const LA::mat4& model, DrawCommand& cmd, std::shared_ptr<Material> material = nullptr);
+    // true if the mesh bounds transformed by model are outside the view
+    bool IsCulled(const Mesh& mesh, const LA::mat4& model);
+    // drop queued draws hidden behind this frame's occluders
+    void CullOccluded();
+    Handle FindOrCreateOcclusionQuery(const Mesh& mesh, const LA::mat4& model, uint64_t occlusionId);
+    // read the query result if the gpu has it, never blocks
+    void PollOcclusionQuery(OcclusionQueryHandler& query);
+    // draw bounds proxies of objects due a test, after the flush so all its draws can occlude them
+    void SubmitOcclusionTests();
+    // true if the bounds transformed by model reach in front of the near plane
+    bool IsNearPlaneCrossed(const Bounds& bounds, const LA::mat4& model);
+    void EnableInstanceAttributes(const DrawCommand& cmd, bool enabled);
+    void EnableInstanceModel(GLuint buffer, size_t offset);
+    size_t CountMultiDrawRun(size_t start);
+    void SubmitMultiDraw(size_t start, size_t count);
+    // add submitted draw to triangle & vertex stats
+    void CountDraw(const Mesh& mesh, bool isIndexed, int instanceCount);
+
+    void UploadFrameGlobals();
+    bool SetModelUniform(const LA::mat4& model);
     bool SetMaterialUniforms(std::shared_ptr<Material> material);
+    // upload material block if stale and bind it, returns false if packing failed
+    bool BindMaterialBuffer(std::shared_ptr<Material> material, const ShaderHandler& shaderHandler);
 
     // internal opengl error state check methods
     bool CheckError();
@@ -112,7 +394,16 @@ public:
     void Clear(bool clearColor, bool clearStencil, bool clearDepth) override;
 
     /// --- Draw Calls ---
-    void Draw(std::shared_ptr<Mesh> mesh) override;
+    void Draw(std::shared_ptr<Mesh> mesh, uint64_t occlusionId = 0) override;
+    void DrawInstanced(std::shared_ptr<Mesh> mesh, std::span<const LA::mat4> transforms, std::span<const InstanceStream> streams = {}) override;
+    void DrawOccluder(std::shared_ptr<Mesh> mesh) override;
+    void Submit(std::span<const CommandList> lists) override;
+    void Flush() override;
+
+    /// --- Transforms ---
+    // flush queued draws so they keep the camera they were issued with
+    void SetProjection(const LA::mat4& proj) override;
+    void SetView(const LA::mat4& view) override;
 
     /// --- State Management ---
     void SetState(RendererState state) override;
@@ -144,12 +435,30 @@ public:
     void SetLineWidth(float width) override;
     void SetPointSize(float size) override;
     void SetIsWireframe(bool enabled) override;
+    // visibility
+    bool GetFrustumCulling() override;
+    void SetFrustumCulling(bool enabled) override;
+    bool GetOcclusionCulling() override;
+    void SetOcclusionCulling(bool enabled) override;
+    bool GetOcclusionQueries() override;
+    void SetOcclusionQueries(bool enabled) override;
     // bound active objects
+    std::shared_ptr<Canvas> GetCanvas() override;
     std::shared_ptr<renderer::Shader> GetShader() override;
+    void SetCanvas(std::shared_ptr<Canvas> canvas) override;
     void SetShader(std::shared_ptr<renderer::Shader> shader) override;
+    bool BindCanvasTexture(std::shared_ptr<Canvas> canvas, int attachment, int unit) override;
+
+    /// --- Shader Compilation ---
+    ShaderStatus GetShaderStatus(std::shared_ptr<Shader> shader) override;
+    ShaderStatus GetMaterialStatus(std::shared_ptr<Material> material, std::shared_ptr<Mesh> mesh) override;
+    int PrecompileMaterials(const std::vector<PrecompileRequest>& requests) override;
+    bool GetCompilePlaceholder() override;
+    void SetCompilePlaceholder(bool enabled) override;
 
     /// --- Shader Methods ---
     bool HasUniform(const std::string& key) override;
+    bool HasUniform(UniformId id) override;
 
     // single value uniforms
     bool SetUniform(const std::string& key, int value) override;
@@ -170,6 +479,31 @@ public:
     // uniform property
     bool SetUniform(const std::string& key, const UniformProperty& value) override;
 
+    // id uniforms
+    bool SetUniform(UniformId id, int value) override;
+    bool SetUniform(UniformId id, uint32_t value) override;
+    bool SetUniform(UniformId id, float value) override;
+    bool SetUniform(UniformId id, double value) override;
+    bool SetUniform(UniformId id, const LA::vec2& v) override;
+    bool SetUniform(UniformId id, const LA::vec3& v) override;
+    bool SetUniform(UniformId id, const LA::vec4& v) override;
+    bool SetUniform(UniformId id, const LA::mat2& m) override;
+    bool SetUniform(UniformId id, const LA::mat3& m) override;
+    bool SetUniform(UniformId id, const LA::mat4& m) override;
+    bool SetUniform(UniformId id, const UniformProperty& value) override;
+
+    /// --- Debug Info ---
+    RenderStats GetRenderStats() override;
+    void NextFrame() override;
+    void SetFrameTime(double time, double deltaTime) override;
+
+    /// --- Profiling ---
+    void BeginGpuZone(const std::string& name) override;
+    void EndGpuZone() override;
+    std::vector<std::string> GetGpuZoneNames() override;
+    std::vector<GpuZoneSample> GetGpuZoneHistory(const std::string& name) override;
+    bool ExportGpuZones(const std::filesystem::path& path) override;
+
 };
 
 } // opengl
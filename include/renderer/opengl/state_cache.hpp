@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+
+// include opengl deps
+#define GL_VERSION_4_4
+#include <GL/glew.h>
+
+namespace marathon {
+
+namespace renderer {
+
+namespace opengl {
+
+/// NOTE: every opengl state change in the backend must go through the cache otherwise it desyncs
+/// call Invalidate if state is changed externally e.g. by a third party lib (ImGui etc.)
+/// cached values start unknown so the first call of each is always issued
+
+// shadow copy of opengl context state, drops calls that would not change anything
+class StateCache {
+private:
+    static constexpr GLuint s_unknownName = 0xFFFFFFFF;
+    static constexpr GLenum s_unknownEnum = 0xFFFFFFFF;
+    static constexpr int s_unknownBool = -1;
+    static constexpr int s_maxTextureUnits = 16;
+    static constexpr int s_maxBufferTargets = 8;
+    static constexpr int s_maxCapabilities = 8;
+
+    // bound objects
+    GLuint _program = s_unknownName;
+    GLuint _vertexArray = s_unknownName;
+    GLuint _framebuffer = s_unknownName;
+    std::array<GLuint, s_maxBufferTargets> _buffers;
+    int _activeTexture = -1;
+    std::array<GLuint, s_maxTextureUnits> _textures;
+
+    // fixed function state
+    std::array<int, s_maxCapabilities> _capabilities;
+    GLenum _depthFunc = s_unknownEnum;
+    int _depthMask = s_unknownBool;
+    GLenum _cullFace = s_unknownEnum;
+    GLenum _frontFace = s_unknownEnum;
+    GLenum _blendSrc = s_unknownEnum;
+    GLenum _blendDst = s_unknownEnum;
+    GLenum _polygonMode = s_unknownEnum;
+    std::array<int, 4> _colorMask;
+    std::array<float, 4> _clearColor;
+    std::array<GLint, 4> _viewport;
+    float _lineWidth = -1.0f;
+    float _pointSize = -1.0f;
+
+    int _callsSkipped = 0;
+    // calls actually issued
+    int _programBinds = 0;
+    int _vertexArrayBinds = 0;
+    int _textureBinds = 0;
+
+    // returns -1 if target/capability is not tracked
+    static int BufferTargetIndex(GLenum target);
+    static int CapabilityIndex(GLenum cap);
+
+public:
+    StateCache();
+    ~StateCache() = default;
+
+    // forget all cached state, next call of each is always issued
+    void Invalidate();
+
+    // bound objects
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vao);
+    void BindBuffer(GLenum target, GLuint buffer);
+    // indexed binds also bind the generic target, so always issued & update its cached binding
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void BindTexture(int unit, GLenum target, GLuint texture);
+    // binds both draw & read targets
+    void BindFramebuffer(GLuint framebuffer);
+    GLuint GetProgram() const;
+    GLuint GetVertexArray() const;
+    // queries the context if not yet known
+    GLuint GetFramebuffer();
+
+    // deleting a bound object implicitly unbinds it
+    void OnDeleteProgram(GLuint program);
+    void OnDeleteVertexArray(GLuint vao);
+    void OnDeleteBuffer(GLuint buffer);
+    void OnDeleteTexture(GLuint texture);
+    void OnDeleteFramebuffer(GLuint framebuffer);
+
+    // fixed function state
+    void SetCapability(GLenum cap, bool enabled);
+    void DepthFunc(GLenum func);
+    void DepthMask(bool enabled);
+    void CullFace(GLenum face);
+    void FrontFace(GLenum winding);
+    void BlendFunc(GLenum src, GLenum dst);
+    void PolygonMode(GLenum mode);
+    void ColorMask(bool r, bool g, bool b, bool a);
+    void ClearColor(float r, float g, float b, float a);
+    void Viewport(GLint x, GLint y, GLint width, GLint height);
+    // queries the context if not yet known
+    std::array<GLint, 4> GetViewport();
+    void LineWidth(float width);
+    void PointSize(float size);
+
+    // number of gl calls dropped as redundant
+    int GetCallsSkipped() const;
+    // number of binds issued
+    int GetProgramBinds() const;
+    int GetVertexArrayBinds() const;
+    int GetTextureBinds() const;
+    // resets skipped & issued counts, call once per frame
+    void ResetCounters();
+};
+
+} // opengl
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// include opengl deps
+#define GL_VERSION_4_4
+#include <GL/glew.h>
+
+#include "renderer/opengl/state_cache.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace opengl {
+
+/// NOTE: data written is only valid until the region is reused, i.e. for the frame it was written in
+/// writes never overlap data the gpu may still be reading so no implicit driver syncs occur
+/// falls back to orphaning the buffer each frame without ARB_buffer_storage
+/// growing replaces the buffer mid frame, so GetBuffer must be read after each write
+/// earlier writes stay valid in the replaced buffer, which is kept until the gpu is done with it
+
+/// TODO:
+// allow regions to shrink after a spike in usage
+
+// ring of per frame regions for streaming dynamic data to the gpu
+// persistently mapped with a fence per region, the cpu only waits if it gets a full ring ahead
+class StreamBuffer {
+private:
+    static constexpr int s_regionCount = 3;
+    // wait on fences in chunks so long stalls can be logged
+    static constexpr GLuint64 s_fenceTimeout = 1000000; // 1ms in ns
+
+    StateCache& _glState;
+    GLenum _target = GL_ARRAY_BUFFER;
+    GLuint _buffer = 0;
+    size_t _regionSize = 0;
+    bool _isPersistent = false;
+    // base of persistent mapping, nullptr if orphaning
+    uint8_t* _mapped = nullptr;
+
+    int _region = 0;
+    // write head within current region
+    size_t _head = 0;
+    std::array<GLsync, s_regionCount> _fences = {};
+
+    // buffers replaced by growing, fenced at the end of the frame & deleted once signalled
+    struct RetiredBuffer {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+    };
+    std::vector<RetiredBuffer> _retired;
+
+    void Allocate(size_t regionSize);
+    void Release();
+    // replace the buffer without deleting it, draws may still be issued from it this frame
+    void Retire();
+    // fence buffers retired this frame & delete those the gpu is done with
+    void CollectRetired();
+    // blocks until the gpu is done with the region
+    void WaitForRegion(int region);
+
+public:
+    StreamBuffer(StateCache& glState, GLenum target, size_t regionSize);
+    ~StreamBuffer();
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // reserve size bytes in the current region, grows the buffer if the region is full
+    // returns pointer to write to, must be followed by Unmap before the data is used
+    void* Map(size_t size, size_t alignment, size_t& offset);
+    void Unmap();
+    // map, copy & unmap, returns byte offset of data in GetBuffer
+    size_t Write(const void* data, size_t size, size_t alignment = 16);
+
+    // fence current region and move to the next, call once all of a frame's draws are submitted
+    void NextFrame();
+
+    // buffer holding the most recent write
+    GLuint GetBuffer() const;
+    bool IsPersistent() const;
+    // bytes used of the current region
+    size_t GetUsed() const;
+};
+
+} // opengl
+
+} // renderer
+
+} // marathon
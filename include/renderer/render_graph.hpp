@@ -0,0 +1,160 @@
+#pragma once
+
+// PUBLIC HEADER
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "renderer/canvas.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+class Renderer;
+
+// how a pass treats the existing contents of the canvas it writes
+enum class LoadOp {
+    LOAD,       // keep previous contents, cleared anyway if there are none e.g. first write of a transient canvas
+    CLEAR,      // clear all attachments before the pass
+    DONT_CARE   // pass overwrites every pixel e.g. fullscreen post processing
+};
+
+// description of a canvas owned by the graph
+struct RenderGraphCanvasDesc {
+    // fixed size, ignored if window scale is positive
+    int width = 0;
+    int height = 0;
+    float windowScale = 1.0f;
+    std::vector<TexPixelFormat> colorFormats = { TexPixelFormat::RGBA_8u };
+    TexPixelFormat depthFormat = TexPixelFormat::DEPTH_24f_STENCIL_8u;
+
+    bool operator==(const RenderGraphCanvasDesc& other) const = default;
+};
+
+/// NOTE: passes are declared in frame order, each read sees the most recent earlier write of the canvas
+/// passes whose output never reaches the window, an imported canvas or a side effect pass are culled
+/// reads are bound to texture units in the order declared, shaders sample them with sampler uniforms set to the unit
+/// graph canvases are transient, any with the same description & disjoint lifetimes share one canvas
+
+/// TODO:
+// async compute & multiple queues once backends support them
+// alias graph canvases of different descriptions with equal memory size
+
+// declarative frame of passes, ordered, culled & bound on compile then submitted through a Renderer
+class RenderGraph {
+public:
+    using ResourceId = int;
+    using ExecuteFn = std::function<void(Renderer&)>;
+
+    // the window framebuffer, always available
+    static constexpr ResourceId WINDOW = 0;
+
+    // declares the canvases a pass reads & writes
+    class PassBuilder {
+    private:
+        RenderGraph& _graph;
+        int _pass;
+
+    public:
+        PassBuilder(RenderGraph& graph, int pass);
+
+        // colour attachment of canvas sampled by the pass
+        PassBuilder& Read(ResourceId resource, int attachment = 0);
+        // a pass draws to a single canvas, multiple attachments are written through the canvas formats
+        PassBuilder& Write(ResourceId resource, LoadOp load = LoadOp::LOAD);
+        // keep the pass even if nothing reads its output e.g. readbacks or profiling
+        PassBuilder& SetSideEffects(bool hasSideEffects);
+    };
+
+private:
+    struct Resource {
+        std::string name = "";
+        RenderGraphCanvasDesc desc = RenderGraphCanvasDesc();
+        // set for imported canvases, graph canvases are assigned on compile
+        std::shared_ptr<Canvas> canvas = nullptr;
+        bool isImported = false;
+    };
+
+    struct ReadAccess {
+        ResourceId resource = WINDOW;
+        int attachment = 0;
+    };
+
+    struct Pass {
+        std::string name = "";
+        ExecuteFn execute = nullptr;
+        std::vector<ReadAccess> reads;
+        ResourceId write = -1;
+        LoadOp load = LoadOp::LOAD;
+        bool hasSideEffects = false;
+    };
+
+    // compiled pass, ready to submit
+    struct Step {
+        int pass = 0;
+        std::shared_ptr<Canvas> target = nullptr;
+        bool clearColor = false;
+        bool clearDepth = false;
+        bool clearStencil = false;
+    };
+
+    // canvas shared by graph canvases of the same description
+    struct PhysicalCanvas {
+        RenderGraphCanvasDesc desc = RenderGraphCanvasDesc();
+        std::shared_ptr<Canvas> canvas = nullptr;
+        // last step using it in the compiled order, -1 if unused
+        int lastUse = -1;
+    };
+
+    std::vector<Resource> _resources;
+    std::vector<Pass> _passes;
+    std::vector<Step> _steps;
+    std::vector<std::string> _culledPasses;
+    // kept between compiles so recompiling doesn't reallocate
+    std::vector<PhysicalCanvas> _physicalCanvases;
+    bool _isCompiled = false;
+
+    // pass -> passes it must run after, data edges carry content, order edges only prevent hazards
+    void BuildEdges(std::vector<std::vector<int>>& dataEdges, std::vector<std::vector<int>>& orderEdges) const;
+    // marks passes reachable from outputs through data edges
+    std::vector<bool> FindLivePasses(const std::vector<std::vector<int>>& dataEdges) const;
+    // live passes in dependency order, preferring to keep passes writing the same canvas adjacent
+    bool SortPasses(const std::vector<bool>& isLive, const std::vector<std::vector<int>>& dataEdges,
+        const std::vector<std::vector<int>>& orderEdges, std::vector<int>& order) const;
+    void AssignCanvases(const std::vector<int>& order);
+    void BuildSteps(const std::vector<int>& order);
+
+public:
+    RenderGraph();
+    ~RenderGraph() = default;
+
+    // graph owned canvas, only valid during the frame
+    ResourceId CreateCanvas(const std::string& name, const RenderGraphCanvasDesc& desc);
+    // canvas whose contents outlive the frame, its last writer is never culled
+    // earlier writers are culled unless a later pass loads or reads what they wrote
+    ResourceId ImportCanvas(const std::string& name, std::shared_ptr<Canvas> canvas);
+    // declare reads & writes with the returned builder, execute issues the draws
+    PassBuilder AddPass(const std::string& name, ExecuteFn execute);
+
+    // order, cull & assign canvases, returns false if a pass has no target or passes depend on each other
+    bool Compile();
+    // compiles if needed then submits the passes, the previously bound canvas is restored after
+    void Execute(Renderer& renderer);
+    // remove all passes & resources, physical canvases are kept for reuse
+    void Reset();
+
+    // compiled pass names in submission order
+    std::vector<std::string> GetExecutionOrder() const;
+    const std::vector<std::string>& GetCulledPasses() const;
+    // canvases actually allocated for graph canvases
+    size_t GetPhysicalCanvasCount() const;
+    // canvas a resource is drawn to, nullptr for the window or before compile
+    std::shared_ptr<Canvas> GetCanvas(ResourceId resource) const;
+};
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,94 @@
+#pragma once
+
+// PUBLIC HEADER
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "renderer/mesh.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+// per frame
+struct RenderStats {
+    int frameIndex = 0;
+    int drawCalls = 0;
+    // draws rejected on the cpu before being queued
+    int drawsCulled = 0;
+    // queued draws hidden behind occluders or by occlusion query results
+    int drawsOccluded = 0;
+    // gpu occlusion queries issued, and results read back as visible (hits) or hidden (misses)
+    int occlusionQueries = 0;
+    int occlusionQueryHits = 0;
+    int occlusionQueryMisses = 0;
+    // counted from index count & primitive type, multiplied by instance count
+    int trianglesRendered = 0;
+    int verticesRendered = 0;
+    // program/material/mesh changes avoided by sorting the draw queue
+    int stateChangesSaved = 0;
+    // redundant gl state calls dropped by the backend
+    int stateCallsSkipped = 0;
+    // binds actually issued
+    int programBinds = 0;
+    int vertexArrayBinds = 0;
+    int textureBinds = 0;
+    // individual uniforms & uniform blocks written
+    int uniformUploads = 0;
+    // all buffer data sent to the gpu, including streamed instance & uniform data
+    int64_t bytesUploaded = 0;
+    // backend mesh & shader handlers created, i.e. uploads & compiles
+    int handlersCreated = 0;
+};
+
+struct RenderStatsSummary {
+    double min = 0.0;
+    double avg = 0.0;
+    double p95 = 0.0;
+    double max = 0.0;
+};
+
+// triangles drawn by count vertices or indices of the primitive type
+int CountTriangles(PrimitiveType primitive, int count);
+
+/// NOTE: fixed capacity, once full the oldest frame is overwritten so it never allocates after construction
+
+// ring of the stats of the most recent frames
+class RenderStatsHistory {
+private:
+    std::vector<RenderStats> _frames;
+    // index of the oldest frame
+    size_t _head = 0;
+    size_t _size = 0;
+
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 300;
+
+    explicit RenderStatsHistory(size_t capacity = DEFAULT_CAPACITY);
+    ~RenderStatsHistory() = default;
+
+    void Push(const RenderStats& stats);
+    void Clear();
+    size_t Size() const;
+    size_t Capacity() const;
+    // 0 is the oldest frame
+    const RenderStats& Get(size_t index) const;
+
+    // names of the numeric RenderStats fields, as used in summaries & exports
+    static const std::vector<std::string>& GetFieldNames();
+    // zeroed if the field is unknown or the history is empty
+    RenderStatsSummary Summarize(const std::string& field) const;
+
+    // one row per frame, oldest first
+    bool ExportCsv(const std::filesystem::path& path) const;
+    // frames & summaries of every field
+    bool ExportJson(const std::filesystem::path& path) const;
+};
+
+} // renderer
+
+} // marathon
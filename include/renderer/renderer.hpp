@@ -8,6 +8,9 @@
 #include <vector>
 #include <memory>
 #include <stack>
+#include <span>
+#include <filesystem>
+#include <unordered_map>
 
 // includes
 #include "la_extended.h"
@@ -15,6 +18,11 @@
 #include "renderer/mesh.hpp"
 #include "renderer/material.hpp"
 #include "renderer/shader.hpp"
+#include "renderer/canvas.hpp"
+#include "renderer/draw_queue.hpp"
+#include "renderer/command_list.hpp"
+#include "renderer/frame_packet.hpp"
+#include "renderer/render_stats.hpp"
 
 namespace marathon {
 
@@ -62,11 +70,19 @@ enum class DrawMode {
     FILL
 };
 
-// per frame
-struct RenderStats {
+// interned uniform name, stable across all shaders for the lifetime of the renderer
+// -1 : invalid/unknown
+typedef int UniformId;
+
+// timings of one profiling zone in one frame, in milliseconds
+struct GpuZoneSample {
+    std::string name = "";
     int frameIndex = 0;
-    int drawCalls = 0;
-    int trianglesRendered = 0;
+    // nesting level, 0 for top level zones
+    int depth = 0;
+    double gpuTime = 0.0;
+    // cpu time between begin & end, including submitting queued draws
+    double cpuTime = 0.0;
 };
 
 struct RendererState {
@@ -81,6 +97,21 @@ struct RendererState {
     float lineWidth = 1.0f;
     float pointSize = 1.0f;
     bool isWireframe = false;
+    // draw shaders still compiling with a placeholder rather than skipping them
+    bool compilePlaceholder = true;
+    // skip draws whose mesh bounds are outside the view
+    bool frustumCulling = true;
+    // skip draws hidden behind occluders submitted with DrawOccluder
+    bool occlusionCulling = false;
+    // skip draws of meshes flagged for occlusion queries while the gpu reports them hidden
+    bool occlusionQueries = true;
+};
+
+// a material & a mesh it will draw, selects the program to compile ahead of the first draw
+struct PrecompileRequest {
+    std::shared_ptr<Material> material = nullptr;
+    // only the vertex layout is read, the mesh isn't uploaded
+    std::shared_ptr<Mesh> mesh = nullptr;
 };
 
 struct TransformState {
@@ -90,13 +121,30 @@ struct TransformState {
     
 };
 
+// implementation created by Renderer::Instance
+enum class RendererBackend {
+    OPENGL,
+    // records calls without a gpu, for benchmarking & ci
+    HEADLESS
+};
+
 // forward declarations
 
 class Renderer : public Module {
 protected:
     RendererState _state = RendererState();
     RenderStats _stats = RenderStats();
+    RenderStatsHistory _statsHistory = RenderStatsHistory();
     TransformState _transforms = TransformState();
+    DrawQueue _drawQueue = DrawQueue();
+    // time of the frame being submitted, set from frame packets recorded on another thread
+    bool _hasFrameTime = false;
+    double _frameTime = 0.0;
+    double _frameDeltaTime = 0.0;
+
+    // uniform name interning, ids index into _uniformNames
+    std::unordered_map<std::string, UniformId> _uniformIds;
+    std::vector<std::string> _uniformNames;
 
     Renderer(const std::string& name);
     
@@ -104,6 +152,9 @@ public:
     virtual ~Renderer() = default;
 
     static Renderer& Instance();
+    // must be called before the first Instance call, returns false once the instance exists
+    // defaults to OPENGL, or HEADLESS if MARATHON_RENDERER=headless is set in the environment
+    static bool SetBackend(RendererBackend backend);
 
     // module interface
     virtual bool Boot() = 0;
@@ -124,8 +175,26 @@ public:
     // virtual void Draw2DRectangle() = 0;
 
     // // Draw3D
-    virtual void Draw(std::shared_ptr<Mesh> mesh) = 0;
+    // queues mesh to be drawn with the current model transform
+    // occlusionId identifies the object between frames for gpu occlusion queries, see Mesh::SetOcclusionQuery
+    // 0 identifies it by mesh & model transform, so moving objects drawn with queries should pass an id
+    virtual void Draw(std::shared_ptr<Mesh> mesh, uint64_t occlusionId = 0) = 0;
+    // queues mesh to be drawn once per transform, each relative to the current model transform
+    // streams must contain one element per transform
+    // NOTE: shaders must apply the instance_model vertex attribute for transforms to have an effect
+    virtual void DrawInstanced(std::shared_ptr<Mesh> mesh, std::span<const LA::mat4> transforms, std::span<const InstanceStream> streams = {}) = 0;
     // virtual void DrawCube() = 0;
+    // mesh hides draws behind it this frame with the current model transform, it is not drawn itself
+    // should be a simplified mesh lying inside the visible geometry it stands in for
+    virtual void DrawOccluder(std::shared_ptr<Mesh> mesh) = 0;
+    // queue the draws of lists recorded on other threads, in list order, must be called on the render thread
+    // lists are only read so can be reset & recorded again once this returns
+    virtual void Submit(std::span<const CommandList> lists) = 0;
+    // apply the packet's camera, clear & frame time then queue its lists, must be called on the render thread
+    void SubmitFrame(const FramePacket& packet);
+
+    // sort and submit all queued draws, called before the frame is swapped
+    virtual void Flush() = 0;
 
     /// --- State Management ---
     virtual void SetState(RendererState state) = 0;
@@ -157,11 +226,36 @@ public:
     virtual void SetLineWidth(float width) = 0;
     virtual void SetPointSize(float size) = 0;
     virtual void SetIsWireframe(bool enabled) = 0;
+    // visibility
+    virtual bool GetFrustumCulling() = 0;
+    virtual void SetFrustumCulling(bool enabled) = 0;
+    virtual bool GetOcclusionCulling() = 0;
+    virtual void SetOcclusionCulling(bool enabled) = 0;
+    virtual bool GetOcclusionQueries() = 0;
+    virtual void SetOcclusionQueries(bool enabled) = 0;
     // bound objects
-    // virtual std::shared_ptr<Canvas> GetCanvas() = 0;
+    // nullptr if drawing to the window
+    virtual std::shared_ptr<Canvas> GetCanvas() = 0;
     virtual std::shared_ptr<Shader> GetShader() = 0;
-    // virtual void SetCanvas(std::shared_ptr<Canvas> canvas) = 0;
+    // draws go to canvas until unbound with nullptr, the viewport is set to the canvas size
+    virtual void SetCanvas(std::shared_ptr<Canvas> canvas) = 0;
     virtual void SetShader(std::shared_ptr<Shader> shader) = 0;
+    // bind a colour attachment of canvas to a texture unit, set the shader's sampler uniform to the unit
+    // returns false if canvas is the bound canvas, as sampling it while drawing to it is undefined
+    virtual bool BindCanvasTexture(std::shared_ptr<Canvas> canvas, int attachment, int unit) = 0;
+
+    /// --- Shader Compilation ---
+    // shaders compile asynchronously on first use, draws are skipped or use a placeholder until READY
+    // backends may compile a program per material & mesh layout, so a shader can have several
+    // FAILED if any of the shader's programs failed, COMPILING if any are compiling, INVALID if none are requested yet
+    virtual ShaderStatus GetShaderStatus(std::shared_ptr<Shader> shader) = 0;
+    // status of the program drawing mesh with material, requesting its compile if needed
+    virtual ShaderStatus GetMaterialStatus(std::shared_ptr<Material> material, std::shared_ptr<Mesh> mesh) = 0;
+    // submit compiles of the programs drawing each mesh with its material, returns number still compiling
+    // call once per frame e.g. during a loading screen until it returns 0
+    virtual int PrecompileMaterials(const std::vector<PrecompileRequest>& requests) = 0;
+    virtual bool GetCompilePlaceholder() = 0;
+    virtual void SetCompilePlaceholder(bool enabled) = 0;
 
     /// --- Coordinate System Transformations ---
     // camera and screen transformations
@@ -183,7 +277,15 @@ public:
     // virtual LA::vec2 GlobalToScreen(const LA::vec3& point);
 
     /// --- Shader Methods ---
+    // get id for uniform name, interning it if not seen before
+    UniformId GetUniformId(const std::string& key);
+    // get id for uniform name without interning, returns -1 if unknown
+    UniformId FindUniformId(const std::string& key) const;
+    // get uniform name of id, returns empty string if invalid
+    const std::string& GetUniformName(UniformId id) const;
+
     virtual bool HasUniform(const std::string& key) = 0;
+    virtual bool HasUniform(UniformId id) = 0;
 
     // single value uniforms
     virtual bool SetUniform(const std::string& key, int value) = 0;
@@ -203,10 +305,37 @@ public:
     virtual bool SetUniform(const std::string& key, const LA::mat4& m) = 0;
     // uniform property
     virtual bool SetUniform(const std::string& key, const UniformProperty& value) = 0;
+
+    // id uniforms, no string lookups so prefered for hot code
+    virtual bool SetUniform(UniformId id, int value) = 0;
+    virtual bool SetUniform(UniformId id, uint32_t value) = 0;
+    virtual bool SetUniform(UniformId id, float value) = 0;
+    virtual bool SetUniform(UniformId id, double value) = 0;
+    virtual bool SetUniform(UniformId id, const LA::vec2& v) = 0;
+    virtual bool SetUniform(UniformId id, const LA::vec3& v) = 0;
+    virtual bool SetUniform(UniformId id, const LA::vec4& v) = 0;
+    virtual bool SetUniform(UniformId id, const LA::mat2& m) = 0;
+    virtual bool SetUniform(UniformId id, const LA::mat3& m) = 0;
+    virtual bool SetUniform(UniformId id, const LA::mat4& m) = 0;
+    virtual bool SetUniform(UniformId id, const UniformProperty& value) = 0;
     
     /// --- Debug Info ---
     virtual RenderStats GetRenderStats();
+    // completed frames, the current frame is pushed by NextFrame
+    const RenderStatsHistory& GetRenderStatsHistory() const;
     virtual void NextFrame();
+    // time used for the frame globals until the next frame, otherwise the time module is read
+    virtual void SetFrameTime(double time, double deltaTime);
+
+    /// --- Profiling ---
+    // zones nest & flush queued draws so their gpu work is attributed to the zone they were drawn in
+    virtual void BeginGpuZone(const std::string& name) = 0;
+    virtual void EndGpuZone() = 0;
+    // results arrive a few frames after the zone, oldest first
+    virtual std::vector<std::string> GetGpuZoneNames() = 0;
+    virtual std::vector<GpuZoneSample> GetGpuZoneHistory(const std::string& name) = 0;
+    // csv of gpu & cpu times of every zone in history
+    virtual bool ExportGpuZones(const std::filesystem::path& path) = 0;
 
 };
 
@@ -7,6 +7,7 @@
 #include <fstream>
 #include <sstream>
 #include <memory>
+#include <vector>
 
 #include "la_extended.h"
 #include "core/resource.hpp"
@@ -34,6 +35,10 @@ namespace renderer {
 // materials (uniforms) must match the shader's uniforms
 // NOTE: unity uses multiple shader variances per possible missing vertex attribute and checks at runtime which to use according to mesh data available
 
+/// NOTE: backends compile a variant per combination of mesh vertex attributes and enabled features actually drawn
+/// each present attribute defines VERTEX_HAS_<ATTRIBUTE> e.g. VERTEX_HAS_NORMAL, missing attributes are constants
+/// enabled features are defined by name, features are enabled per material
+
 enum class ShaderDirty {
     INVALID,
     DIRTY_COMPILE,
@@ -41,10 +46,20 @@ enum class ShaderDirty {
     CLEAN
 };
 
+// backend compile state of a shader
+enum class ShaderStatus {
+    INVALID,
+    COMPILING,
+    READY,
+    FAILED
+};
+
 class Shader : public Resource {
 protected:
     std::string _vSrc = "";
     std::string _fSrc = "";
+    // optional #define flags, a variant is compiled per combination used
+    std::vector<std::string> _features = {};
     ShaderDirty _dirty = ShaderDirty::INVALID;
  
 public:
@@ -65,6 +80,13 @@ public:
     void SetFragmentSource(const std::string& fSrc);
     void SetSources(const std::string& vSrc, const std::string& fSrc);
 
+    // variant keys hold a bit per feature
+    static constexpr int MAX_FEATURES = 32;
+    const std::vector<std::string>& GetFeatures() const;
+    // returns -1 if feature not declared
+    int GetFeatureIndex(const std::string& feature) const;
+    // replaces declared features, recompiles all variants
+    void SetFeatures(const std::vector<std::string>& features);
 };
 
 }
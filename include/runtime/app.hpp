@@ -1,5 +1,8 @@
 #pragma once
 
+#include "runtime/frame_pipeline.hpp"
+#include "renderer/frame_packet.hpp"
+
 namespace marathon {
     
 class App {
@@ -7,6 +10,13 @@ private:
     bool _mQuit = false;
     bool _mFailed = false;
 
+    // frames rendering may lag the simulation, 0 renders each frame straight after its update
+    int _mFrameLatency = 0;
+    FramePipeline _mPipeline;
+    // packet of the frame being updated, rendered on this thread when not pipelined
+    renderer::FramePacket _mPacket;
+    renderer::FramePacket* _mFramePacket = nullptr;
+
 protected:
     App();
     ~App();
@@ -19,6 +29,21 @@ public:
     void Run();
     void Quit();
 
+    /// NOTE: with a latency of 1 or 2 Update overlaps rendering of earlier frames on a render thread
+    /// so Update must record draws into the frame packet instead of calling the Renderer
+    /// the render thread owns the context & swaps, which macOS doesn't allow, so latency stays 0 there
+    /// at latency 0 the packet is submitted after Update too, so a packet camera or clear is applied after
+    /// any draws made through the Renderer during Update, which are then drawn with the old camera & cleared
+    /// draws made through the Renderer directly are only supported if the packet sets neither
+    // set before Run or in Start, ignored after
+    void SetFrameLatency(int latency);
+    int GetFrameLatency() const;
+    // only valid during Update
+    renderer::FramePacket& GetFramePacket();
+    // blocks until the frame recorded with frameIndex has been rendered & swapped
+    // meshes & materials it drew may be modified after, earlier frames are always already rendered at latency 0
+    void WaitFrameSubmitted(int frameIndex);
+
     // virtual methods for user to implement
     virtual void Start() = 0;
     virtual void Update(double deltaTime) = 0;
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "renderer/frame_packet.hpp"
+
+namespace marathon {
+
+/// NOTE: packets form a ring of latency + 1 so the simulation never writes a packet being submitted
+/// the graphics context is owned by the render thread between Start & Stop, which also swaps
+/// macOS only allows the main thread to present so pipelining isn't supported there
+
+/// TODO:
+// pace the simulation against display refresh rather than only the render thread
+
+// runs submission of frame packets on a render thread while the next frames are recorded
+class FramePipeline {
+public:
+    static constexpr int MAX_LATENCY = 2;
+    using SubmitFn = std::function<void(const renderer::FramePacket&)>;
+
+private:
+    std::vector<renderer::FramePacket> _packets;
+    SubmitFn _submit = nullptr;
+    int _latency = 0;
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    // frames handed to & finished by the render thread
+    int _recorded = 0;
+    int _submitted = 0;
+    bool _isRecording = false;
+    bool _isStopping = false;
+    // render thread acquired the context, -1 until it has tried
+    int _contextState = -1;
+
+    void RenderLoop();
+
+public:
+    FramePipeline() = default;
+    ~FramePipeline();
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // move the context to a new render thread, returns false & keeps it if the thread can't acquire it
+    bool Start(int latency, SubmitFn submit);
+    // submit all recorded frames then return the context to the calling thread
+    void Stop();
+    bool IsRunning() const;
+    int GetLatency() const;
+
+    // blocks while the render thread is more than latency frames behind, packet is reset
+    renderer::FramePacket& BeginFrame();
+    // hand the packet from BeginFrame to the render thread
+    void EndFrame();
+
+    // frames the render thread has finished submitting, frame i is submitted once this is above i
+    int GetSubmittedCount();
+    // blocks until the packet with frameIndex has been submitted & swapped
+    // after which the meshes & materials it recorded may be modified, false if the frame was never handed over
+    bool WaitSubmitted(int frameIndex);
+};
+
+} // marathon
@@ -55,6 +55,8 @@ public:
     SDL_Window* GetWindow();
 
     void SwapFrame() override;
+    bool AcquireContext() override;
+    bool ReleaseContext() override;
 
     // properties
     void SetWindowMinSize(int minWidth, int minHeight) override;
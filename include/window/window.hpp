@@ -39,6 +39,10 @@ public:
 
     // common
     virtual void SwapFrame() = 0;
+    // make the graphics context current on the calling thread, it must be released by its previous thread first
+    virtual bool AcquireContext() = 0;
+    // detach the graphics context from the calling thread so another can acquire it
+    virtual bool ReleaseContext() = 0;
     
     // properties
     virtual void SetWindowMinSize(int minWidth, int minHeight) = 0;
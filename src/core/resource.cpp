@@ -5,4 +5,7 @@ namespace marathon {
 Resource::Resource(const std::string& type)
     : Object(type) {}
 
+Handle Resource::GetRendererHandle() const { return _mRendererHandle; }
+void Resource::SetRendererHandle(Handle handle) { _mRendererHandle = handle; }
+
 } // marathon
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "renderer/canvas.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/logger.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+bool IsColorFormat(TexPixelFormat format) {
+    switch (format) {
+        case TexPixelFormat::R_8u:
+        case TexPixelFormat::RG_8u:
+        case TexPixelFormat::RGB_8u:
+        case TexPixelFormat::RGB_16f:
+        case TexPixelFormat::RGB_32f:
+        case TexPixelFormat::RGBA_8u:
+        case TexPixelFormat::RGBA_16f:
+        case TexPixelFormat::RGBA_32f:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool IsDepthFormat(TexPixelFormat format) {
+    switch (format) {
+        case TexPixelFormat::DEPTH_24f_STENCIL_8u:
+        case TexPixelFormat::DEPTH_16f:
+        case TexPixelFormat::DEPTH_24f:
+        case TexPixelFormat::DEPTH_32f:
+        case TexPixelFormat::STENCIL_1u:
+        case TexPixelFormat::STENCIL_2u:
+        case TexPixelFormat::STENCIL_8u:
+            return true;
+        default:
+            return false;
+    }
+}
+
+Canvas::Canvas()
+    : Resource("marathon.renderer.canvas") {}
+
+Canvas::Canvas(int width, int height)
+    : Resource("marathon.renderer.canvas") {
+    SetSize(width, height);
+}
+
+Canvas::~Canvas() {}
+
+int Canvas::GetWidth() const {
+    return IsWindowSized() ? 0 : _width;
+}
+
+int Canvas::GetHeight() const {
+    return IsWindowSized() ? 0 : _height;
+}
+
+void Canvas::SetSize(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        MT_CORE_WARN("Canvas::SetSize: invalid size {}x{}", width, height);
+        return;
+    }
+    _width = width;
+    _height = height;
+    _windowScale = 0.0f;
+}
+
+void Canvas::GetPixelSize(int windowWidth, int windowHeight, int& width, int& height) const {
+    if (!IsWindowSized()) {
+        width = _width;
+        height = _height;
+        return;
+    }
+    // never 0 so a minimised window still has valid storage
+    width = std::max((int)std::round(windowWidth * _windowScale), 1);
+    height = std::max((int)std::round(windowHeight * _windowScale), 1);
+}
+
+float Canvas::GetWindowScale() const {
+    return _windowScale;
+}
+
+void Canvas::SetWindowScale(float scale) {
+    if (scale <= 0.0f) {
+        MT_CORE_WARN("Canvas::SetWindowScale: scale must be positive, use SetSize for a fixed size");
+        return;
+    }
+    _windowScale = scale;
+}
+
+bool Canvas::IsWindowSized() const {
+    return _windowScale > 0.0f;
+}
+
+const std::vector<TexPixelFormat>& Canvas::GetColorFormats() const {
+    return _colorFormats;
+}
+
+bool Canvas::SetColorFormats(const std::vector<TexPixelFormat>& formats) {
+    if (formats.empty() || formats.size() > MAX_COLOR_ATTACHMENTS) {
+        MT_CORE_WARN("Canvas::SetColorFormats: requires 1 to {} formats", MAX_COLOR_ATTACHMENTS);
+        return false;
+    }
+    if (!std::all_of(formats.begin(), formats.end(), IsColorFormat)) {
+        MT_CORE_WARN("Canvas::SetColorFormats: not a colour format");
+        return false;
+    }
+    _colorFormats = formats;
+    return true;
+}
+
+TexPixelFormat Canvas::GetDepthFormat() const {
+    return _depthFormat;
+}
+
+bool Canvas::SetDepthFormat(TexPixelFormat format) {
+    if (format != TexPixelFormat::NONE && !IsDepthFormat(format)) {
+        MT_CORE_WARN("Canvas::SetDepthFormat: not a depth/stencil format");
+        return false;
+    }
+    _depthFormat = format;
+    return true;
+}
+
+TexFilter Canvas::GetFilter() const {
+    return _filter;
+}
+
+void Canvas::SetFilter(TexFilter filter) {
+    _filter = filter;
+}
+
+bool Canvas::GetTransient() const {
+    return _isTransient;
+}
+
+void Canvas::SetTransient(bool isTransient) {
+    _isTransient = isTransient;
+}
+
+} // renderer
+
+} // marathon
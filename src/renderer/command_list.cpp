@@ -0,0 +1,260 @@
+#include "renderer/command_list.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/hash.hpp"
+#include "core/logger.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace {
+
+// all alternatives are trivially copyable so compare & hash bytes, avoids relying on LA equality
+bool IsSameProperty(const UniformProperty& a, const UniformProperty& b) {
+    if (a.index() != b.index())
+        return false;
+    return std::visit([&b](const auto& value) {
+        using T = std::decay_t<decltype(value)>;
+        return std::memcmp(&value, &std::get<T>(b), sizeof(T)) == 0;
+    }, a);
+}
+
+uint64_t HashProperty(const UniformProperty& property, uint64_t seed) {
+    size_t index = property.index();
+    seed = HashBytes(&index, sizeof(index), seed);
+    return std::visit([seed](const auto& value) {
+        return HashBytes(&value, sizeof(value), seed);
+    }, property);
+}
+
+} // namespace
+
+/// --- Recording ---
+void CommandList::Draw(std::shared_ptr<Mesh> mesh, uint64_t occlusionId) {
+    if (mesh == nullptr) {
+        MT_CORE_WARN("CommandList::Draw: mesh is null");
+        return;
+    }
+    LA::mat4 model = GetModel();
+    if (_hasFrustum && !_frustum.IsVisible(mesh->GetBounds(), model)) {
+        _culledCount++;
+        return;
+    }
+    Entry entry = Entry();
+    entry.material = ResolveMaterial(mesh->GetMaterial());
+    entry.mesh = std::move(mesh);
+    entry.model = model;
+    entry.occlusionId = occlusionId;
+    _entries.push_back(std::move(entry));
+}
+
+void CommandList::DrawInstanced(std::shared_ptr<Mesh> mesh, std::span<const LA::mat4> transforms, std::span<const InstanceStream> streams) {
+    if (mesh == nullptr) {
+        MT_CORE_WARN("CommandList::DrawInstanced: mesh is null");
+        return;
+    }
+    if (transforms.empty())
+        return;
+
+    // validate streams before copying anything
+    const InstanceStream* slots[InstanceStream::MAX_SLOTS] = {};
+    for (const InstanceStream& stream : streams) {
+        if (stream.slot < 0 || stream.slot >= InstanceStream::MAX_SLOTS) {
+            MT_CORE_WARN("CommandList::DrawInstanced: instance stream slot {} out of range", stream.slot);
+            continue;
+        }
+        if (stream.data.size() != transforms.size()) {
+            MT_CORE_WARN("CommandList::DrawInstanced: instance stream slot {} size does not match instance count", stream.slot);
+            continue;
+        }
+        slots[stream.slot] = &stream;
+    }
+
+    Entry entry = Entry();
+    entry.material = ResolveMaterial(mesh->GetMaterial());
+    entry.mesh = std::move(mesh);
+    entry.model = GetModel();
+    entry.instanceCount = transforms.size();
+    entry.instanceOffset = PushInstanceData(transforms.data(), transforms.size_bytes());
+    for (int slot = 0; slot < InstanceStream::MAX_SLOTS; slot++) {
+        if (slots[slot] == nullptr)
+            continue;
+        PushInstanceData(slots[slot]->data.data(), slots[slot]->data.size_bytes());
+        entry.instanceStreamMask |= 1 << slot;
+    }
+    entry.instanceSize = _instanceData.size() - entry.instanceOffset;
+    _entries.push_back(std::move(entry));
+}
+
+void CommandList::Reset() {
+    _entries.clear();
+    _instanceData.clear();
+    _transforms = std::stack<LA::mat4>({LA::mat4()});
+    ClearUniforms();
+    _culledCount = 0;
+    // override materials unused for a whole recording are dropped
+    for (auto it = _overrideMaterials.begin(); it != _overrideMaterials.end();) {
+        if (!it->second.isUsed) {
+            it = _overrideMaterials.erase(it);
+        } else {
+            it->second.isUsed = false;
+            ++it;
+        }
+    }
+}
+
+uint32_t CommandList::PushInstanceData(const void* data, size_t size) {
+    uint32_t offset = _instanceData.size();
+    _instanceData.resize(offset + size);
+    std::memcpy(_instanceData.data() + offset, data, size);
+    return offset;
+}
+
+/// --- Transforms ---
+LA::mat4 CommandList::GetModel() const {
+    return _transforms.top();
+}
+LA::mat4 CommandList::PopTransform() {
+    if (_transforms.size() <= 1)
+        return LA::mat4();
+    LA::mat4 top = _transforms.top();
+    _transforms.pop();
+    return top;
+}
+void CommandList::PushTransform(const LA::mat4& transform) {
+    LA::mat4 cur = _transforms.top();
+    LA::mat4 next = cur * transform;
+    _transforms.push(next);
+}
+void CommandList::PushTranslate(float x, float y, float z) {
+    PushTransform(LA::Translate(x, y, z));
+}
+void CommandList::PushTranslate(LA::vec3 translate) {
+    PushTransform(LA::Translate(translate));
+}
+void CommandList::PushRotate(float x, float y, float z) {
+    PushTransform(LA::Rotate(x, y, z));
+}
+void CommandList::PushRotate(LA::vec3 rotate) {
+    PushTransform(LA::Rotate(rotate));
+}
+void CommandList::PushScale(float x, float y, float z) {
+    PushTransform(LA::Scale(x, y, z));
+}
+void CommandList::PushScale(LA::vec3 scale) {
+    PushTransform(LA::Scale(scale));
+}
+
+/// --- Uniform Overrides ---
+void CommandList::SetUniform(const std::string& key, const UniformProperty& value) {
+    auto it = std::lower_bound(_overrides.begin(), _overrides.end(), key, [](const auto& override, const std::string& k) {
+        return override.first < k;
+    });
+    if (it != _overrides.end() && it->first == key) {
+        if (IsSameProperty(it->second, value))
+            return;
+        it->second = value;
+    } else {
+        _overrides.insert(it, { key, value });
+    }
+    HashOverrides();
+}
+
+void CommandList::ClearUniform(const std::string& key) {
+    auto it = std::find_if(_overrides.begin(), _overrides.end(), [&key](const auto& override) {
+        return override.first == key;
+    });
+    if (it == _overrides.end())
+        return;
+    _overrides.erase(it);
+    HashOverrides();
+}
+
+void CommandList::ClearUniforms() {
+    _overrides.clear();
+    _overridesHash = 0;
+}
+
+void CommandList::HashOverrides() {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (const auto& [key, value] : _overrides) {
+        hash = HashString(key, hash);
+        hash = HashProperty(value, hash);
+    }
+    _overridesHash = hash;
+}
+
+/// NOTE: override materials are cached per source & override values so the same overrides
+/// recorded every frame resolve to the same material, keeping its backend uniform buffer
+std::shared_ptr<Material> CommandList::ResolveMaterial(std::shared_ptr<Material> source) {
+    if (source == nullptr || _overrides.empty())
+        return source;
+
+    const Material* sourcePtr = source.get();
+    uint64_t key = HashBytes(&sourcePtr, sizeof(sourcePtr), _overridesHash);
+    OverrideMaterial& cached = _overrideMaterials[key];
+    bool isSameOverrides = cached.overrides.size() == _overrides.size()
+        && std::equal(cached.overrides.begin(), cached.overrides.end(), _overrides.begin(), [](const auto& a, const auto& b) {
+            return a.first == b.first && IsSameProperty(a.second, b.second);
+        });
+    // rebuilt when the source changes or on a hash collision
+    if (cached.material == nullptr || cached.source.lock() != source
+        || cached.sourceVersion != source->GetVersion() || !isSameOverrides) {
+        std::shared_ptr<Material> material = std::make_shared<Material>();
+        material->SetName(source->GetName());
+        material->SetShader(source->GetShader());
+        for (const std::string& feature : source->GetFeatures())
+            material->SetFeatureEnabled(feature, true);
+        for (const auto& [name, value] : source->GetUniforms())
+            material->SetUniform(name, value);
+        for (const auto& [name, value] : _overrides)
+            material->SetUniform(name, value);
+        cached.source = source;
+        cached.sourceVersion = source->GetVersion();
+        cached.overrides = _overrides;
+        cached.material = material;
+    }
+    cached.isUsed = true;
+    return cached.material;
+}
+
+/// --- Culling ---
+void CommandList::SetFrustum(const Frustum& frustum) {
+    _frustum = frustum;
+    _hasFrustum = true;
+}
+
+void CommandList::ClearFrustum() {
+    _hasFrustum = false;
+}
+
+bool CommandList::HasFrustum() const {
+    return _hasFrustum;
+}
+
+int CommandList::GetCulledCount() const {
+    return _culledCount;
+}
+
+const std::vector<CommandList::Entry>& CommandList::GetEntries() const {
+    return _entries;
+}
+
+const std::vector<uint8_t>& CommandList::GetInstanceData() const {
+    return _instanceData;
+}
+
+size_t CommandList::Size() const {
+    return _entries.size();
+}
+
+bool CommandList::Empty() const {
+    return _entries.empty();
+}
+
+} // renderer
+
+} // marathon
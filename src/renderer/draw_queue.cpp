@@ -0,0 +1,138 @@
+#include "renderer/draw_queue.hpp"
+
+#include <cstring>
+#include <numeric>
+
+namespace marathon {
+
+namespace renderer {
+
+uint64_t DrawQueue::MakeSortKey(uint32_t program, uint32_t material, uint32_t geometry, float depth) {
+    // positive floats are ordered the same as their bit patterns, so the top 16 bits
+    // (sign, exponent, 7 mantissa bits) are a monotonic quantisation across all scales
+    if (!(depth > 0.0f))
+        depth = 0.0f;
+    uint32_t depthBits;
+    std::memcpy(&depthBits, &depth, sizeof(depthBits));
+    return ((uint64_t)(program & 0xFFFF) << 48)
+        | ((uint64_t)(material & 0xFFFF) << 32)
+        | ((uint64_t)(geometry & 0xFFFF) << 16)
+        | (uint64_t)(depthBits >> 16);
+}
+
+float DrawQueue::ComputeViewDepth(const LA::mat4& view, const LA::mat4& model) {
+    // z of view * model * (0, 0, 0, 1), matrices are column major
+    float z = view[0][2] * model[3][0]
+        + view[1][2] * model[3][1]
+        + view[2][2] * model[3][2]
+        + view[3][2] * model[3][3];
+    // camera looks down -z
+    return -z;
+}
+
+uint32_t DrawQueue::AddMaterial(std::shared_ptr<Material> material) {
+    auto it = _materialIndices.find(material.get());
+    if (it != _materialIndices.end())
+        return it->second;
+    uint32_t index = _materials.size();
+    _materials.push_back(material);
+    _materialIndices[material.get()] = index;
+    return index;
+}
+
+const std::shared_ptr<Material>& DrawQueue::GetMaterial(uint32_t index) const {
+    return _materials.at(index);
+}
+
+uint32_t DrawQueue::PushInstanceData(const void* data, size_t size) {
+    uint32_t offset = _instanceData.size();
+    _instanceData.resize(offset + size);
+    std::memcpy(_instanceData.data() + offset, data, size);
+    return offset;
+}
+
+const std::vector<uint8_t>& DrawQueue::GetInstanceData() const {
+    return _instanceData;
+}
+
+void DrawQueue::Push(const DrawCommand& command) {
+    _commands.push_back(command);
+    _isSorted = false;
+}
+
+// LSD radix sort on 8 bit digits, passes where every key shares the digit are skipped
+void DrawQueue::Sort() {
+    size_t count = _commands.size();
+    _order.resize(count);
+    _scratch.resize(count);
+    std::iota(_order.begin(), _order.end(), 0);
+    if (count == 0) {
+        _isSorted = true;
+        return;
+    }
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {};
+        for (size_t i = 0; i < count; i++) {
+            histogram[(_commands[i].sortKey >> shift) & 0xFF]++;
+        }
+        if (histogram[(_commands[0].sortKey >> shift) & 0xFF] == count)
+            continue;
+
+        size_t offsets[256];
+        size_t total = 0;
+        for (int d = 0; d < 256; d++) {
+            offsets[d] = total;
+            total += histogram[d];
+        }
+        for (size_t i = 0; i < count; i++) {
+            uint32_t idx = _order[i];
+            _scratch[offsets[(_commands[idx].sortKey >> shift) & 0xFF]++] = idx;
+        }
+        _order.swap(_scratch);
+    }
+    _isSorted = true;
+}
+
+void DrawQueue::Clear() {
+    _commands.clear();
+    _order.clear();
+    _materials.clear();
+    _materialIndices.clear();
+    _instanceData.clear();
+    _isSorted = true;
+}
+
+size_t DrawQueue::Size() const {
+    return _commands.size();
+}
+
+bool DrawQueue::Empty() const {
+    return _commands.empty();
+}
+
+const DrawCommand& DrawQueue::GetSorted(size_t i) const {
+    return _commands[_order[i]];
+}
+
+int DrawQueue::CountStateChanges(bool sorted) const {
+    int changes = 0;
+    const DrawCommand* prev = nullptr;
+    for (size_t i = 0; i < _commands.size(); i++) {
+        const DrawCommand& cmd = (sorted && _isSorted) ? _commands[_order[i]] : _commands[i];
+        if (prev == nullptr) {
+            changes += 3;
+        } else {
+            if (cmd.shader != prev->shader) changes++;
+            if (cmd.material != prev->material) changes++;
+            // geometry bits of the key identify the bound vertex array
+            if (((cmd.sortKey ^ prev->sortKey) >> 16 & 0xFFFF) != 0) changes++;
+        }
+        prev = &cmd;
+    }
+    return changes;
+}
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,30 @@
+#include "renderer/frame_packet.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+void FramePacket::SetCamera(const LA::mat4& view, const LA::mat4& projection) {
+    this->view = view;
+    this->projection = projection;
+    hasCamera = true;
+}
+
+void FramePacket::SetClear(const LA::vec4& colour) {
+    clearColor = colour;
+    clear = true;
+}
+
+void FramePacket::Reset(size_t count) {
+    hasCamera = false;
+    clear = false;
+    if (lists.size() < count)
+        lists.resize(count);
+    // lists are kept rather than cleared so override materials survive between frames
+    for (CommandList& list : lists)
+        list.Reset();
+}
+
+} // renderer
+
+} // marathon
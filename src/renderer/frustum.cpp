@@ -0,0 +1,74 @@
+#include "renderer/frustum.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace marathon {
+
+namespace renderer {
+
+/// NOTE: Gribb & Hartmann, each plane is the w row plus or minus the x, y or z row of the clip matrix
+/// matrices are column major so row r is m[0][r], m[1][r], m[2][r], m[3][r]
+Frustum::Frustum(const LA::mat4& viewProjection) {
+    const LA::mat4& m = viewProjection;
+    for (int i = 0; i < 6; i++) {
+        int row = i / 2;
+        float sign = i % 2 == 0 ? 1.0f : -1.0f;
+        Plane plane = {
+            .a = m[0][3] + sign * m[0][row],
+            .b = m[1][3] + sign * m[1][row],
+            .c = m[2][3] + sign * m[2][row],
+            .d = m[3][3] + sign * m[3][row]
+        };
+        float length = std::sqrt(plane.a * plane.a + plane.b * plane.b + plane.c * plane.c);
+        if (length > 0.0f) {
+            plane.a /= length;
+            plane.b /= length;
+            plane.c /= length;
+            plane.d /= length;
+        }
+        _planes[i] = plane;
+    }
+}
+
+const std::array<Plane, 6>& Frustum::GetPlanes() const {
+    return _planes;
+}
+
+bool Frustum::IsVisible(const Bounds& bounds, const LA::mat4& model) const {
+    if (!bounds.isValid)
+        return true;
+    const LA::mat4& m = model;
+    // world space centre, model is affine
+    const LA::vec3& lc = bounds.center;
+    float cx = m[0][0] * lc.x + m[1][0] * lc.y + m[2][0] * lc.z + m[3][0];
+    float cy = m[0][1] * lc.x + m[1][1] * lc.y + m[2][1] * lc.z + m[3][1];
+    float cz = m[0][2] * lc.x + m[1][2] * lc.y + m[2][2] * lc.z + m[3][2];
+
+    // world extents of the transformed box, i.e. |M| * local half extents
+    float ex = (bounds.max.x - bounds.min.x) * 0.5f;
+    float ey = (bounds.max.y - bounds.min.y) * 0.5f;
+    float ez = (bounds.max.z - bounds.min.z) * 0.5f;
+    float wx = std::abs(m[0][0]) * ex + std::abs(m[1][0]) * ey + std::abs(m[2][0]) * ez;
+    float wy = std::abs(m[0][1]) * ex + std::abs(m[1][1]) * ey + std::abs(m[2][1]) * ez;
+    float wz = std::abs(m[0][2]) * ex + std::abs(m[1][2]) * ey + std::abs(m[2][2]) * ez;
+
+    // sphere radius scales by the largest axis scale
+    float scaleSq = 0.0f;
+    for (int col = 0; col < 3; col++)
+        scaleSq = std::max(scaleSq, m[col][0] * m[col][0] + m[col][1] * m[col][1] + m[col][2] * m[col][2]);
+    float sphereRadius = bounds.radius * std::sqrt(scaleSq);
+
+    for (const Plane& plane : _planes) {
+        float distance = plane.a * cx + plane.b * cy + plane.c * cz + plane.d;
+        float boxRadius = std::abs(plane.a) * wx + std::abs(plane.b) * wy + std::abs(plane.c) * wz;
+        // outside if either volume is entirely behind the plane
+        if (distance < -std::min(boxRadius, sphereRadius))
+            return false;
+    }
+    return true;
+}
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,105 @@
+#include "renderer/headless/command_log.hpp"
+
+#include <fstream>
+
+#include "core/logger.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace headless {
+
+const char* CommandLog::GetCallName(CallType type) {
+    switch (type) {
+        case CallType::CLEAR:                   return "clear";
+        case CallType::DRAW:                    return "draw";
+        case CallType::DRAW_INSTANCED:          return "draw_instanced";
+        case CallType::SET_STATE:               return "set_state";
+        case CallType::BIND_SHADER:             return "bind_shader";
+        case CallType::BIND_MESH:               return "bind_mesh";
+        case CallType::BIND_CANVAS:             return "bind_canvas";
+        case CallType::BIND_TEXTURE:            return "bind_texture";
+        case CallType::SET_UNIFORM:             return "set_uniform";
+        case CallType::UPLOAD_MESH:             return "upload_mesh";
+        case CallType::UPLOAD_UNIFORM_BLOCK:    return "upload_uniform_block";
+        case CallType::UPLOAD_INSTANCE_DATA:    return "upload_instance_data";
+        case CallType::COMPILE_SHADER:          return "compile_shader";
+        case CallType::BEGIN_ZONE:              return "begin_zone";
+        case CallType::END_ZONE:                return "end_zone";
+        default:                                return "unknown";
+    }
+}
+
+void CommandLog::Record(CallType type, int frameIndex, size_t bytes, const std::string& label) {
+    if (type == CallType::COUNT)
+        return;
+    _counts[(size_t)type]++;
+    _bytes[(size_t)type] += bytes;
+    if (_isKeepingCalls)
+        _calls.push_back({ type, frameIndex, bytes, label });
+}
+
+void CommandLog::Clear() {
+    _calls.clear();
+    _counts.fill(0);
+    _bytes.fill(0);
+}
+
+bool CommandLog::GetKeepCalls() const {
+    return _isKeepingCalls;
+}
+
+void CommandLog::SetKeepCalls(bool enabled) {
+    _isKeepingCalls = enabled;
+    if (!enabled)
+        _calls.clear();
+}
+
+const std::vector<RecordedCall>& CommandLog::GetCalls() const {
+    return _calls;
+}
+
+size_t CommandLog::GetCount(CallType type) const {
+    if (type == CallType::COUNT)
+        return 0;
+    return _counts[(size_t)type];
+}
+
+size_t CommandLog::GetBytes(CallType type) const {
+    if (type == CallType::COUNT)
+        return 0;
+    return _bytes[(size_t)type];
+}
+
+size_t CommandLog::GetTotalCount() const {
+    size_t total = 0;
+    for (size_t count : _counts)
+        total += count;
+    return total;
+}
+
+size_t CommandLog::GetTotalBytes() const {
+    size_t total = 0;
+    for (size_t bytes : _bytes)
+        total += bytes;
+    return total;
+}
+
+bool CommandLog::ExportCsv(const std::filesystem::path& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        MT_CORE_WARN("CommandLog::ExportCsv: failed to open {}", path.string());
+        return false;
+    }
+    file << "frame,call,bytes,label\n";
+    for (const RecordedCall& call : _calls)
+        file << call.frameIndex << "," << GetCallName(call.type) << "," << call.bytes << "," << call.label << "\n";
+    return file.good();
+}
+
+} // headless
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,1143 @@
+#include "renderer/headless/renderer.hpp"
+
+#include <cctype>
+#include <fstream>
+
+#include "core/hash.hpp"
+#include "core/logger.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace headless {
+
+namespace {
+
+size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// identifiers & single punctuation characters, comments & preprocessor lines are dropped
+std::vector<std::string> Tokenize(const std::string& source) {
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    bool isLineStart = true;
+    while (i < source.size()) {
+        char c = source[i];
+        if (c == '\n') {
+            isLineStart = true;
+            i++;
+        } else if (std::isspace((unsigned char)c)) {
+            i++;
+        } else if (isLineStart && c == '#') {
+            i = source.find('\n', i);
+        } else if (source.compare(i, 2, "//") == 0) {
+            i = source.find('\n', i);
+        } else if (source.compare(i, 2, "/*") == 0) {
+            i = source.find("*/", i + 2);
+            if (i != std::string::npos)
+                i += 2;
+        } else if (std::isalnum((unsigned char)c) || c == '_') {
+            size_t start = i;
+            while (i < source.size() && (std::isalnum((unsigned char)source[i]) || source[i] == '_'))
+                i++;
+            tokens.push_back(source.substr(start, i - start));
+            isLineStart = false;
+        } else {
+            tokens.push_back(std::string(1, c));
+            isLineStart = false;
+            i++;
+        }
+    }
+    return tokens;
+}
+
+bool IsPrecision(const std::string& token) {
+    return token == "lowp" || token == "mediump" || token == "highp";
+}
+
+// fill in shape of member & its std140 size & alignment, false if the type can't be packed
+bool GetStd140Type(const std::string& type, UniformBlockMember& member, size_t& size, size_t& alignment) {
+    if (type == "int" || type == "uint" || type == "bool") {
+        member.isInteger = true;
+    } else if (type == "vec2") {
+        member.rows = 2;
+    } else if (type == "vec3") {
+        member.rows = 3;
+    } else if (type == "vec4") {
+        member.rows = 4;
+    } else if (type == "mat2" || type == "mat3" || type == "mat4") {
+        member.rows = type[3] - '0';
+        member.columns = member.rows;
+    } else if (type != "float") {
+        return false;
+    }
+    // matrix columns & array elements are padded to a vec4
+    if (member.columns > 1) {
+        member.matrixStride = 16;
+        size = 16 * member.columns;
+        alignment = 16;
+    } else {
+        size = 4 * member.rows;
+        alignment = member.rows == 1 ? 4 : member.rows == 2 ? 8 : 16;
+    }
+    return true;
+}
+
+} // namespace
+
+/// Build-in shaders
+const std::vector<std::string> Renderer::s_reservedUniforms = {
+    "u_view",
+    "u_projection",
+    "u_resolution",
+    "u_time",
+    "u_time_delta",
+    "u_frame_index"
+};
+const std::string Renderer::s_materialBlockName = "MaterialProperties";
+
+Renderer::Renderer()
+    : renderer::Renderer("marathon.renderer.headless") {
+    // NOTE: reserved uniforms must be interned first so they occupy the lowest ids
+    for (const auto& key : s_reservedUniforms) {
+        GetUniformId(key);
+    }
+}
+
+// module interface
+bool Renderer::Boot() {
+    MT_CORE_INFO("Renderer::Boot: headless backend, nothing will be drawn");
+    _active = true;
+    return true;
+}
+bool Renderer::Shutdown() {
+    _active = false;
+    return true;
+}
+
+/// --- Headless ---
+CommandLog& Renderer::GetCommandLog() {
+    return _commandLog;
+}
+void Renderer::SetResolution(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        MT_CORE_WARN("Renderer::SetResolution: invalid resolution {}x{}", width, height);
+        return;
+    }
+    _width = width;
+    _height = height;
+}
+void Renderer::GetResolution(int& width, int& height) const {
+    width = _width;
+    height = _height;
+}
+void Renderer::Record(CallType type, size_t bytes, const std::string& label) {
+    _commandLog.Record(type, _stats.frameIndex, bytes, label);
+}
+
+/// --- Validation ---
+bool Renderer::ValidateShader(std::shared_ptr<Shader> shader, std::string& err) {
+    if (shader == nullptr) {
+        err = "Shader is null\n";
+        return false;
+    }
+    ShaderHandler* shaderHandler = _shaderHandlers.Get(FindOrCreateShaderHandler(shader));
+    if (shaderHandler->isValid)
+        return true;
+    err = shaderHandler->warnings;
+    return false;
+}
+
+/// NOTE: pending mesh edits are recorded as uploads here, as the gpu backends upload them
+/// draws of the mesh already queued are flushed first so each draw sees the data it was issued with
+bool Renderer::ValidateMesh(std::shared_ptr<Mesh> mesh, std::string& err) {
+    if (mesh == nullptr) {
+        err = "Mesh is null\n";
+        return false;
+    }
+    MeshHandler* meshHandler = _meshHandlers.Get(FindOrCreateMeshHandler(mesh));
+    UpdateMeshHandler(*meshHandler);
+    if (meshHandler->isValid)
+        return true;
+    err = meshHandler->warnings;
+    return false;
+}
+
+/// --- Mesh Stuff ---
+Renderer::MeshHandler Renderer::BuildMeshHandler(std::shared_ptr<Mesh> mesh) {
+    int vertexCount = mesh->GetVertexCount();
+    std::vector<VertexAttributeDescriptor> vertexAttrs = mesh->GetVertexAttributes();
+    int vertexSize = mesh->GetVertexSize();
+    int indexCount = mesh->GetIndexCount();
+    int indexSize = mesh->GetIndexSize();
+
+    std::string warnings = "";
+    if (vertexCount == 0)
+        warnings += "No vertices defined\n";
+    if (vertexAttrs.size() == 0)
+        warnings += "No vertex attributes defined\n";
+    if (vertexSize == 0)
+        warnings += "Vertex size is 0 bytes\n";
+    if (mesh->GetVertexPtr() == nullptr)
+        warnings += "Vertex data is nullptr\n";
+    if (indexCount != 0) {
+        if (indexSize == 0)
+            warnings += "Index size is 0 bytes\n";
+        if (mesh->GetIndexPtr() == nullptr)
+            warnings += "Index data is nullptr\n";
+    }
+    uint32_t attributeMask = 0;
+    for (int i = 0; i < vertexAttrs.size(); i++) {
+        if (mesh->GetVertexAttributeLocation(vertexAttrs[i].attribute) == -1)
+            warnings += "Vertex attribute (" + std::to_string(i) + ") location invalid\n";
+        attributeMask |= 1u << (int)vertexAttrs[i].attribute;
+    }
+
+    MeshHandler meshHandler = {
+        .mesh = mesh,
+        .attributeMask = attributeMask,
+        .warnings = warnings,
+        .isValid = vertexCount > 0 && vertexAttrs.size() > 0 && vertexSize > 0 && (indexCount == 0 || (indexCount > 0 && indexSize > 0))
+    };
+
+    // everything is uploaded
+    size_t bytes = (size_t)vertexSize * vertexCount + (size_t)indexSize * indexCount;
+    Record(CallType::UPLOAD_MESH, bytes, mesh->GetName());
+    _stats.bytesUploaded += bytes;
+    mesh->ClearVertexDirtyFlag();
+    mesh->ClearIndexDirtyFlag();
+    return meshHandler;
+}
+void Renderer::UpdateMeshHandler(MeshHandler& meshHandler) {
+    std::shared_ptr<Mesh> mesh = meshHandler.mesh;
+    DataDirty vertexDirty = mesh->GetVertexDirtyFlag();
+    DataDirty indexDirty = mesh->GetIndexDirtyFlag();
+    if (vertexDirty == DataDirty::CLEAN && indexDirty == DataDirty::CLEAN)
+        return;
+    // queued draws of the mesh must see the data they were issued with
+    if (meshHandler.queuedFlush == _flushIndex && !_drawQueue.Empty())
+        Flush();
+    // after the flush so queued draws are tested with the bounds they were issued with
+    mesh->UpdateBounds();
+
+    // sizes changed, rebuild in place so the handle stays valid for queued draws
+    if (vertexDirty == DataDirty::DIRTY_REALLOC || indexDirty == DataDirty::DIRTY_REALLOC
+        || vertexDirty == DataDirty::DIRTY_DELETE || indexDirty == DataDirty::DIRTY_DELETE) {
+        meshHandler = BuildMeshHandler(mesh);
+        return;
+    }
+
+    size_t bytes = 0;
+    if (vertexDirty == DataDirty::DIRTY_UPDATE) {
+        for (const DataRange& range : mesh->GetVertexDirtyRanges().GetRanges())
+            bytes += range.size;
+        mesh->ClearVertexDirtyFlag();
+    }
+    if (indexDirty == DataDirty::DIRTY_UPDATE) {
+        for (const DataRange& range : mesh->GetIndexDirtyRanges().GetRanges())
+            bytes += range.size;
+        mesh->ClearIndexDirtyFlag();
+    }
+    Record(CallType::UPLOAD_MESH, bytes, mesh->GetName());
+    _stats.bytesUploaded += bytes;
+}
+Handle Renderer::FindOrCreateMeshHandler(std::shared_ptr<Mesh> mesh) {
+    // fast path, handle stored on mesh after first upload
+    Handle handle = mesh->GetRendererHandle();
+    MeshHandler* meshHandler = _meshHandlers.Get(handle);
+    if (meshHandler != nullptr && meshHandler->mesh == mesh)
+        return handle;
+    // stale or foreign handle, fallback to uuid
+    auto it = _meshLookup.find(mesh->GetUUID());
+    if (it != _meshLookup.end()) {
+        meshHandler = _meshHandlers.Get(it->second);
+        if (meshHandler != nullptr && meshHandler->mesh == mesh) {
+            mesh->SetRendererHandle(it->second);
+            return it->second;
+        }
+    }
+    handle = _meshHandlers.Insert(BuildMeshHandler(mesh));
+    _stats.handlersCreated++;
+    mesh->SetRendererHandle(handle);
+    _meshLookup[mesh->GetUUID()] = handle;
+    return handle;
+}
+
+/// --- Shader Stuff ---
+/// NOTE: each shader has its own handler, the gpu backends' sharing of identical sources is not modelled
+Handle Renderer::FindOrCreateShaderHandler(std::shared_ptr<Shader> shader) {
+    // fast path, handle stored on shader after first use
+    Handle handle = shader->GetRendererHandle();
+    ShaderHandler* shaderHandler = _shaderHandlers.Get(handle);
+    if (shaderHandler == nullptr || shaderHandler->shader.lock() != shader) {
+        // stale or foreign handle, fallback to uuid
+        shaderHandler = nullptr;
+        auto it = _shaderLookup.find(shader->GetUUID());
+        if (it != _shaderLookup.end()) {
+            shaderHandler = _shaderHandlers.Get(it->second);
+            if (shaderHandler != nullptr && shaderHandler->shader.lock() == shader) {
+                handle = it->second;
+                shader->SetRendererHandle(handle);
+            } else {
+                shaderHandler = nullptr;
+            }
+        }
+    }
+
+    if (shaderHandler == nullptr) {
+        ShaderHandler created = ShaderHandler();
+        created.shader = shader;
+        created.uuid = shader->GetUUID();
+        ReflectShader(created, *shader);
+        shader->ClearDirtyFlag();
+        handle = _shaderHandlers.Insert(std::move(created));
+        _stats.handlersCreated++;
+        shader->SetRendererHandle(handle);
+        _shaderLookup[shader->GetUUID()] = handle;
+        return handle;
+    }
+    // sources changed, reflected again in place so queued draws keep their handle
+    if (shader->GetDirtyFlag() == ShaderDirty::DIRTY_COMPILE) {
+        ReflectShader(*shaderHandler, *shader);
+        shader->ClearDirtyFlag();
+    }
+    return handle;
+}
+
+// finds uniform declarations outside blocks & lays out the material block with std140 rules
+void Renderer::ReflectShader(ShaderHandler& shaderHandler, const Shader& shader) {
+    Record(CallType::COMPILE_SHADER, shader.GetVertexSource().size() + shader.GetFragmentSource().size(), shader.GetName());
+    shaderHandler.uniforms.clear();
+    shaderHandler.materialBlock = UniformBlockLayout();
+    shaderHandler.warnings = "";
+    if (shader.GetVertexSource().empty())
+        shaderHandler.warnings += "Vertex source is empty\n";
+    if (shader.GetFragmentSource().empty())
+        shaderHandler.warnings += "Fragment source is empty\n";
+
+    std::vector<UniformId> declared;
+    for (const std::string* source : { &shader.GetVertexSource(), &shader.GetFragmentSource() }) {
+        std::vector<std::string> tokens = Tokenize(*source);
+        size_t i = 0;
+        while (i < tokens.size()) {
+            if (tokens[i] != "uniform") {
+                i++;
+                continue;
+            }
+            i++;
+            // block, only the material block is packed, others are backend owned e.g. FrameGlobals
+            if (i + 1 < tokens.size() && tokens[i + 1] == "{") {
+                bool isMaterial = tokens[i] == s_materialBlockName;
+                UniformBlockLayout layout = UniformBlockLayout();
+                layout.name = tokens[i];
+                size_t offset = 0;
+                i += 2;
+                while (i < tokens.size() && tokens[i] != "}") {
+                    while (i < tokens.size() && IsPrecision(tokens[i]))
+                        i++;
+                    if (i + 1 >= tokens.size())
+                        break;
+                    std::string type = tokens[i++];
+                    while (i < tokens.size() && tokens[i] != ";" && tokens[i] != "}") {
+                        std::string name = tokens[i++];
+                        int count = 1;
+                        if (i + 2 < tokens.size() && tokens[i] == "[") {
+                            count = std::max(std::atoi(tokens[i + 1].c_str()), 1);
+                            i += 3;
+                        }
+                        if (i < tokens.size() && tokens[i] == ",")
+                            i++;
+                        UniformBlockMember member = UniformBlockMember();
+                        member.name = name;
+                        size_t size = 0, alignment = 0;
+                        if (!GetStd140Type(type, member, size, alignment)) {
+                            if (isMaterial)
+                                MT_CORE_WARN("Renderer::ReflectShader: unsupported type of block member \"{}\"", name);
+                            continue;
+                        }
+                        // array elements are padded to a vec4, only the first is packed
+                        if (count > 1) {
+                            alignment = 16;
+                            size = AlignUp(size, 16) * count;
+                        }
+                        member.offset = AlignUp(offset, alignment);
+                        offset = member.offset + size;
+                        layout.members.push_back(member);
+                    }
+                    if (i < tokens.size() && tokens[i] == ";")
+                        i++;
+                }
+                if (i >= tokens.size()) {
+                    shaderHandler.warnings += "Uniform block \"" + layout.name + "\" is not closed\n";
+                    break;
+                }
+                layout.size = AlignUp(offset, 16);
+                if (isMaterial) {
+                    shaderHandler.materialBlock = layout;
+                    shaderHandler.materialBlockHash = layout.Hash();
+                }
+                continue;
+            }
+            // plain uniforms, possibly several per declaration
+            while (i < tokens.size() && IsPrecision(tokens[i]))
+                i++;
+            i++;
+            while (i < tokens.size() && tokens[i] != ";") {
+                if (tokens[i] == "[") {
+                    // elements are addressable individually as in the gpu backends, the base name aliases element 0
+                    const std::string& base = tokens[i - 1];
+                    int count = i + 1 < tokens.size() ? std::atoi(tokens[i + 1].c_str()) : 0;
+                    for (int element = 0; element < count; element++)
+                        declared.push_back(GetUniformId(base + "[" + std::to_string(element) + "]"));
+                    while (i < tokens.size() && tokens[i] != "]")
+                        i++;
+                } else if (tokens[i] != "," && tokens[i] != "]") {
+                    declared.push_back(GetUniformId(tokens[i]));
+                }
+                i++;
+            }
+        }
+    }
+
+    shaderHandler.uniforms.assign(_uniformNames.size(), false);
+    for (UniformId id : declared)
+        shaderHandler.uniforms[id] = true;
+    shaderHandler.isValid = shaderHandler.warnings.empty();
+    shaderHandler.status = shaderHandler.isValid ? ShaderStatus::READY : ShaderStatus::FAILED;
+    if (!shaderHandler.isValid)
+        MT_CORE_WARN("Renderer::ReflectShader: shader \"{}\" is invalid\n{}", shader.GetName(), shaderHandler.warnings);
+}
+Renderer::ShaderHandler* Renderer::GetBoundShaderHandler() {
+    return _shaderHandlers.Get(_shaderHandle);
+}
+
+// mesh handlers hold a shared_ptr to their resource, so a use count of 1 means only the renderer references it
+void Renderer::CollectHandlers() {
+    std::vector<Handle> unused;
+    _meshHandlers.ForEach([&unused](Handle handle, MeshHandler& meshHandler) {
+        if (meshHandler.mesh.use_count() == 1)
+            unused.push_back(handle);
+    });
+    for (Handle handle : unused) {
+        MeshHandler* meshHandler = _meshHandlers.Get(handle);
+        auto it = _meshLookup.find(meshHandler->mesh->GetUUID());
+        if (it != _meshLookup.end() && it->second == handle)
+            _meshLookup.erase(it);
+        _meshHandlers.Remove(handle);
+    }
+
+    unused.clear();
+    _shaderHandlers.ForEach([this, &unused](Handle handle, ShaderHandler& shaderHandler) {
+        if (shaderHandler.shader.expired() && handle != _shaderHandle)
+            unused.push_back(handle);
+    });
+    for (Handle handle : unused) {
+        auto it = _shaderLookup.find(_shaderHandlers.Get(handle)->uuid);
+        if (it != _shaderLookup.end() && it->second == handle)
+            _shaderLookup.erase(it);
+        _shaderHandlers.Remove(handle);
+    }
+
+    for (auto it = _materialBuffers.begin(); it != _materialBuffers.end();) {
+        if (it->second.material.expired()) {
+            it = _materialBuffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/// --- Drawing ---
+void Renderer::Clear() {
+    Clear(true, true, true);
+}
+void Renderer::Clear(bool clearColor, bool clearStencil, bool clearDepth) {
+    // submit queued draws so they are not lost
+    Flush();
+    std::string label = "";
+    if (clearColor) label += "color ";
+    if (clearStencil) label += "stencil ";
+    if (clearDepth) label += "depth ";
+    if (!label.empty())
+        label.pop_back();
+    Record(CallType::CLEAR, 0, label);
+}
+
+// validate mesh & material and fill in the common command fields, returns false if can't be drawn
+bool Renderer::PrepareDrawCommand(std::shared_ptr<Mesh> mesh, const LA::mat4& model, DrawCommand& cmd, std::shared_ptr<Material> material) {
+    if (mesh == nullptr) {
+        MT_CORE_WARN("Renderer::Draw: mesh is null");
+        return false;
+    }
+    std::string err = "";
+    if (!ValidateMesh(mesh, err)) {
+        MT_CORE_WARN("Renderer::Draw: can't draw invalid mesh");
+        return false;
+    }
+    if (material == nullptr)
+        material = mesh->GetMaterial();
+    if (material == nullptr) {
+        MT_CORE_WARN("Renderer::Draw: mesh has no material");
+        return false;
+    }
+    std::shared_ptr<Shader> shader = material->GetShader();
+    if (shader == nullptr || !ValidateShader(shader, err)) {
+        MT_CORE_WARN("Renderer::Draw: can't draw with invalid shader");
+        return false;
+    }
+
+    cmd.mesh = mesh->GetRendererHandle();
+    cmd.shader = shader->GetRendererHandle();
+    cmd.material = _drawQueue.AddMaterial(material);
+    cmd.model = model;
+    float depth = DrawQueue::ComputeViewDepth(GetView(), cmd.model);
+    // every mesh owns its geometry, there are no pools to share a binding
+    cmd.sortKey = DrawQueue::MakeSortKey(cmd.shader.index, cmd.material, cmd.mesh.index, depth);
+    return true;
+}
+
+void Renderer::Draw(std::shared_ptr<Mesh> mesh, uint64_t occlusionId) {
+    // bounds of edited meshes are only recalculated here on the render thread
+    if (mesh != nullptr)
+        mesh->UpdateBounds();
+    if (mesh != nullptr && IsCulled(*mesh, GetModel())) {
+        _stats.drawsCulled++;
+        return;
+    }
+    DrawCommand cmd = DrawCommand();
+    if (!PrepareDrawCommand(mesh, GetModel(), cmd))
+        return;
+    _drawQueue.Push(cmd);
+}
+
+bool Renderer::IsCulled(const Mesh& mesh, const LA::mat4& model) {
+    if (!_state.frustumCulling)
+        return false;
+    if (_isFrustumDirty) {
+        _frustum = Frustum(GetProjection() * GetView());
+        _isFrustumDirty = false;
+    }
+    return !_frustum.IsVisible(mesh.GetBounds(), model);
+}
+
+void Renderer::CullOccluded() {
+    if (!_state.occlusionCulling || !_occlusionCuller.HasOccluders())
+        return;
+    if (_isOcclusionDirty) {
+        _occlusionCuller.Rasterise(GetProjection() * GetView());
+        _isOcclusionDirty = false;
+    }
+    _stats.drawsOccluded += (int)_drawQueue.RemoveIf([this](const DrawCommand& cmd) {
+        const MeshHandler* meshHandler = _meshHandlers.Get(cmd.mesh);
+        if (cmd.instanceCount > 0 || meshHandler == nullptr)
+            return false;
+        return !_occlusionCuller.IsVisible(meshHandler->mesh->GetBounds(), cmd.model);
+    });
+}
+
+void Renderer::DrawOccluder(std::shared_ptr<Mesh> mesh) {
+    if (mesh == nullptr) {
+        MT_CORE_WARN("Renderer::DrawOccluder: mesh is null");
+        return;
+    }
+    if (_occlusionCuller.AddOccluder(*mesh, GetModel()))
+        _isOcclusionDirty = true;
+}
+
+void Renderer::DrawInstanced(std::shared_ptr<Mesh> mesh, std::span<const LA::mat4> transforms, std::span<const InstanceStream> streams) {
+    if (transforms.empty())
+        return;
+    DrawCommand cmd = DrawCommand();
+    if (!PrepareDrawCommand(mesh, GetModel(), cmd))
+        return;
+
+    // validate streams before copying anything
+    const InstanceStream* slots[InstanceStream::MAX_SLOTS] = {};
+    for (const InstanceStream& stream : streams) {
+        if (stream.slot < 0 || stream.slot >= InstanceStream::MAX_SLOTS) {
+            MT_CORE_WARN("Renderer::DrawInstanced: instance stream slot {} out of range", stream.slot);
+            continue;
+        }
+        if (stream.data.size() != transforms.size()) {
+            MT_CORE_WARN("Renderer::DrawInstanced: instance stream slot {} size does not match instance count", stream.slot);
+            continue;
+        }
+        slots[stream.slot] = &stream;
+    }
+
+    cmd.instanceCount = transforms.size();
+    cmd.instanceOffset = _drawQueue.PushInstanceData(transforms.data(), transforms.size_bytes());
+    for (int slot = 0; slot < InstanceStream::MAX_SLOTS; slot++) {
+        if (slots[slot] == nullptr)
+            continue;
+        _drawQueue.PushInstanceData(slots[slot]->data.data(), slots[slot]->data.size_bytes());
+        cmd.instanceStreamMask |= 1 << slot;
+    }
+    _drawQueue.Push(cmd);
+}
+
+void Renderer::Submit(std::span<const CommandList> lists) {
+    for (const CommandList& list : lists) {
+        _stats.drawsCulled += list.GetCulledCount();
+        const std::vector<uint8_t>& instanceData = list.GetInstanceData();
+        for (const CommandList::Entry& entry : list.GetEntries()) {
+            entry.mesh->UpdateBounds();
+            if (entry.instanceCount == 0 && !list.HasFrustum() && IsCulled(*entry.mesh, entry.model)) {
+                _stats.drawsCulled++;
+                continue;
+            }
+            DrawCommand cmd = DrawCommand();
+            if (!PrepareDrawCommand(entry.mesh, entry.model, cmd, entry.material))
+                continue;
+            if (entry.instanceCount > 0) {
+                cmd.instanceCount = entry.instanceCount;
+                cmd.instanceOffset = _drawQueue.PushInstanceData(instanceData.data() + entry.instanceOffset, entry.instanceSize);
+                cmd.instanceStreamMask = entry.instanceStreamMask;
+            }
+            _drawQueue.Push(cmd);
+        }
+    }
+}
+
+void Renderer::CountDraw(const Mesh& mesh, int instanceCount) {
+    int count = mesh.GetIndexCount() > 0 ? mesh.GetIndexCount() : mesh.GetVertexCount();
+    _stats.verticesRendered += count * instanceCount;
+    _stats.trianglesRendered += CountTriangles(mesh.GetPrimitiveType(), count) * instanceCount;
+}
+
+/// NOTE: mirrors the gpu backends' submission, binds are recorded only when the sorted order changes them
+void Renderer::Flush() {
+    if (_drawQueue.Empty())
+        return;
+    _flushIndex++;
+
+    CullOccluded();
+    if (_drawQueue.Empty()) {
+        _drawQueue.Clear();
+        return;
+    }
+
+    int unsortedChanges = _drawQueue.CountStateChanges(false);
+    _drawQueue.Sort();
+    _stats.stateChangesSaved += unsortedChanges - _drawQueue.CountStateChanges(true);
+
+    const std::vector<uint8_t>& instanceData = _drawQueue.GetInstanceData();
+    if (!instanceData.empty()) {
+        Record(CallType::UPLOAD_INSTANCE_DATA, instanceData.size());
+        _stats.bytesUploaded += instanceData.size();
+    }
+
+    // draws bind their own shaders, uniforms set after the flush must still go to the user's shader
+    Handle userShader = _shaderHandle;
+    Handle boundShader = Handle();
+    Handle boundMesh = Handle();
+    uint32_t boundMaterial = UINT32_MAX;
+    for (size_t i = 0; i < _drawQueue.Size(); i++) {
+        const DrawCommand& cmd = _drawQueue.GetSorted(i);
+        ShaderHandler* shaderHandler = _shaderHandlers.Get(cmd.shader);
+        MeshHandler* meshHandler = _meshHandlers.Get(cmd.mesh);
+        if (shaderHandler == nullptr || meshHandler == nullptr) {
+            MT_CORE_WARN("Renderer::Flush: skipping draw with stale handle");
+            continue;
+        }
+        // shader sources changed after the draw was queued
+        if (!shaderHandler->isValid)
+            continue;
+
+        if (cmd.shader != boundShader) {
+            _shaderHandle = cmd.shader;
+            Record(CallType::BIND_SHADER);
+            _stats.programBinds++;
+            boundShader = cmd.shader;
+            // uniforms are per program so material must be rebound
+            boundMaterial = UINT32_MAX;
+        }
+        if (cmd.material != boundMaterial) {
+            if (!SetMaterialUniforms(_drawQueue.GetMaterial(cmd.material))) {
+                MT_CORE_WARN("Renderer::Flush: failed to set material uniforms");
+            }
+            boundMaterial = cmd.material;
+        }
+        if (cmd.mesh != boundMesh) {
+            Record(CallType::BIND_MESH);
+            _stats.vertexArrayBinds++;
+            boundMesh = cmd.mesh;
+        }
+        Record(CallType::SET_UNIFORM, sizeof(float) * 16, "u_model");
+        _stats.uniformUploads++;
+
+        const std::shared_ptr<Mesh>& mesh = meshHandler->mesh;
+        Record(cmd.instanceCount > 0 ? CallType::DRAW_INSTANCED : CallType::DRAW, 0, mesh->GetName());
+        _stats.drawCalls++;
+        CountDraw(*mesh, cmd.instanceCount > 0 ? cmd.instanceCount : 1);
+    }
+    _drawQueue.Clear();
+    _shaderHandle = userShader;
+}
+
+/// --- Transforms ---
+void Renderer::SetProjection(const LA::mat4& proj) {
+    Flush();
+    renderer::Renderer::SetProjection(proj);
+    _isFrustumDirty = true;
+    _isOcclusionDirty = true;
+}
+void Renderer::SetView(const LA::mat4& view) {
+    Flush();
+    renderer::Renderer::SetView(view);
+    _isFrustumDirty = true;
+    _isOcclusionDirty = true;
+}
+
+/// --- State Management ---
+/// NOTE: state affecting draws flushes the draw queue so queued draws use the state they were issued with
+void Renderer::SetState(RendererState state) {
+    SetClearColor(state.clearColor);
+    SetColorMask(state.colorMask);
+    SetCullTest(state.cullTest);
+    SetCullFace(state.cullFace);
+    SetCullWinding(state.cullWinding);
+    SetDepthTest(state.depthTest);
+    SetDepthFunction(state.depthFunc);
+    SetDepthMask(state.depthMask);
+    SetLineWidth(state.lineWidth);
+    SetPointSize(state.pointSize);
+    SetIsWireframe(state.isWireframe);
+    SetCompilePlaceholder(state.compilePlaceholder);
+    SetFrustumCulling(state.frustumCulling);
+    SetOcclusionCulling(state.occlusionCulling);
+    SetOcclusionQueries(state.occlusionQueries);
+}
+void Renderer::ResetState() {
+    SetState(RendererState());
+}
+bool Renderer::IsUsable() {
+    return _active;
+}
+// colour
+LA::vec4 Renderer::GetClearColor() {
+    return _state.clearColor;
+}
+LA::vec4 Renderer::GetColorMask() {
+    return _state.colorMask;
+}
+void Renderer::SetClearColor(const LA::vec4& colour) {
+    // only used by clears so queued draws are unaffected
+    const LA::vec4& cur = _state.clearColor;
+    if (cur.r != colour.r || cur.g != colour.g || cur.b != colour.b || cur.a != colour.a) {
+        Record(CallType::SET_STATE, 0, "clear_color");
+    } else {
+        _stats.stateCallsSkipped++;
+    }
+    _state.clearColor = colour;
+}
+void Renderer::SetColorMask(const LA::vec4& mask) {
+    const LA::vec4& cur = _state.colorMask;
+    if (cur.r != mask.r || cur.g != mask.g || cur.b != mask.b || cur.a != mask.a) {
+        Flush();
+        Record(CallType::SET_STATE, 0, "color_mask");
+    } else {
+        _stats.stateCallsSkipped++;
+    }
+    _state.colorMask = mask;
+}
+// culling
+bool Renderer::GetCullTest() {
+    return _state.cullTest;
+}
+CullFace Renderer::GetCullFace() {
+    return _state.cullFace;
+}
+CullWinding Renderer::GetCullWinding() {
+    return _state.cullWinding;
+}
+void Renderer::SetCullTest(bool enabled) {
+    ChangeState(_state.cullTest, enabled, "cull_test");
+}
+void Renderer::SetCullFace(CullFace face) {
+    ChangeState(_state.cullFace, face, "cull_face");
+}
+void Renderer::SetCullWinding(CullWinding winding) {
+    ChangeState(_state.cullWinding, winding, "cull_winding");
+}
+// depth
+bool Renderer::GetDepthTest() {
+    return _state.depthTest;
+}
+DepthFunc Renderer::GetDepthFunction() {
+    return _state.depthFunc;
+}
+bool Renderer::GetDepthMask() {
+    return _state.depthMask;
+}
+void Renderer::SetDepthTest(bool enabled) {
+    ChangeState(_state.depthTest, enabled, "depth_test");
+}
+void Renderer::SetDepthFunction(DepthFunc func) {
+    ChangeState(_state.depthFunc, func, "depth_func");
+}
+void Renderer::SetDepthMask(bool enabled) {
+    ChangeState(_state.depthMask, enabled, "depth_mask");
+}
+// rasterization
+float Renderer::GetLineWidth() {
+    return _state.lineWidth;
+}
+float Renderer::GetPointSize() {
+    return _state.pointSize;
+}
+bool Renderer::GetIsWireframe() {
+    return _state.isWireframe;
+}
+void Renderer::SetLineWidth(float width) {
+    ChangeState(_state.lineWidth, width, "line_width");
+}
+void Renderer::SetPointSize(float size) {
+    ChangeState(_state.pointSize, size, "point_size");
+}
+void Renderer::SetIsWireframe(bool enabled) {
+    ChangeState(_state.isWireframe, enabled, "wireframe");
+}
+// visibility
+bool Renderer::GetFrustumCulling() {
+    return _state.frustumCulling;
+}
+void Renderer::SetFrustumCulling(bool enabled) {
+    _state.frustumCulling = enabled;
+}
+bool Renderer::GetOcclusionCulling() {
+    return _state.occlusionCulling;
+}
+void Renderer::SetOcclusionCulling(bool enabled) {
+    _state.occlusionCulling = enabled;
+}
+bool Renderer::GetOcclusionQueries() {
+    return _state.occlusionQueries;
+}
+void Renderer::SetOcclusionQueries(bool enabled) {
+    _state.occlusionQueries = enabled;
+}
+
+// bound objects
+std::shared_ptr<Canvas> Renderer::GetCanvas() {
+    return _canvas;
+}
+std::shared_ptr<Shader> Renderer::GetShader() {
+    ShaderHandler* shaderHandler = GetBoundShaderHandler();
+    if (shaderHandler == nullptr)
+        return nullptr;
+    return shaderHandler->shader.lock();
+}
+void Renderer::SetShader(std::shared_ptr<Shader> shader) {
+    if (shader == nullptr) {
+        MT_CORE_WARN("Renderer::SetShader(): setting shader null, won't be able to draw");
+        _shaderHandle = Handle();
+        return;
+    }
+    Handle handle = FindOrCreateShaderHandler(shader);
+    if (handle == _shaderHandle) {
+        MT_CORE_TRACE("Renderer::SetShader(): setting shader to already bound shader");
+        return;
+    }
+    std::string err = "";
+    if (!ValidateShader(shader, err)) {
+        MT_CORE_TRACE("Renderer::SetShader: can't bind shader to invalid shader");
+        return;
+    }
+    _shaderHandle = handle;
+    Record(CallType::BIND_SHADER, 0, shader->GetName());
+    _stats.programBinds++;
+}
+void Renderer::SetCanvas(std::shared_ptr<Canvas> canvas) {
+    if (canvas == _canvas)
+        return;
+    if (canvas != nullptr) {
+        int width = 0, height = 0;
+        canvas->GetPixelSize(_width, _height, width, height);
+        if (width <= 0 || height <= 0) {
+            MT_CORE_WARN("Renderer::SetCanvas: canvas has no size, canvas not bound");
+            return;
+        }
+    }
+    // queued draws belong to the previous target
+    Flush();
+    _canvas = canvas;
+    Record(CallType::BIND_CANVAS, 0, canvas != nullptr ? canvas->GetName() : "window");
+}
+bool Renderer::BindCanvasTexture(std::shared_ptr<Canvas> canvas, int attachment, int unit) {
+    if (canvas == nullptr) {
+        MT_CORE_WARN("Renderer::BindCanvasTexture: canvas is null");
+        return false;
+    }
+    if (canvas == _canvas) {
+        MT_CORE_WARN("Renderer::BindCanvasTexture: can't sample the bound canvas");
+        return false;
+    }
+    if (attachment < 0 || attachment >= (int)canvas->GetColorFormats().size()) {
+        MT_CORE_WARN("Renderer::BindCanvasTexture: canvas has no colour attachment {}", attachment);
+        return false;
+    }
+    // queued draws sample whatever was bound when they were issued
+    Flush();
+    Record(CallType::BIND_TEXTURE, 0, canvas->GetName());
+    _stats.textureBinds++;
+    return true;
+}
+
+/// --- Shader Compilation ---
+ShaderStatus Renderer::GetShaderStatus(std::shared_ptr<Shader> shader) {
+    if (shader == nullptr)
+        return ShaderStatus::INVALID;
+    return _shaderHandlers.Get(FindOrCreateShaderHandler(shader))->status;
+}
+/// NOTE: there's a single program per shader, the mesh layout doesn't select one
+ShaderStatus Renderer::GetMaterialStatus(std::shared_ptr<Material> material, std::shared_ptr<Mesh> mesh) {
+    if (material == nullptr || mesh == nullptr)
+        return ShaderStatus::INVALID;
+    return GetShaderStatus(material->GetShader());
+}
+int Renderer::PrecompileMaterials(const std::vector<PrecompileRequest>& requests) {
+    // reflection is synchronous so nothing is ever left compiling
+    for (const PrecompileRequest& request : requests) {
+        if (request.material != nullptr && request.mesh != nullptr && request.material->GetShader() != nullptr)
+            FindOrCreateShaderHandler(request.material->GetShader());
+    }
+    return 0;
+}
+bool Renderer::GetCompilePlaceholder() {
+    return _state.compilePlaceholder;
+}
+void Renderer::SetCompilePlaceholder(bool enabled) {
+    _state.compilePlaceholder = enabled;
+}
+
+/// --- Shader Methods ---
+bool Renderer::IsReservedUniform(UniformId id) const {
+    return id >= 0 && id < s_reservedUniforms.size();
+}
+
+bool Renderer::WriteUniform(UniformId id, size_t size) {
+    if (IsReservedUniform(id)) {
+        MT_CORE_WARN("Renderer::WriteUniform: uniform key is reserved");
+        return false;
+    }
+    ShaderHandler* shaderHandler = GetBoundShaderHandler();
+    if (shaderHandler == nullptr) {
+        MT_CORE_WARN("Renderer::WriteUniform: no shader bound");
+        return false;
+    }
+    if (!shaderHandler->isValid) {
+        MT_CORE_WARN("Renderer::WriteUniform: bound shader is invalid");
+        return false;
+    }
+    if (id < 0 || id >= shaderHandler->uniforms.size() || !shaderHandler->uniforms[id])
+        return false;
+    Record(CallType::SET_UNIFORM, size, GetUniformName(id));
+    _stats.uniformUploads++;
+    return true;
+}
+
+bool Renderer::SetMaterialUniforms(std::shared_ptr<Material> material) {
+    ShaderHandler* shaderHandler = GetBoundShaderHandler();
+    if (shaderHandler == nullptr) {
+        MT_CORE_WARN("Renderer::SetMaterialUniforms: no shader bound");
+        return false;
+    }
+    bool isValid = true;
+    const UniformBlockLayout& block = shaderHandler->materialBlock;
+    if (block.size > 0) {
+        int64_t uuid = material->GetUUID();
+        uint64_t key = HashBytes(&shaderHandler->materialBlockHash, sizeof(uint64_t), HashBytes(&uuid, sizeof(uuid)));
+        MaterialBuffer& materialBuffer = _materialBuffers[key];
+        // switching between shaders with the same layout keeps the buffer
+        bool isStale = materialBuffer.material.lock() != material
+            || materialBuffer.layoutHash != shaderHandler->materialBlockHash
+            || materialBuffer.version != material->GetVersion();
+        if (isStale) {
+            isValid = material->PackUniformBlock(block, materialBuffer.data);
+            materialBuffer.material = material;
+            materialBuffer.layoutHash = shaderHandler->materialBlockHash;
+            materialBuffer.version = material->GetVersion();
+            Record(CallType::UPLOAD_UNIFORM_BLOCK, materialBuffer.data.size(), material->GetName());
+            _stats.uniformUploads++;
+            _stats.bytesUploaded += materialBuffer.data.size();
+        }
+    }
+
+    // properties outside the block are set as plain uniforms
+    for (const auto& [name, value] : material->GetUniforms()) {
+        if (block.size > 0 && block.FindMember(name) != nullptr)
+            continue;
+        if (!SetUniform(name, value)) {
+            MT_CORE_WARN("Renderer::SetMaterialUniforms: failed to set uniform \"{}\"", name);
+            isValid = false;
+        }
+    }
+    return isValid;
+}
+
+bool Renderer::HasUniform(const std::string& key) {
+    return HasUniform(FindUniformId(key));
+}
+bool Renderer::HasUniform(UniformId id) {
+    ShaderHandler* shaderHandler = GetBoundShaderHandler();
+    if (shaderHandler == nullptr || IsReservedUniform(id))
+        return false;
+    return id >= 0 && id < shaderHandler->uniforms.size() && shaderHandler->uniforms[id];
+}
+
+// sizes are of the glsl types the values are uploaded as
+bool Renderer::SetUniform(const std::string& key, int value) {
+    return SetUniform(FindUniformId(key), value);
+}
+bool Renderer::SetUniform(const std::string& key, uint32_t value) {
+    return SetUniform(FindUniformId(key), value);
+}
+bool Renderer::SetUniform(const std::string& key, float value) {
+    return SetUniform(FindUniformId(key), value);
+}
+bool Renderer::SetUniform(const std::string& key, double value) {
+    return SetUniform(FindUniformId(key), value);
+}
+bool Renderer::SetUniform(const std::string& key, const LA::vec2& v) {
+    return SetUniform(FindUniformId(key), v);
+}
+bool Renderer::SetUniform(const std::string& key, float x, float y) {
+    return SetUniform(FindUniformId(key), LA::vec2({x, y}));
+}
+bool Renderer::SetUniform(const std::string& key, const LA::vec3& v) {
+    return SetUniform(FindUniformId(key), v);
+}
+bool Renderer::SetUniform(const std::string& key, float x, float y, float z) {
+    return SetUniform(FindUniformId(key), LA::vec3({x, y, z}));
+}
+bool Renderer::SetUniform(const std::string& key, const LA::vec4& v) {
+    return SetUniform(FindUniformId(key), v);
+}
+bool Renderer::SetUniform(const std::string& key, float x, float y, float z, float w) {
+    return SetUniform(FindUniformId(key), LA::vec4({x, y, z, w}));
+}
+bool Renderer::SetUniform(const std::string& key, const LA::mat2& m) {
+    return SetUniform(FindUniformId(key), m);
+}
+bool Renderer::SetUniform(const std::string& key, const LA::mat3& m) {
+    return SetUniform(FindUniformId(key), m);
+}
+bool Renderer::SetUniform(const std::string& key, const LA::mat4& m) {
+    return SetUniform(FindUniformId(key), m);
+}
+bool Renderer::SetUniform(const std::string& key, const UniformProperty& value) {
+    return SetUniform(FindUniformId(key), value);
+}
+
+bool Renderer::SetUniform(UniformId id, int value) {
+    return WriteUniform(id, sizeof(int32_t));
+}
+bool Renderer::SetUniform(UniformId id, uint32_t value) {
+    return WriteUniform(id, sizeof(uint32_t));
+}
+bool Renderer::SetUniform(UniformId id, float value) {
+    return WriteUniform(id, sizeof(float));
+}
+bool Renderer::SetUniform(UniformId id, double value) {
+    return WriteUniform(id, sizeof(double));
+}
+bool Renderer::SetUniform(UniformId id, const LA::vec2& v) {
+    return WriteUniform(id, sizeof(float) * 2);
+}
+bool Renderer::SetUniform(UniformId id, const LA::vec3& v) {
+    return WriteUniform(id, sizeof(float) * 3);
+}
+bool Renderer::SetUniform(UniformId id, const LA::vec4& v) {
+    return WriteUniform(id, sizeof(float) * 4);
+}
+bool Renderer::SetUniform(UniformId id, const LA::mat2& m) {
+    return WriteUniform(id, sizeof(float) * 4);
+}
+bool Renderer::SetUniform(UniformId id, const LA::mat3& m) {
+    return WriteUniform(id, sizeof(float) * 9);
+}
+bool Renderer::SetUniform(UniformId id, const LA::mat4& m) {
+    return WriteUniform(id, sizeof(float) * 16);
+}
+bool Renderer::SetUniform(UniformId id, const UniformProperty& value) {
+    return std::visit([this, id](const auto& v) { return SetUniform(id, v); }, value);
+}
+
+/// --- Debug Info ---
+void Renderer::NextFrame() {
+    renderer::Renderer::NextFrame();
+    CollectHandlers();
+    // occluders are submitted per frame
+    _occlusionCuller.ClearOccluders();
+    _isOcclusionDirty = true;
+}
+
+/// --- Profiling ---
+void Renderer::BeginGpuZone(const std::string& name) {
+    // draws queued before the zone belong to the enclosing one
+    Flush();
+    Record(CallType::BEGIN_ZONE, 0, name);
+    _openZones.push_back({ name, std::chrono::steady_clock::now() });
+}
+void Renderer::EndGpuZone() {
+    Flush();
+    if (_openZones.empty()) {
+        MT_CORE_WARN("Renderer::EndGpuZone: no zone open");
+        return;
+    }
+    OpenZone zone = _openZones.back();
+    _openZones.pop_back();
+    Record(CallType::END_ZONE, 0, zone.name);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - zone.start;
+    std::vector<GpuZoneSample>& history = _zoneHistory[zone.name];
+    history.push_back({
+        .name = zone.name,
+        .frameIndex = _stats.frameIndex,
+        .depth = (int)_openZones.size(),
+        .gpuTime = 0.0,
+        .cpuTime = elapsed.count()
+    });
+    if (history.size() > s_zoneHistorySize)
+        history.erase(history.begin());
+}
+std::vector<std::string> Renderer::GetGpuZoneNames() {
+    std::vector<std::string> names;
+    for (const auto& [name, history] : _zoneHistory)
+        names.push_back(name);
+    return names;
+}
+std::vector<GpuZoneSample> Renderer::GetGpuZoneHistory(const std::string& name) {
+    auto it = _zoneHistory.find(name);
+    if (it == _zoneHistory.end())
+        return {};
+    return it->second;
+}
+bool Renderer::ExportGpuZones(const std::filesystem::path& path) {
+    std::vector<GpuZoneSample> samples;
+    for (const auto& [name, history] : _zoneHistory)
+        samples.insert(samples.end(), history.begin(), history.end());
+    std::stable_sort(samples.begin(), samples.end(), [](const GpuZoneSample& a, const GpuZoneSample& b) {
+        return a.frameIndex != b.frameIndex ? a.frameIndex < b.frameIndex : a.depth < b.depth;
+    });
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        MT_CORE_WARN("Renderer::ExportGpuZones: failed to open {}", path.string());
+        return false;
+    }
+    file << "frame,zone,depth,gpu_ms,cpu_ms\n";
+    for (const GpuZoneSample& sample : samples) {
+        file << sample.frameIndex << "," << sample.name << "," << sample.depth << ","
+             << sample.gpuTime << "," << sample.cpuTime << "\n";
+    }
+    return file.good();
+}
+
+} // headless
+
+} // renderer
+
+} // marathon
@@ -1,6 +1,9 @@
 #include "renderer/material.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <cstring>
+#include "core/hash.hpp"
 #include "core/logger.hpp"
 #include "renderer/renderer.hpp"
 
@@ -8,6 +11,27 @@ namespace marathon {
 
 namespace renderer {
 
+//// UniformBlockLayout ---------------------------------------------------------
+
+const UniformBlockMember* UniformBlockLayout::FindMember(const std::string& name) const {
+    for (const auto& member : members) {
+        if (member.name == name)
+            return &member;
+    }
+    return nullptr;
+}
+
+uint64_t UniformBlockLayout::Hash() const {
+    uint64_t hash = HashBytes(&size, sizeof(size));
+    for (const auto& member : members) {
+        hash = HashString(member.name, hash);
+        size_t packing[] = {member.offset, member.matrixStride, (size_t)member.rows, (size_t)member.columns, (size_t)member.isInteger};
+        hash = HashBytes(packing, sizeof(packing), hash);
+    }
+    return hash;
+}
+
+
 //// Material -------------------------------------------------------------------
 
 Material::Material()
@@ -22,6 +46,8 @@ std::shared_ptr<Shader> Material::GetShader() const {
 }
 
 void Material::SetShader(std::shared_ptr<Shader> shader) {
+    if (_mShader != shader)
+        _mVersion++;
     _mShader = shader;
 }
 
@@ -43,7 +69,114 @@ UniformProperty Material::GetUniform(const std::string& key) const {
 }
 
 void Material::SetUniform(const std::string& key, UniformProperty value) {
+    auto it = _mUniforms.find(key);
+    if (it != _mUniforms.end() && it->second.index() == value.index()) {
+        // all alternatives are trivially copyable so compare bytes, avoids relying on LA equality
+        bool isSame = std::visit([&value](const auto& current) {
+            using T = std::decay_t<decltype(current)>;
+            return std::memcmp(&current, &std::get<T>(value), sizeof(T)) == 0;
+        }, it->second);
+        if (isSame)
+            return;
+    }
     _mUniforms[key] = value;
+    _mVersion++;
+}
+
+const std::vector<std::string>& Material::GetFeatures() const {
+    return _mFeatures;
+}
+
+bool Material::IsFeatureEnabled(const std::string& feature) const {
+    return std::find(_mFeatures.begin(), _mFeatures.end(), feature) != _mFeatures.end();
+}
+
+void Material::SetFeatureEnabled(const std::string& feature, bool enabled) {
+    auto it = std::find(_mFeatures.begin(), _mFeatures.end(), feature);
+    if (enabled && it == _mFeatures.end())
+        _mFeatures.push_back(feature);
+    else if (!enabled && it != _mFeatures.end())
+        _mFeatures.erase(it);
+}
+
+uint32_t Material::GetFeatureMask() const {
+    if (_mShader == nullptr)
+        return 0;
+    uint32_t mask = 0;
+    for (const auto& feature : _mFeatures) {
+        int index = _mShader->GetFeatureIndex(feature);
+        if (index != -1)
+            mask |= 1u << index;
+    }
+    return mask;
+}
+
+uint32_t Material::GetVersion() const {
+    return _mVersion;
+}
+
+bool Material::PackUniformBlock(const UniformBlockLayout& layout, std::vector<uint8_t>& data) const {
+    data.assign(layout.size, 0);
+    bool isValid = true;
+    for (const auto& member : layout.members) {
+        auto it = _mUniforms.find(member.name);
+        if (it == _mUniforms.end())
+            continue;
+
+        // flatten property into column major components
+        float floats[16] = {};
+        int32_t ints[4] = {};
+        int rows = 1, columns = 1;
+        bool isInteger = false;
+        std::visit([&](const auto& v) {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, int> || std::is_same_v<T, uint32_t>) {
+                ints[0] = (int32_t)v;
+                isInteger = true;
+            } else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+                // glsl 330 has no doubles, narrowed to float
+                floats[0] = (float)v;
+            } else if constexpr (std::is_same_v<T, LA::vec2>) {
+                rows = 2;
+                floats[0] = v.x; floats[1] = v.y;
+            } else if constexpr (std::is_same_v<T, LA::vec3>) {
+                rows = 3;
+                floats[0] = v.x; floats[1] = v.y; floats[2] = v.z;
+            } else if constexpr (std::is_same_v<T, LA::vec4>) {
+                rows = 4;
+                floats[0] = v.x; floats[1] = v.y; floats[2] = v.z; floats[3] = v.w;
+            } else {
+                // matrices, mat2/mat3/mat4
+                constexpr int n = std::is_same_v<T, LA::mat2> ? 2 : std::is_same_v<T, LA::mat3> ? 3 : 4;
+                rows = n;
+                columns = n;
+                for (int c = 0; c < n; c++)
+                    for (int r = 0; r < n; r++)
+                        floats[c * n + r] = v[c][r];
+            }
+        }, it->second);
+
+        if (rows != member.rows || columns != member.columns || isInteger != member.isInteger) {
+            MT_CORE_WARN("Material::PackUniformBlock(): uniform \"{}\" type does not match block \"{}\"", member.name, layout.name);
+            isValid = false;
+            continue;
+        }
+        size_t end = member.offset + (columns - 1) * member.matrixStride + rows * sizeof(float);
+        if (end > data.size()) {
+            MT_CORE_WARN("Material::PackUniformBlock(): uniform \"{}\" outside block \"{}\"", member.name, layout.name);
+            isValid = false;
+            continue;
+        }
+        if (isInteger) {
+            std::memcpy(data.data() + member.offset, ints, sizeof(int32_t));
+            continue;
+        }
+        for (int c = 0; c < columns; c++) {
+            size_t offset = member.offset + c * member.matrixStride;
+            std::memcpy(data.data() + offset, floats + c * rows, rows * sizeof(float));
+        }
+    }
+    return isValid;
 }
 
 
@@ -53,14 +186,16 @@ std::string ColourMaterial::_sVertexSource = R"(
 void main()
 {
     varying_position = vec4(vertex_position, 1.0f);
-	gl_Position =  u_projection * u_view * u_model * vec4(vertex_position, 1.0f);
+	gl_Position =  u_projection * u_view * u_model * instance_model * vec4(vertex_position, 1.0f);
 }
 )";
 std::string ColourMaterial::_sFragmentSource = R"(
 // outputs
 layout(location = 0) out vec4 out_color;
 
-uniform vec4 u_colour;
+layout(std140) uniform MaterialProperties {
+    vec4 u_colour;
+};
 
 void main()
 {
@@ -99,7 +234,7 @@ void ColourMaterial::SetColour(LA::vec4 colour) {
         MT_CORE_WARN("ColourMaterial::SetColour(): uniform \"u_colour\" not found in material uniforms");
     }
     // assign/reassign/create either way
-    _mUniforms["u_colour"] = colour;
+    SetUniform("u_colour", colour);
 }
 
 } // renderer
@@ -1,5 +1,9 @@
 #include "renderer/mesh.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
 #include "core/logger.hpp"
 
 namespace marathon {
@@ -7,6 +11,61 @@ namespace marathon {
 namespace renderer {
 
 
+/// --- DirtyRangeSet ---
+void DirtyRangeSet::Add(size_t offset, size_t size) {
+    if (size == 0)
+        return;
+    // insert in order then merge overlapping or touching neighbours
+    auto it = std::lower_bound(_ranges.begin(), _ranges.end(), offset,
+        [](const DataRange& r, size_t o) { return r.offset < o; });
+    _ranges.insert(it, {offset, size});
+    std::vector<DataRange> merged;
+    merged.reserve(_ranges.size());
+    for (const DataRange& r : _ranges) {
+        if (!merged.empty() && r.offset <= merged.back().offset + merged.back().size) {
+            size_t end = std::max(merged.back().offset + merged.back().size, r.offset + r.size);
+            merged.back().size = end - merged.back().offset;
+        } else {
+            merged.push_back(r);
+        }
+    }
+    // over capacity, close the smallest gap
+    while (merged.size() > s_maxRanges) {
+        size_t best = 0;
+        size_t bestGap = SIZE_MAX;
+        for (size_t i = 0; i + 1 < merged.size(); i++) {
+            size_t gap = merged[i + 1].offset - (merged[i].offset + merged[i].size);
+            if (gap < bestGap) {
+                bestGap = gap;
+                best = i;
+            }
+        }
+        merged[best].size = merged[best + 1].offset + merged[best + 1].size - merged[best].offset;
+        merged.erase(merged.begin() + best + 1);
+    }
+    _ranges.swap(merged);
+}
+
+void DirtyRangeSet::Clear() {
+    _ranges.clear();
+}
+
+bool DirtyRangeSet::Empty() const {
+    return _ranges.empty();
+}
+
+const std::vector<DataRange>& DirtyRangeSet::GetRanges() const {
+    return _ranges;
+}
+
+size_t DirtyRangeSet::GetSize() const {
+    size_t size = 0;
+    for (const DataRange& r : _ranges)
+        size += r.size;
+    return size;
+}
+
+
 /// --- INTERNAL ---
 /// TODO: Implement a dictionary to cache indexes instead of linear search everytime for big speed improvement
 // find index of attribute in descriptor list or return -1 if not found
@@ -55,6 +114,7 @@ void Mesh::ClearVertices() {
 
 void Mesh::ClearVertexDirtyFlag() {
     _vertexDataDirty = DataDirty::CLEAN;
+    _vertexDirtyRanges.Clear();
 }
 
 const void* Mesh::GetVertexPtr() const {
@@ -73,6 +133,10 @@ DataDirty Mesh::GetVertexDirtyFlag() const {
     return _vertexDataDirty;
 }
 
+const DirtyRangeSet& Mesh::GetVertexDirtyRanges() const {
+    return _vertexDirtyRanges;
+}
+
 // return false if failed to find attribute
 bool Mesh::HasVertexAttribute(VertexAttribute attr) const {
     return GetVertexAttributeIndex(attr) != -1;
@@ -135,6 +199,11 @@ void Mesh::SetVertexParams(int vertexCount, std::vector<VertexAttributeDescripto
     _vertexAttributeDescriptors = attributes;
     _vertexData = malloc(GetVertexSize() * vertexCount);
     _vertexDataDirty = DataDirty::DIRTY_REALLOC;
+    // whole buffer is reuploaded so ranges are redundant
+    _vertexDirtyRanges.Clear();
+    // vertex data is uninitialised until set
+    _bounds = Bounds();
+    _isBoundsDirty = false;
 }
 
 void Mesh::SetVertexData(void* data, size_t size, size_t src_start, size_t dest_start) {
@@ -153,9 +222,14 @@ void Mesh::SetVertexData(void* data, size_t size, size_t src_start, size_t dest_
     }
     // copy data
     memcpy(_vertexData + dest_start, data + src_start, size);
+    // edits of other attributes leave bounds as they are
+    if (IsPositionRange(dest_start, size))
+        _isBoundsDirty = true;
     // realloc takes precident over update
-    if (_vertexDataDirty != DataDirty::DIRTY_REALLOC) 
+    if (_vertexDataDirty != DataDirty::DIRTY_REALLOC) {
         _vertexDataDirty = DataDirty::DIRTY_UPDATE;
+        _vertexDirtyRanges.Add(dest_start, size);
+    }
 }
 
 
@@ -175,6 +249,7 @@ void Mesh::ClearIndices() {
 
 void Mesh::ClearIndexDirtyFlag() {
     _indexDataDirty = DataDirty::CLEAN;
+    _indexDirtyRanges.Clear();
 }
 
 const void* Mesh::GetIndexPtr() const {
@@ -193,6 +268,10 @@ DataDirty Mesh::GetIndexDirtyFlag() const {
     return _indexDataDirty;
 }
 
+const DirtyRangeSet& Mesh::GetIndexDirtyRanges() const {
+    return _indexDirtyRanges;
+}
+
 IndexFormat Mesh::GetIndexFormat() const {
     return _indexFormat;
 }
@@ -209,6 +288,7 @@ void Mesh::SetIndexParams(int indexCount, IndexFormat format, PrimitiveType prim
     _primitive = primitive;
     _indexData = malloc(s_indexFormatMap.at(format) * indexCount);
     _indexDataDirty = DataDirty::DIRTY_REALLOC;
+    _indexDirtyRanges.Clear();
 }
 
 void Mesh::SetIndexData(void* data, size_t size, size_t src_start, size_t dest_start) {
@@ -226,8 +306,10 @@ void Mesh::SetIndexData(void* data, size_t size, size_t src_start, size_t dest_s
     }
     memcpy(_indexData + dest_start, data + src_start, size);
     // realloc takes precident over update
-    if (_indexDataDirty != DataDirty::DIRTY_REALLOC) 
+    if (_indexDataDirty != DataDirty::DIRTY_REALLOC) {
         _indexDataDirty = DataDirty::DIRTY_UPDATE;
+        _indexDirtyRanges.Add(dest_start, size);
+    }
 
 }
 
@@ -253,6 +335,95 @@ void Mesh::SetMaterial(std::shared_ptr<Material> material) {
     _material = material;
 }
 
+BufferUsage Mesh::GetBufferUsage() const {
+    return _usage;
+}
+
+const Bounds& Mesh::GetBounds() const {
+    return _bounds;
+}
+
+/// NOTE: recalculates over every vertex as a shrinking range can't be handled incrementally
+/// so any number of position edits between updates cost a single pass
+void Mesh::UpdateBounds() {
+    if (!_isBoundsDirty)
+        return;
+    _isBoundsDirty = false;
+    CalculateBounds();
+}
+
+bool Mesh::IsPositionRange(size_t offset, size_t size) const {
+    VertexAttributeFormat format = GetVertexAttributeFormat(VertexAttribute::POSITION);
+    int components = GetVertexAttributeComponents(VertexAttribute::POSITION);
+    size_t stride = GetVertexSize();
+    if (size == 0 || components == 0 || stride == 0 || s_vertexAttributeFormatMap.count(format) == 0)
+        return false;
+    if (size >= stride)
+        return true;
+    size_t begin = GetVertexAttributeOffset(VertexAttribute::POSITION);
+    size_t end = begin + s_vertexAttributeFormatMap.at(format) * components;
+    // shorter than a vertex so spans at most two
+    for (size_t vertex = offset / stride; vertex * stride < offset + size; vertex++) {
+        size_t base = vertex * stride;
+        if (offset < base + end && offset + size > base + begin)
+            return true;
+    }
+    return false;
+}
+
+void Mesh::CalculateBounds() {
+    _bounds = Bounds();
+    VertexAttributeFormat format = GetVertexAttributeFormat(VertexAttribute::POSITION);
+    int components = std::min(GetVertexAttributeComponents(VertexAttribute::POSITION), 3);
+    if (_vertexData == nullptr || _vertexCount == 0 || components == 0
+        || (format != VertexAttributeFormat::FLOAT && format != VertexAttributeFormat::DOUBLE))
+        return;
+
+    size_t stride = GetVertexSize();
+    const uint8_t* base = (const uint8_t*)_vertexData + GetVertexAttributeOffset(VertexAttribute::POSITION);
+    auto position = [&](int vertex) {
+        // missing components are 0 as for the vertex attribute
+        float p[3] = {0.0f, 0.0f, 0.0f};
+        const uint8_t* src = base + vertex * stride;
+        for (int c = 0; c < components; c++)
+            p[c] = format == VertexAttributeFormat::FLOAT ? ((const float*)src)[c] : (float)((const double*)src)[c];
+        return LA::vec3({p[0], p[1], p[2]});
+    };
+
+    LA::vec3 min = position(0);
+    LA::vec3 max = min;
+    for (int i = 1; i < _vertexCount; i++) {
+        LA::vec3 p = position(i);
+        min.x = std::min(min.x, p.x); min.y = std::min(min.y, p.y); min.z = std::min(min.z, p.z);
+        max.x = std::max(max.x, p.x); max.y = std::max(max.y, p.y); max.z = std::max(max.z, p.z);
+    }
+    LA::vec3 center = {(min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f};
+    // second pass as the furthest vertex is tighter than the box corner
+    float radiusSq = 0.0f;
+    for (int i = 0; i < _vertexCount; i++) {
+        LA::vec3 p = position(i);
+        float dx = p.x - center.x, dy = p.y - center.y, dz = p.z - center.z;
+        radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+    }
+    _bounds.min = min;
+    _bounds.max = max;
+    _bounds.center = center;
+    _bounds.radius = std::sqrt(radiusSq);
+    _bounds.isValid = true;
+}
+
+void Mesh::SetBufferUsage(BufferUsage usage) {
+    _usage = usage;
+}
+
+bool Mesh::GetOcclusionQuery() const {
+    return _occlusionQuery;
+}
+
+void Mesh::SetOcclusionQuery(bool enabled) {
+    _occlusionQuery = enabled;
+}
+
 
 /// --- BoxMesh --- ///
 /// TODO: allow for not always reallocating during generation
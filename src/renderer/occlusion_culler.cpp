@@ -0,0 +1,421 @@
+#include "renderer/occlusion_culler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "core/logger.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace {
+
+// clip space w below this is treated as crossing the near plane
+constexpr float s_minW = 1e-5f;
+
+struct ClipVertex {
+    float x, y, z, w;
+};
+
+// matrices are column major, m[c][r]
+ClipVertex Transform(const LA::mat4& m, float x, float y, float z) {
+    return ClipVertex {
+        m[0][0] * x + m[1][0] * y + m[2][0] * z + m[3][0],
+        m[0][1] * x + m[1][1] * y + m[2][1] * z + m[3][1],
+        m[0][2] * x + m[1][2] * y + m[2][2] * z + m[3][2],
+        m[0][3] * x + m[1][3] * y + m[2][3] * z + m[3][3]
+    };
+}
+
+} // namespace
+
+OcclusionCuller::OcclusionCuller(int width, int height) {
+    SetResolution(width, height);
+    SetThreadCount(0);
+}
+
+OcclusionCuller::~OcclusionCuller() {
+    StopWorkers();
+}
+
+void OcclusionCuller::SetResolution(int width, int height) {
+    _width = std::max(width, 1);
+    _height = std::max(height, 1);
+    _levels.clear();
+    // start empty so everything is visible until rasterised
+    Level level;
+    level.width = _width;
+    level.height = _height;
+    level.minDepth.assign((size_t)_width * _height, 1.0f);
+    level.maxDepth.assign((size_t)_width * _height, 1.0f);
+    _levels.push_back(std::move(level));
+}
+
+void OcclusionCuller::SetThreadCount(int threadCount) {
+    if (threadCount <= 0)
+        threadCount = (int)std::thread::hardware_concurrency();
+    threadCount = std::clamp(threadCount, 1, s_maxThreads);
+    if (threadCount != _threadCount)
+        StopWorkers();
+    _threadCount = threadCount;
+}
+
+void OcclusionCuller::StartWorkers() {
+    _isStopping = false;
+    for (int band = 1; band < _threadCount; band++)
+        _workers.emplace_back(&OcclusionCuller::WorkerLoop, this, band);
+}
+
+void OcclusionCuller::StopWorkers() {
+    if (_workers.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(_workerMutex);
+        _isStopping = true;
+    }
+    _workCondition.notify_all();
+    for (std::thread& worker : _workers)
+        worker.join();
+    _workers.clear();
+}
+
+void OcclusionCuller::WorkerLoop(int band) {
+    int dispatch = 0;
+    while (true) {
+        int rowBegin, rowEnd;
+        {
+            std::unique_lock<std::mutex> lock(_workerMutex);
+            _workCondition.wait(lock, [&]() { return _isStopping || (_dispatch != dispatch && band < _bandCount); });
+            if (_isStopping)
+                return;
+            dispatch = _dispatch;
+            rowBegin = std::min(band * _bandHeight, _height);
+            rowEnd = std::min(rowBegin + _bandHeight, _height);
+        }
+        RasteriseRows(rowBegin, rowEnd);
+        {
+            std::lock_guard<std::mutex> lock(_workerMutex);
+            _pendingBands--;
+        }
+        _doneCondition.notify_one();
+    }
+}
+
+bool OcclusionCuller::AddOccluder(const Mesh& mesh, const LA::mat4& model) {
+    VertexAttributeFormat format = mesh.GetVertexAttributeFormat(VertexAttribute::POSITION);
+    int components = std::min(mesh.GetVertexAttributeComponents(VertexAttribute::POSITION), 3);
+    const void* vertexData = mesh.GetVertexPtr();
+    int vertexCount = mesh.GetVertexCount();
+    if (vertexData == nullptr || vertexCount == 0 || components == 0
+        || (format != VertexAttributeFormat::FLOAT && format != VertexAttributeFormat::DOUBLE)) {
+        MT_CORE_WARN("OcclusionCuller::AddOccluder: mesh has no readable float positions");
+        return false;
+    }
+
+    // world space positions, model is affine
+    uint32_t baseVertex = (uint32_t)_vertices.size();
+    size_t stride = mesh.GetVertexSize();
+    const uint8_t* base = (const uint8_t*)vertexData + mesh.GetVertexAttributeOffset(VertexAttribute::POSITION);
+    for (int i = 0; i < vertexCount; i++) {
+        float p[3] = {0.0f, 0.0f, 0.0f};
+        const uint8_t* src = base + i * stride;
+        for (int c = 0; c < components; c++)
+            p[c] = format == VertexAttributeFormat::FLOAT ? ((const float*)src)[c] : (float)((const double*)src)[c];
+        ClipVertex v = Transform(model, p[0], p[1], p[2]);
+        _vertices.push_back(LA::vec3({v.x, v.y, v.z}));
+    }
+
+    // non indexed meshes draw vertices in order
+    const void* indexData = mesh.GetIndexPtr();
+    int indexCount = indexData != nullptr ? mesh.GetIndexCount() : vertexCount;
+    IndexFormat indexFormat = mesh.GetIndexFormat();
+    auto index = [&](int i) -> uint32_t {
+        if (indexData == nullptr)
+            return (uint32_t)i;
+        switch (indexFormat) {
+            case IndexFormat::UINT8:
+                return ((const uint8_t*)indexData)[i];
+            case IndexFormat::UINT16:
+                return ((const uint16_t*)indexData)[i];
+            case IndexFormat::UINT32:
+                return ((const uint32_t*)indexData)[i];
+            default:
+                return UINT32_MAX;
+        }
+    };
+    auto addTriangle = [&](int a, int b, int c) {
+        uint32_t ia = index(a), ib = index(b), ic = index(c);
+        if (ia >= (uint32_t)vertexCount || ib >= (uint32_t)vertexCount || ic >= (uint32_t)vertexCount)
+            return;
+        _indices.push_back(baseVertex + ia);
+        _indices.push_back(baseVertex + ib);
+        _indices.push_back(baseVertex + ic);
+    };
+
+    // winding is irrelevant as both faces are rasterised
+    switch (mesh.GetPrimitiveType()) {
+        case PrimitiveType::TRIANGLES:
+            for (int i = 0; i + 2 < indexCount; i += 3)
+                addTriangle(i, i + 1, i + 2);
+            break;
+        case PrimitiveType::STRIP:
+            for (int i = 0; i + 2 < indexCount; i++)
+                addTriangle(i, i + 1, i + 2);
+            break;
+        case PrimitiveType::FAN:
+            for (int i = 1; i + 1 < indexCount; i++)
+                addTriangle(0, i, i + 1);
+            break;
+        default:
+            MT_CORE_WARN("OcclusionCuller::AddOccluder: invalid primitive type");
+            _vertices.resize(baseVertex);
+            return false;
+    }
+    return true;
+}
+
+void OcclusionCuller::ClearOccluders() {
+    _vertices.clear();
+    _indices.clear();
+    _triangles.clear();
+}
+
+bool OcclusionCuller::HasOccluders() const {
+    return !_indices.empty();
+}
+
+size_t OcclusionCuller::GetTriangleCount() const {
+    return _indices.size() / 3;
+}
+
+void OcclusionCuller::SetupTriangles() {
+    _triangles.clear();
+    float width = (float)_width;
+    float height = (float)_height;
+    for (size_t i = 0; i + 2 < _indices.size(); i += 3) {
+        Triangle tri;
+        bool isValid = true;
+        for (int v = 0; v < 3; v++) {
+            const LA::vec3& p = _vertices[_indices[i + v]];
+            ClipVertex c = Transform(_viewProjection, p.x, p.y, p.z);
+            if (c.w <= s_minW) {
+                isValid = false;
+                break;
+            }
+            float invW = 1.0f / c.w;
+            tri.x[v] = (c.x * invW * 0.5f + 0.5f) * width;
+            tri.y[v] = (c.y * invW * 0.5f + 0.5f) * height;
+            tri.z[v] = c.z * invW * 0.5f + 0.5f;
+            // in front of the near plane
+            if (tri.z[v] < 0.0f)
+                isValid = false;
+        }
+        if (!isValid)
+            continue;
+        // trivially off screen or beyond the far plane
+        if (std::max({tri.x[0], tri.x[1], tri.x[2]}) < 0.0f || std::min({tri.x[0], tri.x[1], tri.x[2]}) > width
+            || std::max({tri.y[0], tri.y[1], tri.y[2]}) < 0.0f || std::min({tri.y[0], tri.y[1], tri.y[2]}) > height
+            || std::min({tri.z[0], tri.z[1], tri.z[2]}) > 1.0f)
+            continue;
+        _triangles.push_back(tri);
+    }
+}
+
+/// NOTE: inner loop is branchless on plain float arrays so compilers auto vectorise it
+/// edge functions & depth are planes in screen space so are evaluated directly per pixel
+void OcclusionCuller::RasteriseRows(int rowBegin, int rowEnd) {
+    float* depth = _levels[0].minDepth.data();
+    for (const Triangle& tri : _triangles) {
+        float x0 = tri.x[0], y0 = tri.y[0];
+        float x1 = tri.x[1], y1 = tri.y[1];
+        float x2 = tri.x[2], y2 = tri.y[2];
+        float z0 = tri.z[0], z1 = tri.z[1], z2 = tri.z[2];
+        float area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+        if (std::abs(area) < 1e-8f)
+            continue;
+        // make counter clockwise so inside is positive for every edge
+        if (area < 0.0f) {
+            std::swap(x1, x2);
+            std::swap(y1, y2);
+            std::swap(z1, z2);
+            area = -area;
+        }
+
+        int minX = std::max((int)std::floor(std::min({x0, x1, x2})), 0);
+        int maxX = std::min((int)std::ceil(std::max({x0, x1, x2})), _width - 1);
+        int minY = std::max((int)std::floor(std::min({y0, y1, y2})), rowBegin);
+        int maxY = std::min((int)std::ceil(std::max({y0, y1, y2})), rowEnd - 1);
+        if (minX > maxX || minY > maxY)
+            continue;
+
+        // e(px, py) = a * px + b * py + c, edge i is opposite vertex i
+        float a0 = y1 - y2, b0 = x2 - x1, c0 = x1 * y2 - x2 * y1;
+        float a1 = y2 - y0, b1 = x0 - x2, c1 = x2 * y0 - x0 * y2;
+        float a2 = y0 - y1, b2 = x1 - x0, c2 = x0 * y1 - x1 * y0;
+        // z = barycentric weighted depth, also a plane
+        float invArea = 1.0f / area;
+        float za = (a0 * z0 + a1 * z1 + a2 * z2) * invArea;
+        float zb = (b0 * z0 + b1 * z1 + b2 * z2) * invArea;
+        float zc = (c0 * z0 + c1 * z1 + c2 * z2) * invArea;
+
+        for (int y = minY; y <= maxY; y++) {
+            float py = (float)y + 0.5f;
+            float r0 = b0 * py + c0;
+            float r1 = b1 * py + c1;
+            float r2 = b2 * py + c2;
+            float rz = zb * py + zc;
+            float* row = depth + (size_t)y * _width;
+            for (int x = minX; x <= maxX; x++) {
+                float px = (float)x + 0.5f;
+                float e0 = a0 * px + r0;
+                float e1 = a1 * px + r1;
+                float e2 = a2 * px + r2;
+                float z = za * px + rz;
+                bool inside = (e0 >= 0.0f) & (e1 >= 0.0f) & (e2 >= 0.0f);
+                float d = row[x];
+                row[x] = inside && z < d ? z : d;
+            }
+        }
+    }
+}
+
+void OcclusionCuller::BuildHierarchy() {
+    _levels.resize(1);
+    _levels[0].maxDepth = _levels[0].minDepth;
+    while (_levels.back().width > 1 || _levels.back().height > 1) {
+        const Level& src = _levels.back();
+        Level dst;
+        dst.width = (src.width + 1) / 2;
+        dst.height = (src.height + 1) / 2;
+        dst.minDepth.resize((size_t)dst.width * dst.height);
+        dst.maxDepth.resize((size_t)dst.width * dst.height);
+        for (int y = 0; y < dst.height; y++) {
+            // odd sizes reuse the last row/column
+            int sy0 = y * 2;
+            int sy1 = std::min(sy0 + 1, src.height - 1);
+            for (int x = 0; x < dst.width; x++) {
+                int sx0 = x * 2;
+                int sx1 = std::min(sx0 + 1, src.width - 1);
+                size_t i00 = (size_t)sy0 * src.width + sx0, i01 = (size_t)sy0 * src.width + sx1;
+                size_t i10 = (size_t)sy1 * src.width + sx0, i11 = (size_t)sy1 * src.width + sx1;
+                size_t dstIndex = (size_t)y * dst.width + x;
+                dst.minDepth[dstIndex] = std::min({src.minDepth[i00], src.minDepth[i01], src.minDepth[i10], src.minDepth[i11]});
+                dst.maxDepth[dstIndex] = std::max({src.maxDepth[i00], src.maxDepth[i01], src.maxDepth[i10], src.maxDepth[i11]});
+            }
+        }
+        _levels.push_back(std::move(dst));
+    }
+}
+
+void OcclusionCuller::Rasterise(const LA::mat4& viewProjection) {
+    _viewProjection = viewProjection;
+    _levels.resize(1);
+    std::fill(_levels[0].minDepth.begin(), _levels[0].minDepth.end(), 1.0f);
+    SetupTriangles();
+
+    int threadCount = _triangles.size() >= s_minThreadedTriangles ? std::min(_threadCount, _height) : 1;
+    if (threadCount <= 1) {
+        RasteriseRows(0, _height);
+    } else {
+        // bands don't overlap so threads never write the same pixel
+        if (_workers.empty())
+            StartWorkers();
+        int bandHeight = (_height + threadCount - 1) / threadCount;
+        {
+            std::lock_guard<std::mutex> lock(_workerMutex);
+            _dispatch++;
+            _bandCount = threadCount;
+            _bandHeight = bandHeight;
+            _pendingBands = threadCount - 1;
+        }
+        _workCondition.notify_all();
+        RasteriseRows(0, std::min(bandHeight, _height));
+        std::unique_lock<std::mutex> lock(_workerMutex);
+        _doneCondition.wait(lock, [this]() { return _pendingBands == 0; });
+    }
+    BuildHierarchy();
+}
+
+bool OcclusionCuller::IsVisible(const Bounds& bounds, const LA::mat4& model) const {
+    if (!bounds.isValid || _triangles.empty() || _levels.size() < 2)
+        return true;
+
+    // screen rect & nearest depth of the box corners
+    LA::mat4 mvp = _viewProjection * model;
+    float minX = INFINITY, maxX = -INFINITY;
+    float minY = INFINITY, maxY = -INFINITY;
+    float minZ = INFINITY;
+    for (int i = 0; i < 8; i++) {
+        ClipVertex c = Transform(mvp,
+            (i & 1) ? bounds.max.x : bounds.min.x,
+            (i & 2) ? bounds.max.y : bounds.min.y,
+            (i & 4) ? bounds.max.z : bounds.min.z);
+        // crosses the near plane so can't be behind anything
+        if (c.w <= s_minW)
+            return true;
+        float invW = 1.0f / c.w;
+        float sx = (c.x * invW * 0.5f + 0.5f) * _width;
+        float sy = (c.y * invW * 0.5f + 0.5f) * _height;
+        minX = std::min(minX, sx); maxX = std::max(maxX, sx);
+        minY = std::min(minY, sy); maxY = std::max(maxY, sy);
+        minZ = std::min(minZ, c.z * invW * 0.5f + 0.5f);
+    }
+    // off screen is left to frustum culling
+    if (maxX < 0.0f || maxY < 0.0f || minX >= (float)_width || minY >= (float)_height)
+        return true;
+    int x0 = std::clamp((int)std::floor(minX), 0, _width - 1);
+    int x1 = std::clamp((int)std::floor(maxX), 0, _width - 1);
+    int y0 = std::clamp((int)std::floor(minY), 0, _height - 1);
+    int y1 = std::clamp((int)std::floor(maxY), 0, _height - 1);
+
+    // finest level where the rect covers at most s_maxTestTexels per axis
+    int last = (int)_levels.size() - 1;
+    int level = 0;
+    while (level < last && ((x1 >> level) - (x0 >> level) >= s_maxTestTexels
+        || (y1 >> level) - (y0 >> level) >= s_maxTestTexels))
+        level++;
+
+    // coarse pass, nearer than every occluder in a texel means visible, further than all means occluded
+    int coarse = std::min(level + 2, last);
+    const Level& coarseLevel = _levels[coarse];
+    bool isOccluded = true;
+    for (int y = y0 >> coarse; y <= y1 >> coarse; y++) {
+        for (int x = x0 >> coarse; x <= x1 >> coarse; x++) {
+            size_t i = (size_t)y * coarseLevel.width + x;
+            if (minZ <= coarseLevel.minDepth[i])
+                return true;
+            if (minZ <= coarseLevel.maxDepth[i])
+                isOccluded = false;
+        }
+    }
+    if (isOccluded || coarse == level)
+        return !isOccluded;
+
+    // fine pass over the furthest occluder depths
+    const Level& fineLevel = _levels[level];
+    for (int y = y0 >> level; y <= y1 >> level; y++) {
+        for (int x = x0 >> level; x <= x1 >> level; x++) {
+            if (minZ <= fineLevel.maxDepth[(size_t)y * fineLevel.width + x])
+                return true;
+        }
+    }
+    return false;
+}
+
+int OcclusionCuller::GetWidth() const {
+    return _width;
+}
+
+int OcclusionCuller::GetHeight() const {
+    return _height;
+}
+
+const std::vector<float>& OcclusionCuller::GetDepthBuffer() const {
+    return _levels[0].minDepth;
+}
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,155 @@
+#include "renderer/opengl/gpu_profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include "core/logger.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace opengl {
+
+GpuProfiler::~GpuProfiler() {
+    if (!_queries.empty())
+        glDeleteQueries(_queries.size(), _queries.data());
+}
+
+GLuint GpuProfiler::AcquireQuery() {
+    if (_queryPool.empty()) {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        _queries.push_back(query);
+        return query;
+    }
+    GLuint query = _queryPool.back();
+    _queryPool.pop_back();
+    return query;
+}
+
+void GpuProfiler::ReleaseFrame(Frame& frame) {
+    for (const Zone& zone : frame.zones) {
+        _queryPool.push_back(zone.beginQuery);
+        _queryPool.push_back(zone.endQuery);
+    }
+    frame.zones.clear();
+    frame.lastQuery = 0;
+}
+
+bool GpuProfiler::ReadFrame(Frame& frame) {
+    // queries complete in submission order, so the last one being ready means all are
+    if (frame.lastQuery != 0) {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+    for (const Zone& zone : frame.zones) {
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(zone.beginQuery, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(zone.endQuery, GL_QUERY_RESULT, &end);
+        GpuZoneSample sample = {
+            .name = zone.name,
+            .frameIndex = frame.frameIndex,
+            .depth = zone.depth,
+            .gpuTime = (end - begin) / 1e6,
+            .cpuTime = std::chrono::duration<double, std::milli>(zone.cpuEnd - zone.cpuBegin).count()
+        };
+        std::deque<GpuZoneSample>& history = _history[zone.name];
+        history.push_back(sample);
+        if (history.size() > s_historySize)
+            history.pop_front();
+    }
+    ReleaseFrame(frame);
+    return true;
+}
+
+void GpuProfiler::BeginZone(const std::string& name) {
+    Zone zone = {
+        .name = name,
+        .depth = (int)_openZones.size(),
+        .beginQuery = AcquireQuery(),
+        .cpuBegin = std::chrono::steady_clock::now()
+    };
+    glQueryCounter(zone.beginQuery, GL_TIMESTAMP);
+    _openZones.push_back(_frame.zones.size());
+    _frame.zones.push_back(zone);
+}
+
+void GpuProfiler::EndZone() {
+    if (_openZones.empty()) {
+        MT_CORE_WARN("GpuProfiler::EndZone: no zone open");
+        return;
+    }
+    Zone& zone = _frame.zones[_openZones.back()];
+    _openZones.pop_back();
+    zone.endQuery = AcquireQuery();
+    zone.cpuEnd = std::chrono::steady_clock::now();
+    glQueryCounter(zone.endQuery, GL_TIMESTAMP);
+    _frame.lastQuery = zone.endQuery;
+}
+
+void GpuProfiler::NextFrame(int frameIndex) {
+    if (!_openZones.empty()) {
+        MT_CORE_WARN("GpuProfiler::NextFrame: {} zones left open, closing them", _openZones.size());
+        while (!_openZones.empty())
+            EndZone();
+    }
+    if (!_frame.zones.empty())
+        _pendingFrames.push_back(std::move(_frame));
+    _frame = Frame();
+    _frame.frameIndex = frameIndex;
+
+    while (!_pendingFrames.empty() && ReadFrame(_pendingFrames.front()))
+        _pendingFrames.pop_front();
+    // never wait on the gpu, drop results that are taking too long
+    while (_pendingFrames.size() > s_maxPendingFrames) {
+        MT_CORE_DEBUG("GpuProfiler::NextFrame: dropping zones of frame {}", _pendingFrames.front().frameIndex);
+        ReleaseFrame(_pendingFrames.front());
+        _pendingFrames.pop_front();
+    }
+}
+
+std::vector<std::string> GpuProfiler::GetZoneNames() const {
+    std::vector<std::string> names;
+    for (const auto& [name, history] : _history)
+        names.push_back(name);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+std::vector<GpuZoneSample> GpuProfiler::GetHistory(const std::string& name) const {
+    auto it = _history.find(name);
+    if (it == _history.end())
+        return {};
+    return std::vector<GpuZoneSample>(it->second.begin(), it->second.end());
+}
+
+bool GpuProfiler::Export(const std::filesystem::path& path) const {
+    std::vector<GpuZoneSample> samples;
+    for (const auto& [name, history] : _history)
+        samples.insert(samples.end(), history.begin(), history.end());
+    std::stable_sort(samples.begin(), samples.end(), [](const GpuZoneSample& a, const GpuZoneSample& b) {
+        return a.frameIndex != b.frameIndex ? a.frameIndex < b.frameIndex : a.depth < b.depth;
+    });
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        MT_CORE_WARN("GpuProfiler::Export: failed to open {}", path.string());
+        return false;
+    }
+    file << "frame,zone,depth,gpu_ms,cpu_ms\n";
+    for (const GpuZoneSample& sample : samples) {
+        file << sample.frameIndex << "," << sample.name << "," << sample.depth << ","
+             << sample.gpuTime << "," << sample.cpuTime << "\n";
+    }
+    return file.good();
+}
+
+} // opengl
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,186 @@
+#include "renderer/opengl/mesh_pool.hpp"
+
+#include <algorithm>
+
+#include "core/logger.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace opengl {
+
+MeshPool::MeshPool(StateCache& glState, const std::vector<VertexBinding>& bindings, size_t vertexSize, size_t indexSize)
+    : _glState(glState),
+      _bindings(bindings),
+      _vertexSize(vertexSize),
+      _indexSize(indexSize) {
+    glGenVertexArrays(1, &_vao);
+    glGenBuffers(1, &_vbo);
+    glGenBuffers(1, &_ibo);
+
+    _vertexCapacity = s_initialVertexCapacity;
+    _indexCapacity = s_initialIndexCapacity;
+    _glState.BindVertexArray(_vao);
+    _glState.BindBuffer(GL_ARRAY_BUFFER, _vbo);
+    glBufferData(GL_ARRAY_BUFFER, _vertexCapacity * _vertexSize, nullptr, GL_STATIC_DRAW);
+    _glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indexCapacity * _indexSize, nullptr, GL_STATIC_DRAW);
+    BindVertexLayout();
+}
+
+MeshPool::~MeshPool() {
+    _glState.OnDeleteVertexArray(_vao);
+    _glState.OnDeleteBuffer(_vbo);
+    _glState.OnDeleteBuffer(_ibo);
+    glDeleteVertexArrays(1, &_vao);
+    glDeleteBuffers(1, &_vbo);
+    glDeleteBuffers(1, &_ibo);
+}
+
+std::string MeshPool::MakeLayoutKey(const Mesh& mesh) {
+    std::string key = std::to_string((int)mesh.GetIndexFormat());
+    for (const auto& desc : mesh.GetVertexAttributes()) {
+        key += ":" + std::to_string((int)desc.attribute)
+            + "," + std::to_string(desc.numComponents)
+            + "," + std::to_string((int)desc.format);
+    }
+    return key;
+}
+
+// expects pool vao and vbo to be bound
+void MeshPool::BindVertexLayout() {
+    for (const auto& binding : _bindings) {
+        glEnableVertexAttribArray(binding.location);
+        glVertexAttribPointer(binding.location, binding.components, binding.type,
+            GL_FALSE, _vertexSize, (void*)binding.offset);
+    }
+}
+
+bool MeshPool::AllocateRange(std::vector<Range>& freeRanges, size_t& end, size_t capacity, size_t count, size_t& start) {
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        if (it->count < count)
+            continue;
+        start = it->start;
+        it->start += count;
+        it->count -= count;
+        if (it->count == 0)
+            freeRanges.erase(it);
+        return true;
+    }
+    if (end + count > capacity)
+        return false;
+    start = end;
+    end += count;
+    return true;
+}
+
+void MeshPool::FreeRange(std::vector<Range>& freeRanges, size_t& end, Range range) {
+    if (range.count == 0)
+        return;
+    freeRanges.push_back(range);
+    std::sort(freeRanges.begin(), freeRanges.end(), [](const Range& a, const Range& b) {
+        return a.start < b.start;
+    });
+    // merge neighbouring ranges
+    std::vector<Range> merged;
+    for (const Range& r : freeRanges) {
+        if (!merged.empty() && merged.back().start + merged.back().count == r.start)
+            merged.back().count += r.count;
+        else
+            merged.push_back(r);
+    }
+    // give back trailing range to the end of the buffer
+    if (!merged.empty() && merged.back().start + merged.back().count == end) {
+        end = merged.back().start;
+        merged.pop_back();
+    }
+    freeRanges.swap(merged);
+}
+
+void MeshPool::Grow(GLenum target, GLuint& buffer, size_t& capacity, size_t required, size_t elementSize) {
+    size_t newCapacity = capacity;
+    while (newCapacity < required)
+        newCapacity *= 2;
+    MT_CORE_DEBUG("MeshPool::Grow: growing buffer from {} to {} elements", capacity, newCapacity);
+
+    GLuint newBuffer = 0;
+    glGenBuffers(1, &newBuffer);
+    _glState.BindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * elementSize, nullptr, GL_STATIC_DRAW);
+    _glState.BindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, capacity * elementSize);
+
+    _glState.OnDeleteBuffer(buffer);
+    glDeleteBuffers(1, &buffer);
+    buffer = newBuffer;
+    capacity = newCapacity;
+
+    // attribute pointers and element binding capture the buffer so must be respecified
+    _glState.BindVertexArray(_vao);
+    _glState.BindBuffer(target, buffer);
+    if (target == GL_ARRAY_BUFFER)
+        BindVertexLayout();
+}
+
+bool MeshPool::Allocate(const Mesh& mesh, Allocation& allocation) {
+    size_t vertexCount = mesh.GetVertexCount();
+    size_t indexCount = mesh.GetIndexCount();
+    if (mesh.GetVertexSize() != _vertexSize || mesh.GetIndexSize() != _indexSize) {
+        MT_CORE_WARN("MeshPool::Allocate: mesh layout does not match pool");
+        return false;
+    }
+
+    size_t vertexStart = 0;
+    if (!AllocateRange(_freeVertices, _vertexEnd, _vertexCapacity, vertexCount, vertexStart)) {
+        Grow(GL_ARRAY_BUFFER, _vbo, _vertexCapacity, _vertexEnd + vertexCount, _vertexSize);
+        AllocateRange(_freeVertices, _vertexEnd, _vertexCapacity, vertexCount, vertexStart);
+    }
+    size_t indexStart = 0;
+    if (!AllocateRange(_freeIndices, _indexEnd, _indexCapacity, indexCount, indexStart)) {
+        Grow(GL_ELEMENT_ARRAY_BUFFER, _ibo, _indexCapacity, _indexEnd + indexCount, _indexSize);
+        AllocateRange(_freeIndices, _indexEnd, _indexCapacity, indexCount, indexStart);
+    }
+
+    // upload, element buffer binding is vao state so bind the pool vao first
+    _glState.BindVertexArray(_vao);
+    _glState.BindBuffer(GL_ARRAY_BUFFER, _vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, vertexStart * _vertexSize, vertexCount * _vertexSize, mesh.GetVertexPtr());
+    _glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexStart * _indexSize, indexCount * _indexSize, mesh.GetIndexPtr());
+
+    allocation = {
+        .baseVertex = (GLint)vertexStart,
+        .firstIndex = (GLuint)indexStart,
+        .vertexCount = vertexCount,
+        .indexCount = indexCount
+    };
+    return true;
+}
+
+void MeshPool::Free(const Allocation& allocation) {
+    FreeRange(_freeVertices, _vertexEnd, {(size_t)allocation.baseVertex, allocation.vertexCount});
+    FreeRange(_freeIndices, _indexEnd, {allocation.firstIndex, allocation.indexCount});
+}
+
+GLuint MeshPool::GetVertexArray() const {
+    return _vao;
+}
+
+GLuint MeshPool::GetVertexBuffer() const {
+    return _vbo;
+}
+
+GLuint MeshPool::GetIndexBuffer() const {
+    return _ibo;
+}
+
+size_t MeshPool::GetIndexSize() const {
+    return _indexSize;
+}
+
+} // opengl
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,179 @@
+#include "renderer/opengl/program_cache.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#include "core/hash.hpp"
+#include "core/logger.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace opengl {
+
+std::filesystem::path ProgramCache::GetDefaultDirectory() {
+    auto env = [](const char* name) {
+        const char* value = std::getenv(name);
+        return value != nullptr && value[0] != '\0' ? std::filesystem::path(value) : std::filesystem::path();
+    };
+    std::filesystem::path override = env("MARATHON_SHADER_CACHE");
+    if (!override.empty())
+        return override;
+
+    std::filesystem::path base = "";
+#if defined(_WIN32)
+    base = env("LOCALAPPDATA");
+#elif defined(__APPLE__)
+    if (!env("HOME").empty())
+        base = env("HOME") / "Library" / "Caches";
+#else
+    base = env("XDG_CACHE_HOME");
+    if (base.empty() && !env("HOME").empty())
+        base = env("HOME") / ".cache";
+#endif
+    if (base.empty()) {
+        std::error_code err;
+        base = std::filesystem::temp_directory_path(err);
+    }
+    return base / "marathon" / "shaders";
+}
+
+bool ProgramCache::Init(const std::filesystem::path& directory) {
+    _isEnabled = false;
+    if (!(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)) {
+        MT_CORE_INFO("ProgramCache::Init: program binaries unsupported, cache disabled");
+        return false;
+    }
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount == 0) {
+        MT_CORE_INFO("ProgramCache::Init: driver has no program binary formats, cache disabled");
+        return false;
+    }
+
+    std::error_code err;
+    std::filesystem::create_directories(directory, err);
+    if (err) {
+        MT_CORE_WARN("ProgramCache::Init: failed to create cache directory {}: {}", directory.string(), err.message());
+        return false;
+    }
+    _directory = directory;
+
+    // glGetString returns nullptr on error
+    auto str = [](GLenum name) {
+        const GLubyte* s = glGetString(name);
+        return s != nullptr ? std::string((const char*)s) : std::string();
+    };
+    _driverHash = HashString(str(GL_VENDOR));
+    _driverHash = HashString(str(GL_RENDERER), _driverHash);
+    _driverHash = HashString(str(GL_VERSION), _driverHash);
+    _isEnabled = true;
+    MT_CORE_INFO("ProgramCache::Init: caching program binaries in {}", _directory.string());
+    return true;
+}
+
+bool ProgramCache::IsEnabled() const {
+    return _isEnabled;
+}
+
+std::filesystem::path ProgramCache::GetEntryPath(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return _directory / name;
+}
+
+uint64_t ProgramCache::MakeKey(const std::string& vertexSource, const std::string& fragmentSource) const {
+    uint64_t key = HashBytes(&_driverHash, sizeof(_driverHash));
+    key = HashString(vertexSource, key);
+    // separator so moving text between stages changes the key
+    const char separator = '\0';
+    key = HashBytes(&separator, 1, key);
+    return HashString(fragmentSource, key);
+}
+
+GLuint ProgramCache::Load(uint64_t key) {
+    if (!_isEnabled)
+        return 0;
+    std::filesystem::path path = GetEntryPath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return 0;
+
+    FileHeader header;
+    file.read((char*)&header, sizeof(header));
+    std::vector<char> binary;
+    bool isValid = file.good() && header.magic == s_magic && header.version == s_version && header.key == key;
+    if (isValid) {
+        binary.resize(header.length);
+        file.read(binary.data(), binary.size());
+        isValid = file.good();
+    }
+    file.close();
+
+    GLuint program = 0;
+    if (isValid) {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, binary.data(), binary.size());
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            // a rejected binary raises an error, clear it so later checks don't report it
+            while (glGetError() != GL_NO_ERROR) {}
+            glDeleteProgram(program);
+            program = 0;
+            isValid = false;
+        }
+    }
+    if (!isValid) {
+        MT_CORE_DEBUG("ProgramCache::Load: discarding rejected entry {}", path.string());
+        std::error_code err;
+        std::filesystem::remove(path, err);
+    }
+    return program;
+}
+
+void ProgramCache::Store(uint64_t key, GLuint program) {
+    if (!_isEnabled)
+        return;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    FileHeader header = {
+        .key = key,
+        .format = format,
+        .length = (uint32_t)length
+    };
+    // write then rename so a crash never leaves a truncated entry
+    std::filesystem::path path = GetEntryPath(key);
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            MT_CORE_WARN("ProgramCache::Store: failed to open {}", tmpPath.string());
+            return;
+        }
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), binary.size());
+    }
+    std::error_code err;
+    std::filesystem::rename(tmpPath, path, err);
+    if (err) {
+        MT_CORE_WARN("ProgramCache::Store: failed to write {}: {}", path.string(), err.message());
+        std::filesystem::remove(tmpPath, err);
+    }
+}
+
+} // opengl
+
+} // renderer
+
+} // marathon
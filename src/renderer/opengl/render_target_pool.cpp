@@ -0,0 +1,179 @@
+#include "renderer/opengl/render_target_pool.hpp"
+
+#include <algorithm>
+
+#include "core/logger.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace opengl {
+
+/// NOTE: 1 & 2 bit stencil formats have no opengl equivalent so are unsupported
+const std::unordered_map<TexPixelFormat, RenderTargetPool::PixelFormatInfo> RenderTargetPool::s_pixelFormatMap = {
+    { TexPixelFormat::R_8u,                 { GL_R8,                    GL_RED,             GL_UNSIGNED_BYTE,   0 } },
+    { TexPixelFormat::RG_8u,                { GL_RG8,                   GL_RG,              GL_UNSIGNED_BYTE,   0 } },
+    { TexPixelFormat::RGB_8u,               { GL_RGB8,                  GL_RGB,             GL_UNSIGNED_BYTE,   0 } },
+    { TexPixelFormat::RGB_16f,              { GL_RGB16F,                GL_RGB,             GL_HALF_FLOAT,      0 } },
+    { TexPixelFormat::RGB_32f,              { GL_RGB32F,                GL_RGB,             GL_FLOAT,           0 } },
+    { TexPixelFormat::RGBA_8u,              { GL_RGBA8,                 GL_RGBA,            GL_UNSIGNED_BYTE,   0 } },
+    { TexPixelFormat::RGBA_16f,             { GL_RGBA16F,               GL_RGBA,            GL_HALF_FLOAT,      0 } },
+    { TexPixelFormat::RGBA_32f,             { GL_RGBA32F,               GL_RGBA,            GL_FLOAT,           0 } },
+    { TexPixelFormat::DEPTH_24f_STENCIL_8u, { GL_DEPTH24_STENCIL8,      0, 0, GL_DEPTH_STENCIL_ATTACHMENT } },
+    { TexPixelFormat::DEPTH_16f,            { GL_DEPTH_COMPONENT16,     0, 0, GL_DEPTH_ATTACHMENT } },
+    { TexPixelFormat::DEPTH_24f,            { GL_DEPTH_COMPONENT24,     0, 0, GL_DEPTH_ATTACHMENT } },
+    { TexPixelFormat::DEPTH_32f,            { GL_DEPTH_COMPONENT32F,    0, 0, GL_DEPTH_ATTACHMENT } },
+    { TexPixelFormat::STENCIL_8u,           { GL_STENCIL_INDEX8,        0, 0, GL_STENCIL_ATTACHMENT } }
+};
+
+RenderTargetPool::RenderTargetPool(StateCache& glState)
+    : _glState(glState) {}
+
+RenderTargetPool::~RenderTargetPool() {
+    _targets.ForEach([this](Handle, RenderTarget& target) {
+        Destroy(target);
+    });
+}
+
+bool RenderTargetPool::IsSupported(const RenderTargetDesc& desc) {
+    if (desc.width <= 0 || desc.height <= 0)
+        return false;
+    for (TexPixelFormat format : desc.colorFormats) {
+        auto it = s_pixelFormatMap.find(format);
+        if (it == s_pixelFormatMap.end() || it->second.attachment != 0)
+            return false;
+    }
+    if (desc.depthFormat != TexPixelFormat::NONE) {
+        auto it = s_pixelFormatMap.find(desc.depthFormat);
+        if (it == s_pixelFormatMap.end() || it->second.attachment == 0)
+            return false;
+    }
+    return true;
+}
+
+bool RenderTargetPool::Create(RenderTarget& target) {
+    const RenderTargetDesc& desc = target.desc;
+    GLuint previous = _glState.GetFramebuffer();
+    glGenFramebuffers(1, &target.framebuffer);
+    _glState.BindFramebuffer(target.framebuffer);
+
+    std::vector<GLenum> drawBuffers;
+    for (size_t i = 0; i < desc.colorFormats.size(); i++) {
+        const PixelFormatInfo& info = s_pixelFormatMap.at(desc.colorFormats[i]);
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        _glState.BindTexture(0, GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, info.internalFormat, desc.width, desc.height, 0, info.format, info.type, nullptr);
+        // filter is set per sample by the renderer, edges clamp so post processing doesn't wrap
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, texture, 0);
+        target.colorTextures.push_back(texture);
+        drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+    }
+    if (drawBuffers.empty()) {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    } else {
+        glDrawBuffers(drawBuffers.size(), drawBuffers.data());
+    }
+
+    // depth is never sampled so a renderbuffer is enough
+    if (desc.depthFormat != TexPixelFormat::NONE) {
+        const PixelFormatInfo& info = s_pixelFormatMap.at(desc.depthFormat);
+        glGenRenderbuffers(1, &target.depthRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, target.depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, info.internalFormat, desc.width, desc.height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, info.attachment, GL_RENDERBUFFER, target.depthRenderbuffer);
+    }
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    _glState.BindFramebuffer(previous);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        MT_CORE_WARN("RenderTargetPool::Create: framebuffer incomplete, status {:#x}", status);
+        Destroy(target);
+        return false;
+    }
+    _createdCount++;
+    return true;
+}
+
+void RenderTargetPool::Destroy(RenderTarget& target) {
+    for (GLuint texture : target.colorTextures) {
+        _glState.OnDeleteTexture(texture);
+        glDeleteTextures(1, &texture);
+    }
+    target.colorTextures.clear();
+    if (target.depthRenderbuffer != 0)
+        glDeleteRenderbuffers(1, &target.depthRenderbuffer);
+    target.depthRenderbuffer = 0;
+    if (target.framebuffer != 0) {
+        _glState.OnDeleteFramebuffer(target.framebuffer);
+        glDeleteFramebuffers(1, &target.framebuffer);
+    }
+    target.framebuffer = 0;
+}
+
+Handle RenderTargetPool::Acquire(const RenderTargetDesc& desc) {
+    if (!IsSupported(desc)) {
+        MT_CORE_WARN("RenderTargetPool::Acquire: unsupported size or pixel format");
+        return Handle();
+    }
+    Handle found = Handle();
+    _targets.ForEach([&found, &desc](Handle handle, RenderTarget& target) {
+        if (!found.IsValid() && !target.isInUse && target.desc == desc)
+            found = handle;
+    });
+    if (found.IsValid()) {
+        _targets.Get(found)->isInUse = true;
+        return found;
+    }
+
+    RenderTarget target = RenderTarget();
+    target.desc = desc;
+    if (!Create(target))
+        return Handle();
+    target.isInUse = true;
+    return _targets.Insert(std::move(target));
+}
+
+void RenderTargetPool::Release(Handle handle, int frameIndex) {
+    RenderTarget* target = _targets.Get(handle);
+    if (target == nullptr)
+        return;
+    target->isInUse = false;
+    target->releasedFrame = frameIndex;
+}
+
+const RenderTarget* RenderTargetPool::Get(Handle handle) const {
+    return _targets.Get(handle);
+}
+
+void RenderTargetPool::Trim(int frameIndex) {
+    std::vector<Handle> idle;
+    _targets.ForEach([&idle, frameIndex](Handle handle, RenderTarget& target) {
+        if (!target.isInUse && frameIndex - target.releasedFrame > s_maxIdleFrames)
+            idle.push_back(handle);
+    });
+    for (Handle handle : idle) {
+        Destroy(*_targets.Get(handle));
+        _targets.Remove(handle);
+    }
+}
+
+size_t RenderTargetPool::Size() const {
+    return _targets.Size();
+}
+
+size_t RenderTargetPool::GetCreatedCount() const {
+    return _createdCount;
+}
+
+} // opengl
+
+} // renderer
+
+} // marathon
@@ -1,7 +1,13 @@
 #include "renderer/opengl/renderer.hpp"
 
+#include <array>
+#include <cstdlib>
+#include <cstring>
+
+#include "core/hash.hpp"
 #include "core/logger.hpp"
 #include "time/time.hpp"
+#include "window/window.hpp"
 
 namespace marathon {
 
@@ -11,19 +17,27 @@ namespace opengl {
 
 /// Build-in shaders
 const std::vector<std::string> Renderer::s_reservedUniforms = {
+    "u_view",
+    "u_projection",
+    "u_resolution",
     "u_time",
     "u_time_delta",
-    "u_frame_index",
-    "u_resolution"
+    "u_frame_index"
 };
+const std::string Renderer::s_materialBlockName = "MaterialProperties";
+/// NOTE: block layout must match FrameGlobals
 const std::string Renderer::s_globalHeader = R"(
 #version 330 core
 
-// global uniforms
-uniform float   u_time;
-uniform float   u_time_delta;
-uniform int     u_frame_index;
-uniform vec2    u_resolution;
+// global uniforms, shared by all programs and set once per frame
+layout(std140) uniform FrameGlobals {
+    mat4    u_view;
+    mat4    u_projection;
+    vec2    u_resolution;
+    float   u_time;
+    float   u_time_delta;
+    int     u_frame_index;
+};
 )";
 
 const std::string Renderer::s_vertexHeader = R"(
@@ -33,15 +47,15 @@ const std::string Renderer::s_vertexHeader = R"(
 // out vec4 gl_Position;        // The clip-space output position of the current vertex.
 // out int gl_PointSize;        // The pixel width/height of the point being rasterized (only for point primatives).
 
-// vertex attributes
-layout(location =  0) in vec3 vertex_position;
-layout(location =  1) in vec3 vertex_normal;
-layout(location =  2) in vec4 vertex_tangent;
-layout(location =  3) in vec4 vertex_color;
-layout(location =  4) in vec2 vertex_uv0;
-layout(location =  5) in vec2 vertex_uv1;
-layout(location =  6) in vec2 vertex_uv2;
-layout(location =  7) in vec2 vertex_uv3;
+// vertex attributes are declared per variant, see s_vertexAttributeDecls
+
+// instance attributes, only streamed for instanced draws and multi-draw batches
+// otherwise instance_model is identity and instance_data is zero
+layout(location =  8) in mat4 instance_model;
+layout(location = 12) in vec4 instance_data0;
+layout(location = 13) in vec4 instance_data1;
+layout(location = 14) in vec4 instance_data2;
+layout(location = 15) in vec4 instance_data3;
 
 // "varying" variables
 out vec4 varying_position;
@@ -55,8 +69,6 @@ out vec4 varying_uv3;
 
 // vertex uniforms
 uniform mat4    u_model;
-uniform mat4    u_view;
-uniform mat4    u_projection;
 )";
 
 const std::string Renderer::s_fragmentHeader = R"(
@@ -77,6 +89,40 @@ in vec4 varying_uv2;
 in vec4 varying_uv3;
 )";
 
+/// NOTE: fallbacks match the generic attribute value of a disabled array, so variants draw the same as the full shader
+const std::vector<Renderer::VertexAttributeDecl> Renderer::s_vertexAttributeDecls = {
+    { VertexAttribute::POSITION,  0, "vec3", "vertex_position", "vec3(0.0f)",                 "VERTEX_HAS_POSITION" },
+    { VertexAttribute::NORMAL,    1, "vec3", "vertex_normal",   "vec3(0.0f)",                 "VERTEX_HAS_NORMAL" },
+    { VertexAttribute::TANGENT,   2, "vec4", "vertex_tangent",  "vec4(0.0f, 0.0f, 0.0f, 1.0f)", "VERTEX_HAS_TANGENT" },
+    { VertexAttribute::COLOUR,    3, "vec4", "vertex_color",    "vec4(0.0f, 0.0f, 0.0f, 1.0f)", "VERTEX_HAS_COLOR" },
+    { VertexAttribute::TEXCOORD0, 4, "vec2", "vertex_uv0",      "vec2(0.0f)",                 "VERTEX_HAS_UV0" },
+    { VertexAttribute::TEXCOORD1, 5, "vec2", "vertex_uv1",      "vec2(0.0f)",                 "VERTEX_HAS_UV1" },
+    { VertexAttribute::TEXCOORD2, 6, "vec2", "vertex_uv2",      "vec2(0.0f)",                 "VERTEX_HAS_UV2" },
+    { VertexAttribute::TEXCOORD3, 7, "vec2", "vertex_uv3",      "vec2(0.0f)",                 "VERTEX_HAS_UV3" }
+};
+const uint32_t Renderer::s_allAttributesMask = [] {
+    uint32_t mask = 0;
+    for (const auto& decl : s_vertexAttributeDecls)
+        mask |= 1u << (int)decl.attribute;
+    return mask;
+}();
+
+const std::string Renderer::s_placeholderVertexSource = R"(
+void main()
+{
+    varying_position = vec4(vertex_position, 1.0f);
+    gl_Position = u_projection * u_view * u_model * instance_model * vec4(vertex_position, 1.0f);
+}
+)";
+const std::string Renderer::s_placeholderFragmentSource = R"(
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+    out_color = vec4(0.5f, 0.5f, 0.5f, 1.0f);
+}
+)";
+
 /// --- Mesh Handling ---
 /// TODO:
 // support for a simple wireframe mode to convert to LINE versions of primitive types
@@ -130,22 +176,82 @@ const std::unordered_map<DepthFunc, GLenum> Renderer::s_depthFuncMap = {
 };
 
 Renderer::Renderer() 
-    : renderer::Renderer("marathon.renderer.opengl.Renderer") {}
+    : renderer::Renderer("marathon.renderer.opengl.Renderer") {
+    // NOTE: reserved uniforms must be interned first so they occupy the lowest ids
+    for (const auto& key : s_reservedUniforms) {
+        GetUniformId(key);
+    }
+    _modelUniformId = GetUniformId("u_model");
+}
 Renderer::~Renderer() {
     // delete opengl resources
-    /// CONSIDER: moving internal to the structs themselves
-    for (auto& meshHandler : _meshHandlers) {
-        glDeleteVertexArrays(1, &meshHandler.vao);
-        glDeleteBuffers(1, &meshHandler.vbo);
-        glDeleteBuffers(1, &meshHandler.ibo);
-    }
-    for (auto& shaderHandler : _shaderHandlers) {
-        glDeleteProgram(shaderHandler.program);
+    _meshHandlers.ForEach([this](Handle, MeshHandler& meshHandler) {
+        DestroyMeshHandler(meshHandler);
+    });
+    _shaderHandlers.ForEach([this](Handle, ShaderHandler& shaderHandler) {
+        DestroyShaderHandler(shaderHandler);
+    });
+    for (auto& [key, materialBuffer] : _materialBuffers) {
+        glDeleteBuffers(1, &materialBuffer.buffer);
     }
+    _occlusionQueries.ForEach([](Handle, OcclusionQueryHandler& query) {
+        glDeleteQueries(1, &query.query);
+    });
+    _meshPools.clear();
+    _canvasTargets.clear();
+    _instanceStream.reset();
+    _uploadStream.reset();
+    _uniformStream.reset();
+    _indirectStream.reset();
 }
 
 // module interface
 bool Renderer::Boot() {
+    // current generic attribute values are used when the attribute array is disabled
+    // so non-instanced draws see an identity instance transform
+    for (int col = 0; col < 4; col++) {
+        glVertexAttrib4f(s_instanceModelLocation + col, col == 0, col == 1, col == 2, col == 3);
+    }
+    for (int slot = 0; slot < InstanceStream::MAX_SLOTS; slot++) {
+        glVertexAttrib4f(s_instanceDataLocation + slot, 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    _instanceStream = std::make_unique<StreamBuffer>(_glState, GL_ARRAY_BUFFER, s_instanceStreamSize);
+    _uploadStream = std::make_unique<StreamBuffer>(_glState, GL_COPY_READ_BUFFER, s_uploadStreamSize);
+    _uniformStream = std::make_unique<StreamBuffer>(_glState, GL_UNIFORM_BUFFER, s_uniformStreamSize);
+    _programCache.Init(ProgramCache::GetDefaultDirectory());
+    // let the driver pick the thread count, each extension has its own entry point
+    _hasParallelCompile = GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    } else if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+    // placeholder must be usable immediately so is compiled synchronously
+    _placeholderShader = std::make_shared<Shader>();
+    _placeholderShader->SetSources(s_placeholderVertexSource, s_placeholderFragmentSource);
+    _placeholderHandle = FindOrCreateShaderVariant(_placeholderShader, s_allAttributesMask, true);
+    FinishShaderCompile(*_shaderHandlers.Get(_placeholderHandle));
+    // conservative queries may count samples the object only partially covers, fine for visibility
+    _occlusionQueryTarget = GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+    _occlusionProxyMesh = std::make_shared<BoxMesh>();
+    std::string proxyErr = "";
+    if (!ValidateMesh(_occlusionProxyMesh, proxyErr)) {
+        MT_CORE_WARN("Renderer::Boot: failed to upload occlusion proxy, queried draws are never skipped\n{}", proxyErr);
+        _occlusionProxyMesh = nullptr;
+    }
+    // multi-draw needs base instance to index per draw data
+    bool hasMultiDraw = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+    bool hasBaseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+    if (hasMultiDraw && hasBaseInstance) {
+        _indirectStream = std::make_unique<StreamBuffer>(_glState, GL_DRAW_INDIRECT_BUFFER, s_indirectStreamSize);
+    } else {
+        MT_CORE_INFO("Renderer::Boot: multi-draw indirect unsupported, pooled draws are submitted individually");
+    }
+    UpdateWindowSize();
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    _uniformAlignment = std::max(alignment, 16);
+
     _active = true;
     return true;
 }
@@ -260,33 +366,37 @@ bool CheckProgramError(GLuint program) {
 }
 
 
-/// TODO: currently does not consider if user shader is dirty
+/// NOTE: never blocks, a shader still compiling is not valid yet
+/// validates the program bound by SetShader, other variants are validated when drawn with
 bool Renderer::ValidateShader(std::shared_ptr<Shader> shader, std::string& err) {
     if (shader == nullptr) {
         err = "Shader is null\n";
         return false;
     }
-    int shaderHandlerIdx = FindOrCreateShaderHandler(shader);
-    ShaderHandler& shaderHandler = _shaderHandlers[shaderHandlerIdx];
-    if (shaderHandler.isValid) {
+    ShaderHandler* shaderHandler = _shaderHandlers.Get(FindOrCreateShaderVariant(shader, s_allAttributesMask, true));
+    if (shaderHandler->status == ShaderStatus::COMPILING && IsShaderCompileDone(*shaderHandler)) {
+        FinishShaderCompile(*shaderHandler);
+    }
+    if (shaderHandler->isValid) {
         return true;
     }
-    err = shaderHandler.warnings;
+    err = shaderHandler->status == ShaderStatus::COMPILING ? "Shader is compiling\n" : shaderHandler->warnings;
     return false;
 }
 
-/// TODO: currently does not consider if user shader is dirty
+/// NOTE: pending mesh edits are uploaded here, draws of the mesh already queued are flushed first
+/// so each draw sees the data it was issued with
 bool Renderer::ValidateMesh(std::shared_ptr<Mesh> mesh, std::string& err) {
     if (mesh == nullptr) {
         err = "Mesh is null\n";
         return false;
     }
-    int meshHandlerIdx = FindOrCreateMeshHandler(mesh);
-    MeshHandler& meshHandler = _meshHandlers[meshHandlerIdx];
-    if (meshHandler.isValid) {
+    MeshHandler* meshHandler = _meshHandlers.Get(FindOrCreateMeshHandler(mesh));
+    UpdateMeshHandler(*meshHandler);
+    if (meshHandler->isValid) {
         return true;
     }
-    err = meshHandler.warnings;
+    err = meshHandler->warnings;
     return false;
 }
 
@@ -294,6 +404,8 @@ bool Renderer::ValidateMesh(std::shared_ptr<Mesh> mesh, std::string& err) {
 /// --- Drawing ---
 // clear active canvas/screen of all color, depth, and stencil buffers
 void Renderer::Clear() {
+    // submit queued draws so they are not lost
+    Flush();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 }
 // clear active canvas/screen according to bools args
@@ -302,67 +414,553 @@ void Renderer::Clear(bool clearColor, bool clearStencil, bool clearDepth) {
     if (clearColor) mask |= GL_COLOR_BUFFER_BIT;
     if (clearStencil) mask |= GL_STENCIL_BUFFER_BIT;
     if (clearDepth) mask |= GL_DEPTH_BUFFER_BIT;
+    Flush();
     glClear(mask);
 }
 
-/// NOTE: do not change shader bindings inside of draw calls
-/// user should use SetShader before Draw
-/// TODO: draw commands should be queued later
-void Renderer::Draw(std::shared_ptr<Mesh> mesh) {
-    CheckError();
-    _stats.drawCalls++;
+// validate mesh & material and fill in the common command fields, returns false if can't be drawn
+bool Renderer::PrepareDrawCommand(std::shared_ptr<Mesh> mesh, const LA::mat4& model, DrawCommand& cmd, std::shared_ptr<Material> material) {
     if (mesh == nullptr) {
         MT_CORE_WARN("Renderer::Draw: mesh is null");
-        return;
+        return false;
     }
     
     std::string err = "";
     if (!ValidateMesh(mesh, err)) {
         MT_CORE_WARN("Renderer::Draw: can't draw invalid mesh");
-        return;
+        return false;
     }
 
-    if (mesh->GetMaterial() == nullptr) {
+    if (material == nullptr)
+        material = mesh->GetMaterial();
+    if (material == nullptr) {
         MT_CORE_WARN("Renderer::Draw: mesh has no material");
+        return false;
+    }
+
+    std::shared_ptr<Shader> shader = material->GetShader();
+    if (shader == nullptr) {
+        MT_CORE_WARN("Renderer::Draw: can't draw with invalid shader");
+        return false;
+    }
+
+    // handles are stored on the resources by validation
+    cmd.mesh = mesh->GetRendererHandle();
+    MeshHandler* meshHandler = _meshHandlers.Get(cmd.mesh);
+    meshHandler->queuedFlush = _flushIndex;
+    // variant matching the attributes the mesh actually has
+    cmd.shader = FindOrCreateShaderVariant(shader, MakeVariantKey(*material, meshHandler->attributeMask));
+    ShaderHandler* shaderHandler = _shaderHandlers.Get(cmd.shader);
+    if (shaderHandler->status == ShaderStatus::COMPILING && IsShaderCompileDone(*shaderHandler))
+        FinishShaderCompile(*shaderHandler);
+    if (!shaderHandler->isValid) {
+        if (shaderHandler->status != ShaderStatus::COMPILING) {
+            MT_CORE_WARN("Renderer::Draw: can't draw with invalid shader");
+            return false;
+        }
+        // skipped silently while compiling, it will appear once linked
+        if (!_state.compilePlaceholder || !_placeholderHandle.IsValid())
+            return false;
+        cmd.shader = _placeholderHandle;
+    }
+
+    cmd.material = _drawQueue.AddMaterial(material);
+    cmd.model = model;
+    float depth = DrawQueue::ComputeViewDepth(GetView(), cmd.model);
+    // pooled meshes share a vao so are keyed by pool to be drawn together
+    uint32_t geometry = meshHandler->pool != -1 ? meshHandler->pool : s_unpooledGeometryKey | cmd.mesh.index;
+    cmd.sortKey = DrawQueue::MakeSortKey(cmd.shader.index, cmd.material, geometry, depth);
+    return true;
+}
+
+/// NOTE: draws are queued and only submitted on Flush, sorted by program, material, geometry then depth
+/// uniforms set directly with SetUniform persist on the program, so the last value set before Flush is used
+void Renderer::Draw(std::shared_ptr<Mesh> mesh, uint64_t occlusionId) {
+    // bounds of edited meshes are only recalculated here on the render thread
+    if (mesh != nullptr)
+        mesh->UpdateBounds();
+    if (mesh != nullptr && IsCulled(*mesh, GetModel())) {
+        _stats.drawsCulled++;
         return;
     }
-    // set shader to material shader
-    SetShader(mesh->GetMaterial()->GetShader());
+    DrawCommand cmd = DrawCommand();
+    if (!PrepareDrawCommand(mesh, GetModel(), cmd))
+        return;
+    if (_state.occlusionQueries && mesh->GetOcclusionQuery())
+        cmd.occlusion = FindOrCreateOcclusionQuery(*mesh, cmd.model, occlusionId);
+    _drawQueue.Push(cmd);
+}
 
-    if (_shaderHandler == nullptr) {
-        MT_CORE_WARN("Renderer::Draw: no shader bound");
+/// NOTE: instanced draws are not culled, instances may be spread across the whole scene
+bool Renderer::IsCulled(const Mesh& mesh, const LA::mat4& model) {
+    if (!_state.frustumCulling)
+        return false;
+    if (_isFrustumDirty) {
+        _frustum = Frustum(GetProjection() * GetView());
+        _isFrustumDirty = false;
+    }
+    return !_frustum.IsVisible(mesh.GetBounds(), model);
+}
+
+/// NOTE: occlusion is tested at flush so draws queued before their occluders are still tested against them
+/// instanced draws are never occluded
+void Renderer::CullOccluded() {
+    if (!_state.occlusionCulling || !_occlusionCuller.HasOccluders())
         return;
+    if (_isOcclusionDirty) {
+        _occlusionCuller.Rasterise(GetProjection() * GetView());
+        _isOcclusionDirty = false;
     }
+    _stats.drawsOccluded += (int)_drawQueue.RemoveIf([this](const DrawCommand& cmd) {
+        const MeshHandler* meshHandler = _meshHandlers.Get(cmd.mesh);
+        if (cmd.instanceCount > 0 || meshHandler == nullptr)
+            return false;
+        return !_occlusionCuller.IsVisible(meshHandler->mesh->GetBounds(), cmd.model);
+    });
+}
 
-    if (!ValidateShader(_shaderHandler->shader, err)) {
-        MT_CORE_WARN("Renderer::Draw: can't draw with invalid shader");
+void Renderer::DrawOccluder(std::shared_ptr<Mesh> mesh) {
+    if (mesh == nullptr) {
+        MT_CORE_WARN("Renderer::DrawOccluder: mesh is null");
         return;
     }
+    if (_occlusionCuller.AddOccluder(*mesh, GetModel()))
+        _isOcclusionDirty = true;
+}
 
-    if (!SetDefaultUniforms()) {
-        MT_CORE_WARN("Renderer::Draw: failed to set default uniforms");
+void Renderer::DrawInstanced(std::shared_ptr<Mesh> mesh, std::span<const LA::mat4> transforms, std::span<const InstanceStream> streams) {
+    if (transforms.empty())
+        return;
+    DrawCommand cmd = DrawCommand();
+    if (!PrepareDrawCommand(mesh, GetModel(), cmd))
+        return;
+
+    // validate streams before copying anything
+    const InstanceStream* slots[InstanceStream::MAX_SLOTS] = {};
+    for (const InstanceStream& stream : streams) {
+        if (stream.slot < 0 || stream.slot >= InstanceStream::MAX_SLOTS) {
+            MT_CORE_WARN("Renderer::DrawInstanced: instance stream slot {} out of range", stream.slot);
+            continue;
+        }
+        if (stream.data.size() != transforms.size()) {
+            MT_CORE_WARN("Renderer::DrawInstanced: instance stream slot {} size does not match instance count", stream.slot);
+            continue;
+        }
+        slots[stream.slot] = &stream;
     }
 
-    if (!SetMaterialUniforms(mesh->GetMaterial())) {
-        MT_CORE_WARN("Renderer::Draw: failed to set material uniforms");
+    cmd.instanceCount = transforms.size();
+    cmd.instanceOffset = _drawQueue.PushInstanceData(transforms.data(), transforms.size_bytes());
+    for (int slot = 0; slot < InstanceStream::MAX_SLOTS; slot++) {
+        if (slots[slot] == nullptr)
+            continue;
+        _drawQueue.PushInstanceData(slots[slot]->data.data(), slots[slot]->data.size_bytes());
+        cmd.instanceStreamMask |= 1 << slot;
     }
-    
-    int meshHandlerIdx = FindOrCreateMeshHandler(mesh);
-    MeshHandler& meshHandler = _meshHandlers[meshHandlerIdx];
-    // actual draw command
-
-    glBindVertexArray(meshHandler.vao);
-    GLenum primitive = s_primitiveMap.at(mesh->GetPrimitiveType());
-    if (meshHandler.ibo != 0) {
-        GLenum indexType = s_indexFormatMap.at(mesh->GetIndexFormat());
-        glDrawElements(primitive, meshHandler.mesh->GetIndexCount(), indexType, nullptr);
+    _drawQueue.Push(cmd);
+}
+
+/// NOTE: entries are queued like direct draws so the flush sort merges all lists with each other
+/// and anything drawn directly, draws from lists culled while recording aren't culled again
+void Renderer::Submit(std::span<const CommandList> lists) {
+    for (const CommandList& list : lists) {
+        _stats.drawsCulled += list.GetCulledCount();
+        const std::vector<uint8_t>& instanceData = list.GetInstanceData();
+        for (const CommandList::Entry& entry : list.GetEntries()) {
+            entry.mesh->UpdateBounds();
+            if (entry.instanceCount == 0 && !list.HasFrustum() && IsCulled(*entry.mesh, entry.model)) {
+                _stats.drawsCulled++;
+                continue;
+            }
+            DrawCommand cmd = DrawCommand();
+            if (!PrepareDrawCommand(entry.mesh, entry.model, cmd, entry.material))
+                continue;
+            if (entry.instanceCount > 0) {
+                cmd.instanceCount = entry.instanceCount;
+                cmd.instanceOffset = _drawQueue.PushInstanceData(instanceData.data() + entry.instanceOffset, entry.instanceSize);
+                cmd.instanceStreamMask = entry.instanceStreamMask;
+            } else if (_state.occlusionQueries && entry.mesh->GetOcclusionQuery()) {
+                cmd.occlusion = FindOrCreateOcclusionQuery(*entry.mesh, entry.model, entry.occlusionId);
+            }
+            _drawQueue.Push(cmd);
+        }
+    }
+}
+
+// point instance attributes of the bound vao at the command's instance data
+void Renderer::EnableInstanceAttributes(const DrawCommand& cmd, bool enabled) {
+    if (!enabled) {
+        for (int col = 0; col < 4; col++)
+            glDisableVertexAttribArray(s_instanceModelLocation + col);
+        for (int slot = 0; slot < InstanceStream::MAX_SLOTS; slot++)
+            glDisableVertexAttribArray(s_instanceDataLocation + slot);
+        return;
+    }
+
+    size_t offset = _instanceStreamOffset + cmd.instanceOffset;
+    EnableInstanceModel(_instanceStreamBuffer, offset);
+    offset += cmd.instanceCount * sizeof(LA::mat4);
+    for (int slot = 0; slot < InstanceStream::MAX_SLOTS; slot++) {
+        if (!(cmd.instanceStreamMask & (1 << slot)))
+            continue;
+        GLuint loc = s_instanceDataLocation + slot;
+        glEnableVertexAttribArray(loc);
+        glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, sizeof(LA::vec4), (void*)offset);
+        glVertexAttribDivisor(loc, 1);
+        offset += cmd.instanceCount * sizeof(LA::vec4);
+    }
+}
+
+// point instance_model of the bound vao at transforms in a buffer of the instance stream
+void Renderer::EnableInstanceModel(GLuint buffer, size_t offset) {
+    _glState.BindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (int col = 0; col < 4; col++) {
+        GLuint loc = s_instanceModelLocation + col;
+        glEnableVertexAttribArray(loc);
+        glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, sizeof(LA::mat4), (void*)(offset + col * sizeof(LA::vec4)));
+        glVertexAttribDivisor(loc, 1);
+    }
+}
+
+// number of sorted commands from start that can be merged into one multi-draw, 0 if unsupported
+size_t Renderer::CountMultiDrawRun(size_t start) {
+    if (_indirectStream == nullptr)
+        return 0;
+    const DrawCommand& first = _drawQueue.GetSorted(start);
+    const MeshHandler* firstMesh = _meshHandlers.Get(first.mesh);
+    if (first.instanceCount > 0 || first.occlusion.IsValid() || firstMesh->pool == -1)
+        return 0;
+    // transforms are only carried by instance_model, shaders using u_model alone need a draw each
+    const ShaderHandler* shaderHandler = _shaderHandlers.Get(first.shader);
+    if (shaderHandler == nullptr || !shaderHandler->hasInstanceModel)
+        return 0;
+    PrimitiveType primitive = firstMesh->mesh->GetPrimitiveType();
+
+    size_t end = start + 1;
+    for (; end < _drawQueue.Size(); end++) {
+        const DrawCommand& cmd = _drawQueue.GetSorted(end);
+        const MeshHandler* meshHandler = _meshHandlers.Get(cmd.mesh);
+        if (meshHandler == nullptr || cmd.shader != first.shader || cmd.material != first.material
+            || cmd.instanceCount > 0 || cmd.occlusion.IsValid() || meshHandler->pool != firstMesh->pool
+            || meshHandler->mesh->GetPrimitiveType() != primitive)
+            break;
+    }
+    return end - start;
+}
+
+/// NOTE: glsl 330 has no gl_DrawID, so each indirect command is a single instance whose
+/// baseInstance selects its model matrix from the instance_model stream instead
+/// only used for programs reading instance_model, see CountMultiDrawRun
+/// expects program, material & pool vao of the run to be bound
+void Renderer::SubmitMultiDraw(size_t start, size_t count) {
+    std::vector<LA::mat4> models(count);
+    std::vector<DrawElementsIndirectCommand> commands(count);
+    const MeshHandler* meshHandler = nullptr;
+    for (size_t i = 0; i < count; i++) {
+        const DrawCommand& cmd = _drawQueue.GetSorted(start + i);
+        meshHandler = _meshHandlers.Get(cmd.mesh);
+        models[i] = cmd.model;
+        CountDraw(*meshHandler->mesh, true, 1);
+        commands[i] = {
+            .count = (GLuint)meshHandler->mesh->GetIndexCount(),
+            .instanceCount = 1,
+            .firstIndex = meshHandler->allocation.firstIndex,
+            .baseVertex = meshHandler->allocation.baseVertex,
+            .baseInstance = (GLuint)i
+        };
+    }
+    // transforms must be mat4 aligned so baseInstance indexes them from the attribute offset
+    size_t modelOffset = _instanceStream->Write(models.data(), models.size() * sizeof(LA::mat4), sizeof(LA::mat4));
+    size_t commandOffset = _indirectStream->Write(commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand), sizeof(GLuint));
+    _stats.bytesUploaded += models.size() * sizeof(LA::mat4) + commands.size() * sizeof(DrawElementsIndirectCommand);
+
+    // model is carried by instance_model so the per draw uniform must be identity
+    SetModelUniform(LA::mat4());
+    EnableInstanceModel(_instanceStream->GetBuffer(), modelOffset);
+    _glState.BindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectStream->GetBuffer());
+    const std::shared_ptr<Mesh>& mesh = meshHandler->mesh;
+    glMultiDrawElementsIndirect(s_primitiveMap.at(mesh->GetPrimitiveType()), s_indexFormatMap.at(mesh->GetIndexFormat()),
+        (const void*)commandOffset, count, 0);
+    EnableInstanceAttributes(DrawCommand(), false);
+    _stats.drawCalls++;
+}
+
+void Renderer::CountDraw(const Mesh& mesh, bool isIndexed, int instanceCount) {
+    int count = isIndexed ? mesh.GetIndexCount() : mesh.GetVertexCount();
+    _stats.verticesRendered += count * instanceCount;
+    _stats.trianglesRendered += CountTriangles(mesh.GetPrimitiveType(), count) * instanceCount;
+}
+
+void Renderer::Flush() {
+    if (_drawQueue.Empty())
+        return;
+    _flushIndex++;
+    CheckError();
+
+    if (_isFrameGlobalsDirty)
+        UploadFrameGlobals();
+
+    CullOccluded();
+    if (_drawQueue.Empty()) {
+        _drawQueue.Clear();
+        return;
+    }
+
+    int unsortedChanges = _drawQueue.CountStateChanges(false);
+    _drawQueue.Sort();
+    _stats.stateChangesSaved += unsortedChanges - _drawQueue.CountStateChanges(true);
+
+    // upload all instance data of the flush at once into this frame's stream region
+    const std::vector<uint8_t>& instanceData = _drawQueue.GetInstanceData();
+    if (!instanceData.empty()) {
+        _instanceStreamOffset = _instanceStream->Write(instanceData.data(), instanceData.size(), sizeof(LA::vec4));
+        _instanceStreamBuffer = _instanceStream->GetBuffer();
+        _stats.bytesUploaded += instanceData.size();
+    }
+
+    // draws bind their own programs, uniforms set after the flush must still go to the user's shader
+    Handle userShader = _shaderHandle;
+    Handle boundShader = Handle();
+    GLuint boundVao = 0;
+    uint32_t boundMaterial = UINT32_MAX;
+    for (size_t i = 0; i < _drawQueue.Size(); i++) {
+        const DrawCommand& cmd = _drawQueue.GetSorted(i);
+        ShaderHandler* shaderHandler = _shaderHandlers.Get(cmd.shader);
+        MeshHandler* meshHandler = _meshHandlers.Get(cmd.mesh);
+        if (shaderHandler == nullptr || meshHandler == nullptr) {
+            MT_CORE_WARN("Renderer::Flush: skipping draw with stale handle");
+            continue;
+        }
+        // shader was recompiled after the draw was queued
+        if (!shaderHandler->isValid)
+            continue;
+
+        // queried objects are skipped while known hidden, or drawn conditionally while a result is in flight
+        GLuint conditionalQuery = 0;
+        OcclusionQueryHandler* query = _occlusionQueries.Get(cmd.occlusion);
+        if (query != nullptr) {
+            PollOcclusionQuery(*query);
+            bool isDue = !query->isVisible || query->issuedFrame == -1
+                || _stats.frameIndex - query->issuedFrame >= s_occlusionRetestInterval;
+            if (!query->isResultPending && isDue)
+                _occlusionTests.push_back({ cmd.occlusion, meshHandler->mesh->GetBounds(), cmd.model });
+            if (!query->isResultPending && !query->isVisible) {
+                _stats.drawsOccluded++;
+                continue;
+            }
+            if (query->isResultPending)
+                conditionalQuery = query->query;
+        }
+
+        if (cmd.shader != boundShader) {
+            _shaderHandle = cmd.shader;
+            _glState.UseProgram(shaderHandler->program);
+            boundShader = cmd.shader;
+            // uniforms are per program so material must be rebound
+            boundMaterial = UINT32_MAX;
+        }
+
+        // placeholder program has no material properties
+        if (cmd.material != boundMaterial && cmd.shader != _placeholderHandle) {
+            if (!SetMaterialUniforms(_drawQueue.GetMaterial(cmd.material))) {
+                MT_CORE_WARN("Renderer::Flush: failed to set material uniforms");
+            }
+            boundMaterial = cmd.material;
+        }
+        if (meshHandler->vao != boundVao) {
+            _glState.BindVertexArray(meshHandler->vao);
+            boundVao = meshHandler->vao;
+        }
+
+        // runs of pooled draws sharing program, material & vao are submitted in a single call
+        size_t runLength = CountMultiDrawRun(i);
+        if (runLength >= s_minMultiDrawRun) {
+            SubmitMultiDraw(i, runLength);
+            i += runLength - 1;
+            continue;
+        }
+        SetModelUniform(cmd.model);
+
+        // actual draw command, base vertex & first index are 0 for meshes owning their buffers
+        const std::shared_ptr<Mesh>& mesh = meshHandler->mesh;
+        GLenum primitive = s_primitiveMap.at(mesh->GetPrimitiveType());
+        bool isIndexed = meshHandler->ibo != 0 || meshHandler->pool != -1;
+        GLint baseVertex = meshHandler->allocation.baseVertex;
+        const void* firstIndex = (const void*)(uintptr_t)(meshHandler->allocation.firstIndex * mesh->GetIndexSize());
+        if (conditionalQuery != 0)
+            glBeginConditionalRender(conditionalQuery, GL_QUERY_NO_WAIT);
+        if (cmd.instanceCount > 0) {
+            EnableInstanceAttributes(cmd, true);
+            if (isIndexed) {
+                GLenum indexType = s_indexFormatMap.at(mesh->GetIndexFormat());
+                glDrawElementsInstancedBaseVertex(primitive, mesh->GetIndexCount(), indexType, firstIndex, cmd.instanceCount, baseVertex);
+            } else {
+                glDrawArraysInstanced(primitive, 0, mesh->GetVertexCount(), cmd.instanceCount);
+            }
+            // restore defaults for regular draws of this vao
+            EnableInstanceAttributes(cmd, false);
+        } else if (isIndexed) {
+            GLenum indexType = s_indexFormatMap.at(mesh->GetIndexFormat());
+            glDrawElementsBaseVertex(primitive, mesh->GetIndexCount(), indexType, firstIndex, baseVertex);
+        } else {
+            glDrawArrays(primitive, 0, mesh->GetVertexCount());
+        }
+        if (conditionalQuery != 0)
+            glEndConditionalRender();
+        _stats.drawCalls++;
+        CountDraw(*mesh, isIndexed, cmd.instanceCount > 0 ? cmd.instanceCount : 1);
+    }
+    SubmitOcclusionTests();
+    _drawQueue.Clear();
+
+    _shaderHandle = userShader;
+    ShaderHandler* userHandler = GetBoundShaderHandler();
+    if (userHandler != nullptr)
+        _glState.UseProgram(userHandler->program);
+}
+
+/// NOTE: temporal coherence, a test is issued one frame and its result used by the draws of the next
+/// so objects becoming visible may appear a frame late, visible objects are only retested periodically
+/// objects are identified independent of draw order, so culling or skipping other draws can't swap their results
+Handle Renderer::FindOrCreateOcclusionQuery(const Mesh& mesh, const LA::mat4& model, uint64_t occlusionId) {
+    int64_t uuid = mesh.GetUUID();
+    uint64_t key = HashBytes(&uuid, sizeof(uuid));
+    if (occlusionId != 0) {
+        key = HashBytes(&occlusionId, sizeof(occlusionId), key);
+    } else {
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+                key = HashBytes(&model[c][r], sizeof(float), key);
+    }
+    Handle handle = Handle();
+    auto it = _occlusionLookup.find(key);
+    if (it != _occlusionLookup.end() && _occlusionQueries.Contains(it->second)) {
+        handle = it->second;
     } else {
-        glDrawArrays(primitive, 0, meshHandler.mesh->GetVertexCount());
+        OcclusionQueryHandler query = OcclusionQueryHandler();
+        query.key = key;
+        glGenQueries(1, &query.query);
+        handle = _occlusionQueries.Insert(query);
+        _occlusionLookup[key] = handle;
     }
-    glBindVertexArray(0);
+    _occlusionQueries.Get(handle)->usedFrame = _stats.frameIndex;
+    return handle;
+}
+
+void Renderer::PollOcclusionQuery(OcclusionQueryHandler& query) {
+    if (!query.isResultPending)
+        return;
+    GLuint isAvailable = GL_FALSE;
+    glGetQueryObjectuiv(query.query, GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+    if (isAvailable == GL_FALSE)
+        return;
+    GLuint anySamples = 0;
+    glGetQueryObjectuiv(query.query, GL_QUERY_RESULT, &anySamples);
+    query.isResultPending = false;
+    query.isVisible = anySamples != 0;
+    if (query.isVisible)
+        _stats.occlusionQueryHits++;
+    else
+        _stats.occlusionQueryMisses++;
+}
+
+void Renderer::SubmitOcclusionTests() {
+    if (_occlusionTests.empty())
+        return;
+    MeshHandler* proxy = _occlusionProxyMesh != nullptr ? _meshHandlers.Get(_occlusionProxyMesh->GetRendererHandle()) : nullptr;
+    ShaderHandler* program = _shaderHandlers.Get(_placeholderHandle);
+    // without a depth test every sample passes, so objects can only be assumed visible
+    bool canTest = proxy != nullptr && program != nullptr && program->isValid && _state.depthTest;
+
+    // proxies are tested against depth only, nothing is written
+    Handle boundShader = _shaderHandle;
+    if (canTest) {
+        _glState.ColorMask(false, false, false, false);
+        _glState.DepthMask(false);
+        // back faces keep the test conservative for thin or inside out bounds
+        _glState.SetCapability(GL_CULL_FACE, false);
+        _shaderHandle = _placeholderHandle;
+        _glState.UseProgram(program->program);
+        _glState.BindVertexArray(proxy->vao);
+    }
+    for (const OcclusionTest& test : _occlusionTests) {
+        OcclusionQueryHandler* query = _occlusionQueries.Get(test.query);
+        if (query == nullptr)
+            continue;
+        query->issuedFrame = _stats.frameIndex;
+        // near plane clips the proxy e.g. camera inside the bounds
+        if (!canTest || !test.bounds.isValid || IsNearPlaneCrossed(test.bounds, test.model)) {
+            query->isVisible = true;
+            continue;
+        }
+        // flat bounds still need an area to rasterise
+        LA::vec3 size = {
+            std::max(test.bounds.max.x - test.bounds.min.x, 1e-4f),
+            std::max(test.bounds.max.y - test.bounds.min.y, 1e-4f),
+            std::max(test.bounds.max.z - test.bounds.min.z, 1e-4f)
+        };
+        SetModelUniform(test.model * LA::Translate(test.bounds.center) * LA::Scale(size));
+        const Mesh& mesh = *proxy->mesh;
+        GLenum primitive = s_primitiveMap.at(mesh.GetPrimitiveType());
+        glBeginQuery(_occlusionQueryTarget, query->query);
+        if (proxy->ibo != 0 || proxy->pool != -1) {
+            const void* firstIndex = (const void*)(uintptr_t)(proxy->allocation.firstIndex * mesh.GetIndexSize());
+            glDrawElementsBaseVertex(primitive, mesh.GetIndexCount(), s_indexFormatMap.at(mesh.GetIndexFormat()),
+                firstIndex, proxy->allocation.baseVertex);
+        } else {
+            glDrawArrays(primitive, 0, mesh.GetVertexCount());
+        }
+        glEndQuery(_occlusionQueryTarget);
+        query->isResultPending = true;
+        _stats.occlusionQueries++;
+    }
+    _occlusionTests.clear();
+    if (!canTest)
+        return;
+
+    _glState.ColorMask(true, true, true, true);
+    _glState.DepthMask(_state.depthMask);
+    _glState.SetCapability(GL_CULL_FACE, _state.cullTest);
+    // uniforms set after the flush go to the previously bound shader
+    _shaderHandle = boundShader;
+    ShaderHandler* boundHandler = GetBoundShaderHandler();
+    if (boundHandler != nullptr)
+        _glState.UseProgram(boundHandler->program);
+}
+
+bool Renderer::IsNearPlaneCrossed(const Bounds& bounds, const LA::mat4& model) {
+    LA::mat4 m = GetProjection() * GetView() * model;
+    for (int i = 0; i < 8; i++) {
+        float x = (i & 1) ? bounds.max.x : bounds.min.x;
+        float y = (i & 2) ? bounds.max.y : bounds.min.y;
+        float z = (i & 4) ? bounds.max.z : bounds.min.z;
+        // clip space z & w, matrices are column major
+        float cz = m[0][2] * x + m[1][2] * y + m[2][2] * z + m[3][2];
+        float cw = m[0][3] * x + m[1][3] * y + m[2][3] * z + m[3][3];
+        if (cw <= 0.0f || cz < -cw)
+            return true;
+    }
+    return false;
+}
+
+/// --- Transforms ---
+void Renderer::SetProjection(const LA::mat4& proj) {
+    Flush();
+    renderer::Renderer::SetProjection(proj);
+    _isFrameGlobalsDirty = true;
+    _isFrustumDirty = true;
+    _isOcclusionDirty = true;
+}
+void Renderer::SetView(const LA::mat4& view) {
+    Flush();
+    renderer::Renderer::SetView(view);
+    _isFrameGlobalsDirty = true;
+    _isFrustumDirty = true;
+    _isOcclusionDirty = true;
 }
 
 /// --- State Management ---
+/// NOTE: state affecting draws flushes the draw queue so queued draws use the state they were issued with
 void Renderer::SetState(RendererState state) {
 
 }
@@ -382,11 +980,14 @@ LA::vec4 Renderer::GetColorMask() {
 }
 void Renderer::SetClearColor(const LA::vec4& colour) {
     _state.clearColor = colour;
-    glClearColor(colour.r, colour.g, colour.b, colour.a);
+    _glState.ClearColor(colour.r, colour.g, colour.b, colour.a);
 }
 void Renderer::SetColorMask(const LA::vec4& mask) {
+    const LA::vec4& cur = _state.colorMask;
+    if (cur.r != mask.r || cur.g != mask.g || cur.b != mask.b || cur.a != mask.a)
+        Flush();
     _state.colorMask = mask;
-    glColorMask(mask.r != 0.0f, mask.g != 0.0f, mask.b != 0.0f, mask.a != 0.0f);
+    _glState.ColorMask(mask.r != 0.0f, mask.g != 0.0f, mask.b != 0.0f, mask.a != 0.0f);
 }
 // culling
 bool Renderer::GetCullTest() {
@@ -399,17 +1000,22 @@ CullWinding Renderer::GetCullWinding() {
     return _state.cullWinding;
 }
 void Renderer::SetCullTest(bool enabled) {
+    if (_state.cullTest != enabled)
+        Flush();
     _state.cullTest = enabled;
-    if (enabled) glEnable(GL_CULL_FACE);
-    else glDisable(GL_CULL_FACE);
+    _glState.SetCapability(GL_CULL_FACE, enabled);
 }
 void Renderer::SetCullFace(CullFace face) {
+    if (_state.cullFace != face)
+        Flush();
     _state.cullFace = face;
-    glCullFace(s_cullFaceMap.at(face));
+    _glState.CullFace(s_cullFaceMap.at(face));
 }
 void Renderer::SetCullWinding(CullWinding winding) {
+    if (_state.cullWinding != winding)
+        Flush();
     _state.cullWinding = winding;
-    glFrontFace(s_cullWindingMap.at(winding));
+    _glState.FrontFace(s_cullWindingMap.at(winding));
 }
 // depth triangle vertices we're defining them in a certain winding order that is either clockwise or counter-clockwise. Each triangle consists of 3 vertices and we specify those 3 vertices in a winding order as seen from the center of the triangle.
 bool Renderer::GetDepthTest() {
@@ -422,17 +1028,22 @@ bool Renderer::GetDepthMask() {
     return _state.depthMask;
 }
 void Renderer::SetDepthTest(bool enabled) {
+    if (_state.depthTest != enabled)
+        Flush();
     _state.depthTest = enabled;
-    if (enabled) glEnable(GL_DEPTH_TEST);
-    else glDisable(GL_DEPTH_TEST);
+    _glState.SetCapability(GL_DEPTH_TEST, enabled);
 }
 void Renderer::SetDepthFunction(DepthFunc func) {
+    if (_state.depthFunc != func)
+        Flush();
     _state.depthFunc = func;
-    glDepthFunc(s_depthFuncMap.at(func));
+    _glState.DepthFunc(s_depthFuncMap.at(func));
 }
 void Renderer::SetDepthMask(bool enabled) {
+    if (_state.depthMask != enabled)
+        Flush();
     _state.depthMask = enabled;
-    glDepthMask(enabled);
+    _glState.DepthMask(enabled);
 }
 // rasterization
 float Renderer::GetLineWidth() {
@@ -445,24 +1056,56 @@ bool Renderer::GetIsWireframe() {
     return _state.isWireframe;
 }
 void Renderer::SetLineWidth(float width) {
+    if (_state.lineWidth != width)
+        Flush();
     _state.lineWidth = width;
-    glLineWidth(width);
+    _glState.LineWidth(width);
 }
 void Renderer::SetPointSize(float size) {
+    if (_state.pointSize != size)
+        Flush();
     _state.pointSize = size;
-    glPointSize(size);
+    _glState.PointSize(size);
 }
 void Renderer::SetIsWireframe(bool enabled) {
+    if (_state.isWireframe != enabled)
+        Flush();
     _state.isWireframe = enabled;
-    if (enabled) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    else glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    _glState.PolygonMode(enabled ? GL_LINE : GL_FILL);
+}
+
+// visibility
+bool Renderer::GetFrustumCulling() {
+    return _state.frustumCulling;
+}
+void Renderer::SetFrustumCulling(bool enabled) {
+    _state.frustumCulling = enabled;
+}
+bool Renderer::GetOcclusionCulling() {
+    return _state.occlusionCulling;
+}
+void Renderer::SetOcclusionCulling(bool enabled) {
+    _state.occlusionCulling = enabled;
+}
+bool Renderer::GetOcclusionQueries() {
+    return _state.occlusionQueries;
+}
+void Renderer::SetOcclusionQueries(bool enabled) {
+    _state.occlusionQueries = enabled;
 }
 
 /// --- Mesh Stuff ---
 /// IMPORTANT NOTE TODO: current handler system ONLY allows for a single mesh/shader per handler
 /// CONSIDER implications
-/// No check of dirty flags atm
-int Renderer::CreateMeshHandler(std::shared_ptr<Mesh> mesh) {
+Handle Renderer::CreateMeshHandler(std::shared_ptr<Mesh> mesh) {
+    Handle handle = _meshHandlers.Insert(BuildMeshHandler(mesh));
+    _stats.handlersCreated++;
+    mesh->SetRendererHandle(handle);
+    _meshLookup[mesh->GetUUID()] = handle;
+    return handle;
+}
+// creates gl objects & uploads all mesh data
+Renderer::MeshHandler Renderer::BuildMeshHandler(std::shared_ptr<Mesh> mesh) {
     // assert(vBuf != nullptr && "Vertex buffer must not be null");
     // assert(vCount > 0 && "Vertex count must be greater than 0");
     // assert(vAttrs.size() > 0 && "Vertex attributes must not be empty");
@@ -473,14 +1116,11 @@ int Renderer::CreateMeshHandler(std::shared_ptr<Mesh> mesh) {
     std::vector<VertexAttributeDescriptor>vertexAttrs = mesh->GetVertexAttributes();
     int vertexSize = mesh->GetVertexSize();
     const void* vertexData = mesh->GetVertexPtr();
+    int indexCount = mesh->GetIndexCount();
+    int indexSize = mesh->GetIndexSize();
+    const void* indexData = mesh->GetIndexPtr();
 
-    // NOTE: we still create opengl resources even if data is not uploaded/it remains empty
-    // it is safe to do so, so :/
-    GLuint vao = 0, vbo = 0, ibo = 0;
     std::string warnings = "";
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-
     if (vertexCount == 0)
         warnings += "No vertices defined\n";
     if (vertexAttrs.size() == 0)
@@ -489,14 +1129,128 @@ int Renderer::CreateMeshHandler(std::shared_ptr<Mesh> mesh) {
         warnings += "Vertex size is 0 bytes\n";
     if (vertexData == nullptr)
         warnings += "Vertex data is nullptr\n";
+    if (indexCount != 0) {
+        if (indexSize == 0)
+            warnings += "Index size is 0 bytes\n";
+        if (indexData == nullptr)    
+            warnings += "Index data is nullptr\n";
+    }
+    std::vector<VertexBinding> bindings = GetVertexBindings(mesh, warnings);
+
+    MeshHandler meshHandler = {
+        .mesh = mesh,
+        .attributeMask = MakeAttributeMask(*mesh),
+        .warnings = warnings,
+        .isValid = vertexCount > 0 && vertexAttrs.size() > 0 && vertexSize > 0 && (indexCount == 0 || (indexCount > 0 && indexSize > 0))
+    };
+
+    // static indexed meshes share pooled buffers so consecutive draws don't rebind the vao
+    bool isPoolable = meshHandler.isValid && warnings.empty() && indexCount > 0
+        && mesh->GetBufferUsage() == BufferUsage::STATIC;
+    if (isPoolable) {
+        int pool = FindOrCreateMeshPool(mesh, bindings);
+        if (_meshPools[pool]->Allocate(*mesh, meshHandler.allocation)) {
+            meshHandler.pool = pool;
+            meshHandler.vao = _meshPools[pool]->GetVertexArray();
+        }
+    }
 
-    // create and bind vertex buffer
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertexSize * vertexCount, vertexData, GL_STATIC_DRAW);
+    if (meshHandler.pool == -1) {
+        // NOTE: we still create opengl resources even if data is not uploaded/it remains empty
+        // it is safe to do so, so :/
+        GLenum usage = mesh->GetBufferUsage() == BufferUsage::STATIC ? GL_STATIC_DRAW
+            : mesh->GetBufferUsage() == BufferUsage::DYNAMIC ? GL_DYNAMIC_DRAW : GL_STREAM_DRAW;
+        glGenVertexArrays(1, &meshHandler.vao);
+        _glState.BindVertexArray(meshHandler.vao);
+
+        // create and bind vertex buffer
+        glGenBuffers(1, &meshHandler.vbo);
+        _glState.BindBuffer(GL_ARRAY_BUFFER, meshHandler.vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertexSize * vertexCount, vertexData, usage);
+
+        for (const auto& binding : bindings) {
+            glEnableVertexAttribArray(binding.location);
+            glVertexAttribPointer(binding.location, binding.components, binding.type,
+                GL_FALSE, vertexSize, (void*)binding.offset);
+        }
+
+        // create and bind index buffer if set
+        if (indexCount != 0 ) {
+            glGenBuffers(1, &meshHandler.ibo);
+            _glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshHandler.ibo);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, indexData, usage);
+        } else {
+            MT_CORE_INFO("Renderer::CreateMeshHandler: no indices defined");
+        }
+        /// NOTE: vao is left bound, the state cache knows so no unbind needed
+    }
 
-    /// TODO: more efficient to manually go through internal mesh data rather than repeatedly using
-    /// iterative get methods
+    // everything is uploaded
+    _stats.bytesUploaded += (int64_t)vertexSize * vertexCount + (int64_t)indexSize * indexCount;
+    mesh->ClearVertexDirtyFlag();
+    mesh->ClearIndexDirtyFlag();
+    return meshHandler;
+}
+// apply pending edits of the mesh to its gpu buffers
+void Renderer::UpdateMeshHandler(MeshHandler& meshHandler) {
+    std::shared_ptr<Mesh> mesh = meshHandler.mesh;
+    DataDirty vertexDirty = mesh->GetVertexDirtyFlag();
+    DataDirty indexDirty = mesh->GetIndexDirtyFlag();
+    if (vertexDirty == DataDirty::CLEAN && indexDirty == DataDirty::CLEAN)
+        return;
+    // queued draws of the mesh must see the data they were issued with
+    if (meshHandler.queuedFlush == _flushIndex && !_drawQueue.Empty())
+        Flush();
+    // after the flush so queued draws are tested with the bounds they were issued with
+    mesh->UpdateBounds();
+
+    // sizes changed, rebuild in place so the handle stays valid for queued draws
+    if (vertexDirty == DataDirty::DIRTY_REALLOC || indexDirty == DataDirty::DIRTY_REALLOC
+        || vertexDirty == DataDirty::DIRTY_DELETE || indexDirty == DataDirty::DIRTY_DELETE) {
+        DestroyMeshHandler(meshHandler);
+        meshHandler = BuildMeshHandler(mesh);
+        return;
+    }
+
+    // dynamic data is staged through the stream buffer so the copy is queued on the gpu
+    // rather than the driver syncing or shadow copying
+    bool isStaged = mesh->GetBufferUsage() != BufferUsage::STATIC;
+    MeshPool* pool = meshHandler.pool != -1 ? _meshPools[meshHandler.pool].get() : nullptr;
+    if (vertexDirty == DataDirty::DIRTY_UPDATE) {
+        GLuint vbo = pool != nullptr ? pool->GetVertexBuffer() : meshHandler.vbo;
+        size_t base = meshHandler.allocation.baseVertex * mesh->GetVertexSize();
+        const uint8_t* data = (const uint8_t*)mesh->GetVertexPtr();
+        for (const DataRange& range : mesh->GetVertexDirtyRanges().GetRanges())
+            UploadBufferRange(vbo, base + range.offset, data + range.offset, range.size, isStaged);
+        mesh->ClearVertexDirtyFlag();
+    }
+    if (indexDirty == DataDirty::DIRTY_UPDATE) {
+        GLuint ibo = pool != nullptr ? pool->GetIndexBuffer() : meshHandler.ibo;
+        size_t base = meshHandler.allocation.firstIndex * mesh->GetIndexSize();
+        const uint8_t* data = (const uint8_t*)mesh->GetIndexPtr();
+        for (const DataRange& range : mesh->GetIndexDirtyRanges().GetRanges())
+            UploadBufferRange(ibo, base + range.offset, data + range.offset, range.size, isStaged);
+        mesh->ClearIndexDirtyFlag();
+    }
+}
+/// NOTE: uses the copy write target so element array bindings of vaos are untouched
+void Renderer::UploadBufferRange(GLuint buffer, size_t offset, const void* data, size_t size, bool isStaged) {
+    _stats.bytesUploaded += size;
+    if (isStaged && _uploadStream != nullptr) {
+        size_t srcOffset = _uploadStream->Write(data, size);
+        _glState.BindBuffer(GL_COPY_READ_BUFFER, _uploadStream->GetBuffer());
+        _glState.BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, srcOffset, offset, size);
+        return;
+    }
+    _glState.BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+}
+/// TODO: more efficient to manually go through internal mesh data rather than repeatedly using
+/// iterative get methods
+std::vector<VertexBinding> Renderer::GetVertexBindings(std::shared_ptr<Mesh> mesh, std::string& warnings) {
+    std::vector<VertexBinding> bindings;
+    std::vector<VertexAttributeDescriptor> vertexAttrs = mesh->GetVertexAttributes();
     for (int i = 0; i < vertexAttrs.size(); i++) {
         const auto& desc = vertexAttrs[i];
         int attrLoc = mesh->GetVertexAttributeLocation(desc.attribute);
@@ -510,68 +1264,122 @@ int Renderer::CreateMeshHandler(std::shared_ptr<Mesh> mesh) {
             warnings += "Vertex attribute (" + std::to_string(i) + ") format invalid\n";
             continue;
         }
-        int offset = mesh->GetVertexAttributeOffset(desc.attribute);
-
-        glEnableVertexAttribArray(attrLoc);
-        glVertexAttribPointer(attrLoc, desc.numComponents, attrType,
-            GL_FALSE, vertexSize, (void*)offset);
+        bindings.push_back({
+            .location = (GLuint)attrLoc,
+            .components = desc.numComponents,
+            .type = attrType,
+            .offset = mesh->GetVertexAttributeOffset(desc.attribute)
+        });
     }
-
-    // create and bind index buffer if set
-    int indexCount = mesh->GetIndexCount();
-    int indexSize = mesh->GetIndexSize();
-    const void* indexData = mesh->GetIndexPtr();
-    if (indexCount != 0 ) {
-        if (indexSize == 0)
-            warnings += "Index size is 0 bytes\n";
-        if (indexData == nullptr)    
-            warnings += "Index data is nullptr\n";
-
-        glGenBuffers(1, &ibo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, indexData, GL_STATIC_DRAW);
-    } else {
-        MT_CORE_INFO("Renderer::CreateMeshHandler: no indices defined");
-    }
-
-    // unbind vao for safety
-    glBindVertexArray(0);
-
-    MeshHandler meshHandler = {
-        .mesh = mesh,
-        .vao = vao,
-        .vbo = vbo,
-        .ibo = ibo,
-        .warnings = warnings,
-        .isValid = vertexCount > 0 && vertexAttrs.size() > 0 && vertexSize > 0 && (indexCount == 0 || (indexCount > 0 && indexSize > 0))
-    };
-    _meshHandlers.push_back(meshHandler);
-    return _meshHandlers.size() - 1;
+    return bindings;
+}
+int Renderer::FindOrCreateMeshPool(std::shared_ptr<Mesh> mesh, const std::vector<VertexBinding>& bindings) {
+    std::string key = MeshPool::MakeLayoutKey(*mesh);
+    auto it = _meshPoolLookup.find(key);
+    if (it != _meshPoolLookup.end())
+        return it->second;
+    int pool = _meshPools.size();
+    MT_CORE_DEBUG("Renderer::FindOrCreateMeshPool: creating pool {} for layout {}", pool, key);
+    _meshPools.push_back(std::make_unique<MeshPool>(_glState, bindings, mesh->GetVertexSize(), mesh->GetIndexSize()));
+    _meshPoolLookup[key] = pool;
+    return pool;
 }
-int Renderer::FindOrCreateMeshHandler(std::shared_ptr<Mesh> mesh) {
-    for (int i = 0; i < _meshHandlers.size(); i++) {
-        if (_meshHandlers[i].mesh == mesh) {
-            return i;
+Handle Renderer::FindOrCreateMeshHandler(std::shared_ptr<Mesh> mesh) {
+    // fast path, handle stored on mesh after first upload
+    Handle handle = mesh->GetRendererHandle();
+    MeshHandler* meshHandler = _meshHandlers.Get(handle);
+    if (meshHandler != nullptr && meshHandler->mesh == mesh) {
+        return handle;
+    }
+    // stale or foreign handle, fallback to uuid
+    auto it = _meshLookup.find(mesh->GetUUID());
+    if (it != _meshLookup.end()) {
+        meshHandler = _meshHandlers.Get(it->second);
+        if (meshHandler != nullptr && meshHandler->mesh == mesh) {
+            mesh->SetRendererHandle(it->second);
+            return it->second;
         }
     }
     return CreateMeshHandler(mesh);
 }
+void Renderer::DestroyMeshHandler(MeshHandler& meshHandler) {
+    if (meshHandler.pool != -1) {
+        // pool owns the gl objects, only give back the space
+        _meshPools[meshHandler.pool]->Free(meshHandler.allocation);
+        return;
+    }
+    _glState.OnDeleteVertexArray(meshHandler.vao);
+    _glState.OnDeleteBuffer(meshHandler.vbo);
+    _glState.OnDeleteBuffer(meshHandler.ibo);
+    glDeleteVertexArrays(1, &meshHandler.vao);
+    glDeleteBuffers(1, &meshHandler.vbo);
+    glDeleteBuffers(1, &meshHandler.ibo);
+}
 
 
 /// --- Shader Stuff ---
 
-/// TODO: consider how to handle shader warnings and forcing the user to deal with bad shaders
-int Renderer::CreateShaderHandler(std::shared_ptr<Shader> shader) {
-    CheckError();
+/// NOTE: shaders compile asynchronously, with KHR_parallel_shader_compile all handlers compile at once
+/// on driver threads and are polled for completion, otherwise a few are compiled per frame
+/// a handler's status is COMPILING until linked, draws using it are skipped or use the placeholder
+
+// build handler & submit compile, from the program cache if possible
+Renderer::ShaderHandler Renderer::BuildShaderHandler(std::shared_ptr<Shader> shader, uint64_t variantKey) {
+    ShaderHandler shaderHandler = {
+        .variantKey = variantKey,
+        .vSource = BuildVariantHeader(shader, variantKey, true) + s_vertexHeader + shader->GetVertexSource(),
+        .fSource = BuildVariantHeader(shader, variantKey, false) + s_fragmentHeader + shader->GetFragmentSource(),
+        .status = ShaderStatus::COMPILING
+    };
+
+    // try cached binary before compiling from source
+    shaderHandler.cacheKey = _programCache.MakeKey(shaderHandler.vSource, shaderHandler.fSource);
+    shaderHandler.program = _programCache.Load(shaderHandler.cacheKey);
+    if (shaderHandler.program != 0) {
+        FinishShaderCompile(shaderHandler);
+        return shaderHandler;
+    }
+    // parallel compile is kicked off immediately, otherwise deferred to the frame budget
+    if (_hasParallelCompile)
+        StartShaderCompile(shaderHandler);
+    return shaderHandler;
+}
+
+// defines must follow the #version line of the global header
+std::string Renderer::BuildVariantHeader(std::shared_ptr<Shader> shader, uint64_t variantKey, bool isVertex) {
+    uint32_t attributeMask = variantKey & 0xFFFFFFFF;
+    uint32_t featureMask = variantKey >> 32;
+    std::string header = s_globalHeader + "\n// variant defines\n";
+    const std::vector<std::string>& features = shader->GetFeatures();
+    for (size_t i = 0; i < features.size(); i++) {
+        if (featureMask & (1u << i))
+            header += "#define " + features[i] + " 1\n";
+    }
+    for (const auto& decl : s_vertexAttributeDecls) {
+        if (attributeMask & (1u << (int)decl.attribute))
+            header += std::string("#define ") + decl.define + " 1\n";
+    }
+    if (!isVertex)
+        return header;
+
+    // missing attributes become constants so user code still compiles & the fetch is stripped
+    header += "\n// vertex attributes\n";
+    for (const auto& decl : s_vertexAttributeDecls) {
+        if (attributeMask & (1u << (int)decl.attribute)) {
+            header += "layout(location = " + std::to_string(decl.location) + ") in " + decl.type + " " + decl.name + ";\n";
+        } else {
+            header += std::string("const ") + decl.type + " " + decl.name + " = " + decl.fallback + ";\n";
+        }
+    }
+    return header;
+}
 
+void Renderer::StartShaderCompile(ShaderHandler& shaderHandler) {
     GLuint program = glCreateProgram();
     GLuint vShader = glCreateShader(GL_VERTEX_SHADER);
     GLuint fShader = glCreateShader(GL_FRAGMENT_SHADER);
-
-    std::string vSource = s_globalHeader + s_vertexHeader + shader->GetVertexSource();
-    std::string fSource = s_globalHeader + s_fragmentHeader + shader->GetFragmentSource();
-    const char* vSrcC = vSource.c_str();
-    const char* fSrcC = fSource.c_str();
+    const char* vSrcC = shaderHandler.vSource.c_str();
+    const char* fSrcC = shaderHandler.fSource.c_str();
 
     MT_CORE_TRACE("Vertex Shader Code: \n{}", vSrcC);
     MT_CORE_TRACE("Fragment Shader Code: \n{}", fSrcC);
@@ -582,107 +1390,533 @@ int Renderer::CreateShaderHandler(std::shared_ptr<Shader> shader) {
     glCompileShader(vShader);
     glCompileShader(fShader);
 
-    GLint vSuccess;
+    glAttachShader(program, vShader);
+    glAttachShader(program, fShader);
+    // must be set before linking for the binary to be retrievable for the cache
+    if (_programCache.IsEnabled())
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+
+    shaderHandler.program = program;
+    shaderHandler.vShader = vShader;
+    shaderHandler.fShader = fShader;
+}
+
+// true if finishing the compile won't block
+bool Renderer::IsShaderCompileDone(const ShaderHandler& shaderHandler) {
+    if (shaderHandler.status != ShaderStatus::COMPILING)
+        return true;
+    if (shaderHandler.program == 0)
+        return false;
+    if (!_hasParallelCompile)
+        return true;
+    GLint done = GL_FALSE;
+    glGetProgramiv(shaderHandler.program, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+// collect results of compile, blocks if not done, starts the compile first if needed
+void Renderer::FinishShaderCompile(ShaderHandler& shaderHandler) {
+    if (shaderHandler.status != ShaderStatus::COMPILING)
+        return;
+    if (shaderHandler.program == 0)
+        StartShaderCompile(shaderHandler);
+
     std::string warnings = "";
-    glGetShaderiv(vShader, GL_COMPILE_STATUS, &vSuccess);
-    if (!vSuccess) {
-        GLchar infoLog[512];
-        glGetShaderInfoLog(vShader, 512, nullptr, infoLog);
-        warnings += "Vertex shader compilation failed: \n" + std::string(infoLog) + "\n\n";
-    }
+    // shader objects are only present if compiled from source rather than loaded from the cache
+    bool isCompiled = shaderHandler.vShader == 0;
+    if (!isCompiled) {
+        GLint vSuccess;
+        glGetShaderiv(shaderHandler.vShader, GL_COMPILE_STATUS, &vSuccess);
+        if (!vSuccess) {
+            GLchar infoLog[512];
+            glGetShaderInfoLog(shaderHandler.vShader, 512, nullptr, infoLog);
+            warnings += "Vertex shader compilation failed: \n" + std::string(infoLog) + "\n\n";
+        }
 
-    GLint fSuccess;
-    glGetShaderiv(fShader, GL_COMPILE_STATUS, &fSuccess);
-    if (!fSuccess) {
-        GLchar infoLog[512];
-        glGetShaderInfoLog(fShader, 512, nullptr, infoLog);
-        warnings += "Fragment shader compilation failed: \n" + std::string(infoLog) + "\n\n";
+        GLint fSuccess;
+        glGetShaderiv(shaderHandler.fShader, GL_COMPILE_STATUS, &fSuccess);
+        if (!fSuccess) {
+            GLchar infoLog[512];
+            glGetShaderInfoLog(shaderHandler.fShader, 512, nullptr, infoLog);
+            warnings += "Fragment shader compilation failed: \n" + std::string(infoLog) + "\n\n";
+        }
+
+        GLint pSuccess;
+        glGetProgramiv(shaderHandler.program, GL_LINK_STATUS, &pSuccess);
+        if (!pSuccess) {
+            GLchar infoLog[512];
+            glGetProgramInfoLog(shaderHandler.program, 512, nullptr, infoLog);
+            warnings += "Shader program linking failed: \n" + std::string(infoLog) + "\n\n";
+        }
+
+        glDeleteShader(shaderHandler.vShader);
+        glDeleteShader(shaderHandler.fShader);
+        shaderHandler.vShader = 0;
+        shaderHandler.fShader = 0;
+        isCompiled = vSuccess && fSuccess && pSuccess;
+        if (isCompiled)
+            _programCache.Store(shaderHandler.cacheKey, shaderHandler.program);
     }
 
-    glAttachShader(program, vShader);
-    glAttachShader(program, fShader);
-    glLinkProgram(program);
+    // sources no longer needed
+    shaderHandler.vSource.clear();
+    shaderHandler.fSource.clear();
+    shaderHandler.warnings = warnings;
+    shaderHandler.isValid = isCompiled;
+    shaderHandler.status = isCompiled ? ShaderStatus::READY : ShaderStatus::FAILED;
+    if (!isCompiled)
+        return;
 
-    GLint pSuccess;
-    glGetProgramiv(program, GL_LINK_STATUS, &pSuccess);
-    if (!pSuccess) {
-        GLchar infoLog[512];
-        glGetProgramInfoLog(program, 512, nullptr, infoLog);
-        warnings += "Shader program linking failed: \n" + std::string(infoLog) + "\n\n";
+    GLuint program = shaderHandler.program;
+    // glsl 330 has no binding layout qualifier so blocks are bound after link
+    GLuint globalsIndex = glGetUniformBlockIndex(program, "FrameGlobals");
+    if (globalsIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, globalsIndex, s_frameGlobalsBinding);
+    // unused attributes are inactive & have no location
+    shaderHandler.hasInstanceModel = glGetAttribLocation(program, "instance_model") != -1;
+    ReflectUniforms(shaderHandler);
+    ReflectMaterialBlock(shaderHandler);
+}
+
+// finish completed compiles, starting up to budget serial compiles if parallel compile is unsupported
+void Renderer::PollShaderCompiles(int budget) {
+    std::vector<Handle> pending;
+    for (Handle handle : _pendingShaders) {
+        ShaderHandler* shaderHandler = _shaderHandlers.Get(handle);
+        if (shaderHandler == nullptr || shaderHandler->status != ShaderStatus::COMPILING)
+            continue;
+        if (_hasParallelCompile) {
+            if (IsShaderCompileDone(*shaderHandler))
+                FinishShaderCompile(*shaderHandler);
+        } else if (budget > 0) {
+            FinishShaderCompile(*shaderHandler);
+            budget--;
+        }
+        if (shaderHandler->status == ShaderStatus::COMPILING)
+            pending.push_back(handle);
+    }
+    _pendingShaders.swap(pending);
+}
+
+// hash of everything that affects the compiled programs of a shader, the headers are the same for all shaders
+uint64_t Renderer::MakeSourceKey(const Shader& shader) {
+    const char separator = '\0';
+    uint64_t key = HashString(shader.GetVertexSource());
+    key = HashBytes(&separator, 1, key);
+    key = HashString(shader.GetFragmentSource(), key);
+    for (const auto& feature : shader.GetFeatures()) {
+        key = HashBytes(&separator, 1, key);
+        key = HashString(feature, key);
+    }
+    return key;
+}
+// nothing is compiled until a variant is requested
+Handle Renderer::CreateShaderHandler(uint64_t sourceKey) {
+    ShaderHandler shaderHandler = ShaderHandler();
+    shaderHandler.sourceKey = sourceKey;
+    Handle handle = _shaderHandlers.Insert(std::move(shaderHandler));
+    _stats.handlersCreated++;
+    _programLookup[sourceKey] = handle;
+    return handle;
+}
+// share the handler of identical sources if one exists
+Handle Renderer::AttachShader(std::shared_ptr<Shader> shader) {
+    shader->ClearDirtyFlag();
+    uint64_t sourceKey = MakeSourceKey(*shader);
+    Handle handle = Handle();
+    auto it = _programLookup.find(sourceKey);
+    if (it != _programLookup.end() && _shaderHandlers.Get(it->second) != nullptr) {
+        handle = it->second;
+        MT_CORE_TRACE("Renderer::AttachShader: sharing program of handler {}", handle.index);
+    } else {
+        handle = CreateShaderHandler(sourceKey);
+    }
+    _shaderHandlers.Get(handle)->users.push_back({ shader->GetUUID(), shader });
+    shader->SetRendererHandle(handle);
+    _shaderLookup[shader->GetUUID()] = handle;
+    return handle;
+}
+// handlers left without users are released by CollectHandlers, so queued draws stay valid until the frame ends
+void Renderer::DetachShader(Handle handle, std::shared_ptr<Shader> shader) {
+    ShaderHandler* shaderHandler = _shaderHandlers.Get(handle);
+    if (shaderHandler == nullptr)
+        return;
+    std::vector<ShaderUser>& users = shaderHandler->users;
+    users.erase(std::remove_if(users.begin(), users.end(), [&shader](const ShaderUser& user) {
+        return user.uuid == shader->GetUUID();
+    }), users.end());
+    _shaderLookup.erase(shader->GetUUID());
+}
+/// NOTE: shaders sharing sources share a handler, so its programs & variants are compiled once for all of them
+Handle Renderer::FindOrCreateShaderHandler(std::shared_ptr<Shader> shader) {
+    // fast path, handle stored on shader after first upload
+    Handle handle = shader->GetRendererHandle();
+    ShaderHandler* shaderHandler = _shaderHandlers.Get(handle);
+    if (shaderHandler == nullptr || shaderHandler->base.IsValid()) {
+        // stale or foreign handle, fallback to uuid
+        shaderHandler = nullptr;
+        auto it = _shaderLookup.find(shader->GetUUID());
+        if (it != _shaderLookup.end()) {
+            shaderHandler = _shaderHandlers.Get(it->second);
+            if (shaderHandler != nullptr) {
+                handle = it->second;
+                shader->SetRendererHandle(handle);
+            }
+        }
+    }
+    if (shaderHandler == nullptr)
+        return AttachShader(shader);
+
+    // sources changed, move to the handler of the new sources, unless they hash the same
+    if (shader->GetDirtyFlag() == ShaderDirty::DIRTY_COMPILE) {
+        if (MakeSourceKey(*shader) == shaderHandler->sourceKey) {
+            shader->ClearDirtyFlag();
+            return handle;
+        }
+        DetachShader(handle, shader);
+        return AttachShader(shader);
+    }
+    return handle;
+}
+Handle Renderer::FindOrCreateShaderVariant(std::shared_ptr<Shader> shader, uint64_t variantKey, bool isPinned) {
+    Handle handle = FindOrCreateShaderHandler(shader);
+    ShaderHandler* shaderHandler = _shaderHandlers.Get(handle);
+    auto it = shaderHandler->variants.find(variantKey);
+    if (it != shaderHandler->variants.end()) {
+        ShaderHandler* variantHandler = _shaderHandlers.Get(it->second);
+        variantHandler->usedFrame = _stats.frameIndex;
+        variantHandler->isPinned |= isPinned;
+        return it->second;
     }
 
-    glDeleteShader(vShader);
-    glDeleteShader(fShader);
+    ShaderHandler variantHandler = BuildShaderHandler(shader, variantKey);
+    variantHandler.base = handle;
+    variantHandler.usedFrame = _stats.frameIndex;
+    variantHandler.isPinned = isPinned;
+    Handle variantHandle = _shaderHandlers.Insert(std::move(variantHandler));
+    _stats.handlersCreated++;
+    if (_shaderHandlers.Get(variantHandle)->status == ShaderStatus::COMPILING)
+        _pendingShaders.push_back(variantHandle);
+    // insert may have moved the slots
+    _shaderHandlers.Get(handle)->variants[variantKey] = variantHandle;
+    MT_CORE_DEBUG("Renderer::FindOrCreateShaderVariant: compiling variant {:#x}", variantKey);
+    return variantHandle;
+}
+uint32_t Renderer::MakeAttributeMask(const Mesh& mesh) {
+    uint32_t attributeMask = 0;
+    for (const auto& attr : mesh.GetVertexAttributes())
+        attributeMask |= 1u << (int)attr.attribute;
+    return attributeMask;
+}
+uint64_t Renderer::MakeVariantKey(const Material& material, uint32_t attributeMask) {
+    return (uint64_t)material.GetFeatureMask() << 32 | (attributeMask & s_allAttributesMask);
+}
+void Renderer::DestroyShaderHandler(ShaderHandler& shaderHandler) {
+    _glState.OnDeleteProgram(shaderHandler.program);
+    glDeleteProgram(shaderHandler.program);
+    // compile may still be in flight
+    glDeleteShader(shaderHandler.vShader);
+    glDeleteShader(shaderHandler.fShader);
+}
+Renderer::ShaderHandler* Renderer::GetBoundShaderHandler() {
+    return _shaderHandlers.Get(_shaderHandle);
+}
 
-    ShaderHandler shaderHandler = {
-        .shader = shader,
-        .program = program,
-        .warnings = warnings,
-        .isValid = vSuccess && fSuccess && pSuccess
-    };
-    _shaderHandlers.push_back(shaderHandler);
-    return _shaderHandlers.size() - 1;
+// query all active uniforms once after link so no locations are looked up at draw time
+void Renderer::ReflectUniforms(ShaderHandler& shaderHandler) {
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(shaderHandler.program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(shaderHandler.program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<GLchar> nameBuffer(maxNameLength + 1, '\0');
+    shaderHandler.uniforms.clear();
+    shaderHandler.uniforms.reserve(uniformCount);
+    for (GLint i = 0; i < uniformCount; i++) {
+        GLsizei nameLength = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+        glGetActiveUniform(shaderHandler.program, i, nameBuffer.size(), &nameLength, &arraySize, &type, nameBuffer.data());
+        std::string name(nameBuffer.data(), nameLength);
+        // uniform block members have no location
+        if (glGetUniformLocation(shaderHandler.program, name.c_str()) == -1)
+            continue;
+
+        // arrays are reported once as "name[0]", every element is stored & the base name aliases element 0
+        // elements of struct arrays e.g. "lights[1].pos" are reported individually so are kept as is
+        std::vector<std::string> names = { name };
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            std::string base = name.substr(0, name.size() - 3);
+            names = { base };
+            for (GLint element = 0; element < arraySize; element++)
+                names.push_back(base + "[" + std::to_string(element) + "]");
+        }
+        for (const std::string& elementName : names) {
+            UniformInfo info = {
+                .name = elementName,
+                .id = GetUniformId(elementName),
+                .type = type,
+                .location = glGetUniformLocation(shaderHandler.program, elementName.c_str()),
+                .arraySize = elementName == names[0] ? arraySize : 1
+            };
+            // trailing elements may be optimised out
+            if (info.location == -1)
+                continue;
+            shaderHandler.uniforms.push_back(info);
+        }
+    }
+
+    // build id lookup table
+    shaderHandler.uniformLocations.assign(_uniformNames.size(), -1);
+    for (const auto& info : shaderHandler.uniforms) {
+        shaderHandler.uniformLocations[info.id] = info.location;
+    }
+    MT_CORE_DEBUG("Renderer::ReflectUniforms: program {} has {} active uniforms", shaderHandler.program, shaderHandler.uniforms.size());
 }
-int Renderer::FindOrCreateShaderHandler(std::shared_ptr<Shader> shader) {
-    for (int i = 0; i < _shaderHandlers.size(); i++) {
-        if (_shaderHandlers[i].shader == shader) {
-            return i;
+
+void Renderer::ReflectMaterialBlock(ShaderHandler& shaderHandler) {
+    GLuint program = shaderHandler.program;
+    shaderHandler.materialBlock = UniformBlockLayout();
+    GLuint blockIndex = glGetUniformBlockIndex(program, s_materialBlockName.c_str());
+    if (blockIndex == GL_INVALID_INDEX)
+        return;
+    glUniformBlockBinding(program, blockIndex, s_materialBinding);
+
+    GLint size = 0;
+    GLint memberCount = 0;
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+    std::vector<GLint> indices(memberCount, 0);
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+    std::vector<GLuint> uindices(indices.begin(), indices.end());
+    std::vector<GLint> offsets(memberCount), matrixStrides(memberCount), types(memberCount);
+    glGetActiveUniformsiv(program, memberCount, uindices.data(), GL_UNIFORM_OFFSET, offsets.data());
+    glGetActiveUniformsiv(program, memberCount, uindices.data(), GL_UNIFORM_MATRIX_STRIDE, matrixStrides.data());
+    glGetActiveUniformsiv(program, memberCount, uindices.data(), GL_UNIFORM_TYPE, types.data());
+
+    UniformBlockLayout& layout = shaderHandler.materialBlock;
+    layout.name = s_materialBlockName;
+    layout.size = size;
+    GLchar nameBuffer[256];
+    for (GLint i = 0; i < memberCount; i++) {
+        GLsizei nameLength = 0;
+        glGetActiveUniformName(program, uindices[i], sizeof(nameBuffer), &nameLength, nameBuffer);
+        std::string name(nameBuffer, nameLength);
+        // arrays are reported as "name[0]", only the first element is packed
+        size_t bracket = name.find('[');
+        if (bracket != std::string::npos)
+            name = name.substr(0, bracket);
+
+        UniformBlockMember member = {
+            .name = name,
+            .offset = (size_t)offsets[i],
+            .matrixStride = (size_t)matrixStrides[i]
+        };
+        switch (types[i]) {
+            case GL_FLOAT:          break;
+            case GL_FLOAT_VEC2:     member.rows = 2; break;
+            case GL_FLOAT_VEC3:     member.rows = 3; break;
+            case GL_FLOAT_VEC4:     member.rows = 4; break;
+            case GL_FLOAT_MAT2:     member.rows = 2; member.columns = 2; break;
+            case GL_FLOAT_MAT3:     member.rows = 3; member.columns = 3; break;
+            case GL_FLOAT_MAT4:     member.rows = 4; member.columns = 4; break;
+            case GL_INT:
+            case GL_UNSIGNED_INT:
+            case GL_BOOL:           member.isInteger = true; break;
+            default:
+                MT_CORE_WARN("Renderer::ReflectMaterialBlock: unsupported type of block member \"{}\"", name);
+                continue;
         }
+        layout.members.push_back(member);
     }
-    return CreateShaderHandler(shader);
+    // members are reported in any order, sorted so equal layouts hash equal
+    std::sort(layout.members.begin(), layout.members.end(),
+        [](const UniformBlockMember& a, const UniformBlockMember& b) { return a.offset < b.offset; });
+    shaderHandler.materialBlockHash = layout.Hash();
+    MT_CORE_DEBUG("Renderer::ReflectMaterialBlock: program {} material block is {} bytes with {} members", program, layout.size, layout.members.size());
 }
 
 // bound objects
+std::shared_ptr<Canvas> Renderer::GetCanvas() {
+    return _canvas;
+}
+/// NOTE: shaders with the same sources share a program, so any of them may be returned
 std::shared_ptr<renderer::Shader> Renderer::GetShader() {
-    if (_shaderHandler == nullptr)
+    ShaderHandler* shaderHandler = GetBoundShaderHandler();
+    if (shaderHandler != nullptr && shaderHandler->base.IsValid())
+        shaderHandler = _shaderHandlers.Get(shaderHandler->base);
+    if (shaderHandler == nullptr)
         return nullptr;
-    return _shaderHandler->shader;
+    for (const auto& user : shaderHandler->users) {
+        if (std::shared_ptr<Shader> shader = user.shader.lock())
+            return shader;
+    }
+    return nullptr;
 }
 /// TODO:
 // set nullptr as shader should mean use a default not just shit the bed 
 void Renderer::SetShader(std::shared_ptr<renderer::Shader> shader) {
     if (shader == nullptr) {
         MT_CORE_WARN("Renderer::SetShader(): setting shader null, won't be able to draw");
-        _shaderHandler = nullptr;
-        glUseProgram(0);
+        _shaderHandle = Handle();
+        _glState.UseProgram(0);
         return;
     }
 
-    // skip if same
-    if (_shaderHandler != nullptr && _shaderHandler->shader == shader) {
+    // skip if same, including shaders sharing the bound program
+    Handle handle = FindOrCreateShaderVariant(shader, s_allAttributesMask, true);
+    if (handle == _shaderHandle) {
         MT_CORE_TRACE("Renderer::SetShader(): setting shader to already bound shader");
         return;
     }
 
+    // binding is explicit so the program is needed now, finish compiling even if it blocks
+    ShaderHandler* shaderHandler = _shaderHandlers.Get(handle);
+    FinishShaderCompile(*shaderHandler);
+
     // check shader is valid
     std::string err = "";
     if (!ValidateShader(shader, err)) {
         MT_CORE_TRACE("Renderer::SetShader: can't bind shader to invalid shader");
         return;
     }
-    // set and bind new shader
-    int shaderHandlerIdx = FindOrCreateShaderHandler(shader);
-    _shaderHandler = &_shaderHandlers.at(shaderHandlerIdx);
-    glUseProgram(_shaderHandler->program);
+    // set and bind new shader, validation may have moved the slots
+    _shaderHandle = handle;
+    _glState.UseProgram(_shaderHandlers.Get(_shaderHandle)->program);
 }
-
-/// --- Shader Methods ---
-bool Renderer::HasUniform(const std::string& key) {
-    if (std::find(s_reservedUniforms.begin(), s_reservedUniforms.end(), key) != s_reservedUniforms.end()) {
-        MT_CORE_WARN("Renderer::HasUniform: uniform key is reserved");
+void Renderer::SetCanvas(std::shared_ptr<Canvas> canvas) {
+    if (canvas == _canvas)
+        return;
+    // queued draws belong to the previous target
+    Flush();
+    if (canvas == nullptr) {
+        _glState.BindFramebuffer(0);
+        _glState.Viewport(0, 0, _windowWidth, _windowHeight);
+    } else {
+        const RenderTarget* target = FindOrCreateCanvasTarget(canvas);
+        if (target == nullptr) {
+            MT_CORE_WARN("Renderer::SetCanvas: failed to create render target, canvas not bound");
+            return;
+        }
+        _glState.BindFramebuffer(target->framebuffer);
+        _glState.Viewport(0, 0, target->desc.width, target->desc.height);
+    }
+    _canvas = canvas;
+    // resolution global follows the viewport
+    _isFrameGlobalsDirty = true;
+}
+bool Renderer::BindCanvasTexture(std::shared_ptr<Canvas> canvas, int attachment, int unit) {
+    if (canvas == nullptr) {
+        MT_CORE_WARN("Renderer::BindCanvasTexture: canvas is null");
         return false;
     }
-
-    if (_shaderHandler == nullptr) {
-        MT_CORE_WARN("Renderer::HasUniform: no shader bound");
+    if (canvas == _canvas) {
+        MT_CORE_WARN("Renderer::BindCanvasTexture: can't sample the bound canvas");
         return false;
     }
-    std::string err;
-    if (!ValidateShader(_shaderHandler->shader, err)) {
-        MT_CORE_WARN("Renderer::HasUniform: bound shader is invalid");
+    if (attachment < 0 || attachment >= (int)canvas->GetColorFormats().size()) {
+        MT_CORE_WARN("Renderer::BindCanvasTexture: canvas has no colour attachment {}", attachment);
         return false;
     }
-    return glGetUniformLocation(_shaderHandler->program, key.c_str()) != -1;
+    const RenderTarget* target = FindOrCreateCanvasTarget(canvas);
+    if (target == nullptr)
+        return false;
+    // queued draws sample whatever was bound when they were issued
+    Flush();
+    GLint filter = canvas->GetFilter() == TexFilter::NEAREST ? GL_NEAREST : GL_LINEAR;
+    _glState.BindTexture(unit, GL_TEXTURE_2D, target->colorTextures[attachment]);
+    // pooled textures are shared between canvases so the filter is applied per bind
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    return true;
+}
+
+/// --- Shader Compilation ---
+/// NOTE: only reports variants already requested, by draws, SetShader or precompiling
+ShaderStatus Renderer::GetShaderStatus(std::shared_ptr<Shader> shader) {
+    if (shader == nullptr)
+        return ShaderStatus::INVALID;
+    ShaderHandler* shaderHandler = _shaderHandlers.Get(FindOrCreateShaderHandler(shader));
+    bool isCompiling = false;
+    bool isFailed = false;
+    for (const auto& [variantKey, variantHandle] : shaderHandler->variants) {
+        ShaderHandler* variantHandler = _shaderHandlers.Get(variantHandle);
+        if (variantHandler == nullptr)
+            continue;
+        if (variantHandler->status == ShaderStatus::COMPILING && _hasParallelCompile && IsShaderCompileDone(*variantHandler))
+            FinishShaderCompile(*variantHandler);
+        isCompiling |= variantHandler->status == ShaderStatus::COMPILING;
+        isFailed |= variantHandler->status == ShaderStatus::FAILED;
+    }
+    if (isFailed)
+        return ShaderStatus::FAILED;
+    if (isCompiling)
+        return ShaderStatus::COMPILING;
+    return shaderHandler->variants.empty() ? ShaderStatus::INVALID : ShaderStatus::READY;
+}
+ShaderStatus Renderer::GetMaterialStatus(std::shared_ptr<Material> material, std::shared_ptr<Mesh> mesh) {
+    if (material == nullptr || mesh == nullptr || material->GetShader() == nullptr)
+        return ShaderStatus::INVALID;
+    Handle handle = FindOrCreateShaderVariant(material->GetShader(), MakeVariantKey(*material, MakeAttributeMask(*mesh)), true);
+    ShaderHandler* shaderHandler = _shaderHandlers.Get(handle);
+    if (shaderHandler->status == ShaderStatus::COMPILING && _hasParallelCompile && IsShaderCompileDone(*shaderHandler))
+        FinishShaderCompile(*shaderHandler);
+    return shaderHandler->status;
+}
+/// NOTE: requests the variants draws of each mesh with its material will use, so their programs
+/// are compiled & stored in the program cache before the first draw
+int Renderer::PrecompileMaterials(const std::vector<PrecompileRequest>& requests) {
+    // submit all first so parallel compiles overlap
+    for (const PrecompileRequest& request : requests) {
+        if (request.material != nullptr && request.mesh != nullptr && request.material->GetShader() != nullptr)
+            FindOrCreateShaderVariant(request.material->GetShader(), MakeVariantKey(*request.material, MakeAttributeMask(*request.mesh)), true);
+    }
+    PollShaderCompiles(s_compileBudget);
+
+    int compiling = 0;
+    for (const PrecompileRequest& request : requests) {
+        if (GetMaterialStatus(request.material, request.mesh) == ShaderStatus::COMPILING)
+            compiling++;
+    }
+    return compiling;
+}
+bool Renderer::GetCompilePlaceholder() {
+    return _state.compilePlaceholder;
+}
+void Renderer::SetCompilePlaceholder(bool enabled) {
+    _state.compilePlaceholder = enabled;
+}
+
+/// --- Shader Methods ---
+bool Renderer::IsReservedUniform(UniformId id) const {
+    return id >= 0 && id < s_reservedUniforms.size();
+}
+
+GLint Renderer::GetUniformLocation(UniformId id) {
+    if (IsReservedUniform(id)) {
+        MT_CORE_WARN("Renderer::GetUniformLocation: uniform key is reserved");
+        return -1;
+    }
+    ShaderHandler* shaderHandler = GetBoundShaderHandler();
+    if (shaderHandler == nullptr) {
+        MT_CORE_WARN("Renderer::GetUniformLocation: no shader bound");
+        return -1;
+    }
+    if (!shaderHandler->isValid) {
+        MT_CORE_WARN("Renderer::GetUniformLocation: bound shader is invalid");
+        return -1;
+    }
+    if (id < 0 || id >= shaderHandler->uniformLocations.size())
+        return -1;
+    return shaderHandler->uniformLocations[id];
+}
+
+bool Renderer::HasUniform(const std::string& key) {
+    return HasUniform(FindUniformId(key));
+}
+bool Renderer::HasUniform(UniformId id) {
+    return GetUniformLocation(id) != -1;
 }
 
 /// TODO: implement SetUniforms
@@ -690,149 +1924,430 @@ bool Renderer::HasUniform(const std::string& key) {
 /// change implementation to store uniforms with shader that are uploaded to gpu at draw time
 // single value uniforms
 bool Renderer::SetUniform(const std::string& key, int value) {
-    if (!HasUniform(key))
+    return SetUniform(FindUniformId(key), value);
+}
+bool Renderer::SetUniform(const std::string& key, uint32_t value) {
+    return SetUniform(FindUniformId(key), value);
+}
+bool Renderer::SetUniform(const std::string& key, float value) {
+    return SetUniform(FindUniformId(key), value);
+}
+bool Renderer::SetUniform(const std::string& key, double value) {
+    return SetUniform(FindUniformId(key), value);
+}
+// vector uniforms
+bool Renderer::SetUniform(const std::string& key, const LA::vec2& v) {
+    return SetUniform(FindUniformId(key), v);
+}
+bool Renderer::SetUniform(const std::string& key, float x, float y) {
+    GLint loc = GetUniformLocation(FindUniformId(key));
+    if (loc == -1)
         return false;
-    glUniform1i(glGetUniformLocation(_shaderHandler->program, key.c_str()), value);
+    glUniform2f(loc, x, y);
+    _stats.uniformUploads++;
     return true;
 }
-bool Renderer::SetUniform(const std::string& key, uint32_t value) {
-    if (!HasUniform(key))
+bool Renderer::SetUniform(const std::string& key, const LA::vec3& v) {
+    return SetUniform(FindUniformId(key), v);
+}
+bool Renderer::SetUniform(const std::string& key, float x, float y, float z) {
+    GLint loc = GetUniformLocation(FindUniformId(key));
+    if (loc == -1)
         return false;
-    glUniform1ui(glGetUniformLocation(_shaderHandler->program, key.c_str()), value);
+    glUniform3f(loc, x, y, z);
+    _stats.uniformUploads++;
     return true;
 }
-bool Renderer::SetUniform(const std::string& key, float value) {
-    if (!HasUniform(key))
+bool Renderer::SetUniform(const std::string& key, const LA::vec4& v) {
+    return SetUniform(FindUniformId(key), v);
+}
+bool Renderer::SetUniform(const std::string& key, float x, float y, float z, float w) {
+    GLint loc = GetUniformLocation(FindUniformId(key));
+    if (loc == -1)
         return false;
-    glUniform1f(glGetUniformLocation(_shaderHandler->program, key.c_str()), value);
+    glUniform4f(loc, x, y, z, w);
+    _stats.uniformUploads++;
     return true;
 }
-bool Renderer::SetUniform(const std::string& key, double value) {
-    if (!HasUniform(key))
+// matrix uniforms
+bool Renderer::SetUniform(const std::string& key, const LA::mat2& m) {
+    return SetUniform(FindUniformId(key), m);
+}
+bool Renderer::SetUniform(const std::string& key, const LA::mat3& m) {
+    return SetUniform(FindUniformId(key), m);
+}
+bool Renderer::SetUniform(const std::string& key, const LA::mat4& m) {
+    return SetUniform(FindUniformId(key), m);
+}
+// uniform property
+bool Renderer::SetUniform(const std::string& key, const UniformProperty& value) {
+    return SetUniform(FindUniformId(key), value);
+}
+
+// id uniforms
+bool Renderer::SetUniform(UniformId id, int value) {
+    GLint loc = GetUniformLocation(id);
+    if (loc == -1)
         return false;
-    glUniform1d(glGetUniformLocation(_shaderHandler->program, key.c_str()), value);
+    glUniform1i(loc, value);
+    _stats.uniformUploads++;
     return true;
 }
-// vector uniforms
-bool Renderer::SetUniform(const std::string& key, const LA::vec2& v) {
-    if (!HasUniform(key))
+bool Renderer::SetUniform(UniformId id, uint32_t value) {
+    GLint loc = GetUniformLocation(id);
+    if (loc == -1)
         return false;
-    glUniform2f(glGetUniformLocation(_shaderHandler->program, key.c_str()), v.x, v.y);
+    glUniform1ui(loc, value);
+    _stats.uniformUploads++;
     return true;
 }
-bool Renderer::SetUniform(const std::string& key, float x, float y) {
-    if (!HasUniform(key))
+bool Renderer::SetUniform(UniformId id, float value) {
+    GLint loc = GetUniformLocation(id);
+    if (loc == -1)
         return false;
-    glUniform2f(glGetUniformLocation(_shaderHandler->program, key.c_str()), x, y);
+    glUniform1f(loc, value);
+    _stats.uniformUploads++;
     return true;
 }
-bool Renderer::SetUniform(const std::string& key, const LA::vec3& v) {
-    if (!HasUniform(key))
+bool Renderer::SetUniform(UniformId id, double value) {
+    GLint loc = GetUniformLocation(id);
+    if (loc == -1)
         return false;
-    glUniform3f(glGetUniformLocation(_shaderHandler->program, key.c_str()), v.x, v.y, v.z);
+    glUniform1d(loc, value);
+    _stats.uniformUploads++;
     return true;
 }
-bool Renderer::SetUniform(const std::string& key, float x, float y, float z) {
-    if (!HasUniform(key))
+bool Renderer::SetUniform(UniformId id, const LA::vec2& v) {
+    GLint loc = GetUniformLocation(id);
+    if (loc == -1)
         return false;
-    glUniform3f(glGetUniformLocation(_shaderHandler->program, key.c_str()), x, y, z);
+    glUniform2f(loc, v.x, v.y);
+    _stats.uniformUploads++;
     return true;
 }
-bool Renderer::SetUniform(const std::string& key, const LA::vec4& v) {
-    if (!HasUniform(key))
+bool Renderer::SetUniform(UniformId id, const LA::vec3& v) {
+    GLint loc = GetUniformLocation(id);
+    if (loc == -1)
         return false;
-    glUniform4f(glGetUniformLocation(_shaderHandler->program, key.c_str()), v.x, v.y, v.z, v.w);
+    glUniform3f(loc, v.x, v.y, v.z);
+    _stats.uniformUploads++;
     return true;
 }
-bool Renderer::SetUniform(const std::string& key, float x, float y, float z, float w) {
-    if (!HasUniform(key))
+bool Renderer::SetUniform(UniformId id, const LA::vec4& v) {
+    GLint loc = GetUniformLocation(id);
+    if (loc == -1)
         return false;
-    glUniform4f(glGetUniformLocation(_shaderHandler->program, key.c_str()), x, y, z, w);
+    glUniform4f(loc, v.x, v.y, v.z, v.w);
+    _stats.uniformUploads++;
     return true;
 }
-// matrix uniforms
-bool Renderer::SetUniform(const std::string& key, const LA::mat2& m) {
-    if (!HasUniform(key))
+bool Renderer::SetUniform(UniformId id, const LA::mat2& m) {
+    GLint loc = GetUniformLocation(id);
+    if (loc == -1)
         return false;
-    glUniformMatrix2fv(glGetUniformLocation(_shaderHandler->program, key.c_str()), 1, GL_FALSE, &m[0][0]);
+    glUniformMatrix2fv(loc, 1, GL_FALSE, &m[0][0]);
+    _stats.uniformUploads++;
     return true;
 }
-bool Renderer::SetUniform(const std::string& key, const LA::mat3& m) {
-    if (!HasUniform(key))
+bool Renderer::SetUniform(UniformId id, const LA::mat3& m) {
+    GLint loc = GetUniformLocation(id);
+    if (loc == -1)
         return false;
-    glUniformMatrix3fv(glGetUniformLocation(_shaderHandler->program, key.c_str()), 1, GL_FALSE, &m[0][0]);
+    glUniformMatrix3fv(loc, 1, GL_FALSE, &m[0][0]);
+    _stats.uniformUploads++;
     return true;
 }
-bool Renderer::SetUniform(const std::string& key, const LA::mat4& m) {
-    if (!HasUniform(key))
+bool Renderer::SetUniform(UniformId id, const LA::mat4& m) {
+    GLint loc = GetUniformLocation(id);
+    if (loc == -1)
         return false;
-    glUniformMatrix4fv(glGetUniformLocation(_shaderHandler->program, key.c_str()), 1, GL_FALSE, &m[0][0]);
+    glUniformMatrix4fv(loc, 1, GL_FALSE, &m[0][0]);
+    _stats.uniformUploads++;
     return true;
 }
+bool Renderer::SetUniform(UniformId id, const UniformProperty& value) {
+    return std::visit([this, id](const auto& v) { return SetUniform(id, v); }, value);
+}
 
-bool Renderer::SetUniform(const std::string& key, const UniformProperty& value) {
-    if (std::holds_alternative<int>(value)) {
-        return SetUniform(key, std::get<int>(value));
-    } else if (std::holds_alternative<uint32_t>(value)) {
-        return SetUniform(key, std::get<uint32_t>(value));
-    } else if (std::holds_alternative<float>(value)) {
-        return SetUniform(key, std::get<float>(value));
-    } else if (std::holds_alternative<double>(value)) {
-        return SetUniform(key, std::get<double>(value));
-    } else if (std::holds_alternative<LA::vec2>(value)) {
-        return SetUniform(key, std::get<LA::vec2>(value));
-    } else if (std::holds_alternative<LA::vec3>(value)) {
-        return SetUniform(key, std::get<LA::vec3>(value));
-    } else if (std::holds_alternative<LA::vec4>(value)) {
-        return SetUniform(key, std::get<LA::vec4>(value));
-    } else if (std::holds_alternative<LA::mat2>(value)) {
-        return SetUniform(key, std::get<LA::mat2>(value));
-    } else if (std::holds_alternative<LA::mat3>(value)) {
-        return SetUniform(key, std::get<LA::mat3>(value));
-    } else if (std::holds_alternative<LA::mat4>(value)) {
-        return SetUniform(key, std::get<LA::mat4>(value));
-    }
-    return false;
+// write globals into this frame's uniform stream and bind at the fixed binding point
+void Renderer::UploadFrameGlobals() {
+    FrameGlobals globals = FrameGlobals();
+    LA::mat4 view = GetView();
+    LA::mat4 projection = GetProjection();
+    std::memcpy(globals.view, &view[0][0], sizeof(globals.view));
+    std::memcpy(globals.projection, &projection[0][0], sizeof(globals.projection));
+    std::array<GLint, 4> viewport = _glState.GetViewport();
+    globals.resolution[0] = viewport[2];
+    globals.resolution[1] = viewport[3];
+    globals.time = _hasFrameTime ? _frameTime : time::Time::Instance().GetTime();
+    globals.timeDelta = _hasFrameTime ? _frameDeltaTime : time::Time::Instance().GetDeltaTime();
+    globals.frameIndex = _stats.frameIndex;
+
+    size_t offset = _uniformStream->Write(&globals, sizeof(globals), _uniformAlignment);
+    _glState.BindBufferRange(GL_UNIFORM_BUFFER, s_frameGlobalsBinding, _uniformStream->GetBuffer(), offset, sizeof(globals));
+    _isFrameGlobalsDirty = false;
+    _stats.uniformUploads++;
+    _stats.bytesUploaded += sizeof(globals);
 }
 
-bool Renderer::SetDefaultUniforms() {
-    if (_shaderHandler == nullptr) {
-        MT_CORE_WARN("Renderer::HasUniform: no shader bound");
+bool Renderer::SetModelUniform(const LA::mat4& model) {
+    ShaderHandler* shaderHandler = GetBoundShaderHandler();
+    if (shaderHandler == nullptr || _modelUniformId >= shaderHandler->uniformLocations.size())
         return false;
-    }
-    std::string err;
-    if (!ValidateShader(_shaderHandler->shader, err)) {
-        MT_CORE_WARN("Renderer::HasUniform: bound shader is invalid");
-        return false;
-    }
-
-    // set default uniforms
-    glUniform1f(glGetUniformLocation(_shaderHandler->program, "u_time"), time::Time::Instance().GetTime());
-    glUniform1f(glGetUniformLocation(_shaderHandler->program, "u_time_delta"), time::Time::Instance().GetDeltaTime());
-    glUniform1i(glGetUniformLocation(_shaderHandler->program, "u_frame_index"), _stats.frameIndex);
-    glUniformMatrix4fv(glGetUniformLocation(_shaderHandler->program, "u_model"), 1, GL_FALSE, &GetModel()[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(_shaderHandler->program, "u_view"), 1, GL_FALSE, &GetView()[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(_shaderHandler->program, "u_projection"), 1, GL_FALSE, &GetProjection()[0][0]);
-    /// TODO: set resolution from viewport
-    glUniform2f(glGetUniformLocation(_shaderHandler->program, "u_resolution"), 0.0f, 0.0f);
+    glUniformMatrix4fv(shaderHandler->uniformLocations[_modelUniformId], 1, GL_FALSE, &model[0][0]);
+    _stats.uniformUploads++;
     return true;
 }
 
-/// TODO: add validation
+/// NOTE: continues past failures so one bad property doesn't leave the rest unset
 bool Renderer::SetMaterialUniforms(std::shared_ptr<Material> material) {
-    if (_shaderHandler == nullptr) {
+    ShaderHandler* shaderHandler = GetBoundShaderHandler();
+    if (shaderHandler == nullptr) {
         MT_CORE_WARN("Renderer::SetMaterialUniforms: no shader bound");
         return false;
     }
-    // iterate through uniform map
+    bool isValid = true;
+    const UniformBlockLayout& block = shaderHandler->materialBlock;
+    if (block.size > 0)
+        isValid = BindMaterialBuffer(material, *shaderHandler);
+
+    // properties outside the block are set as plain uniforms
     const std::unordered_map<std::string, UniformProperty>& uniforms = material->GetUniforms();
     for (auto it = uniforms.begin(); it != uniforms.end(); ++it) {
+        if (block.size > 0 && block.FindMember(it->first) != nullptr)
+            continue;
         if (!SetUniform(it->first, it->second)) {
             MT_CORE_WARN("Renderer::SetMaterialUniforms: failed to set uniform \"{}\"", it->first);
-            return false;
+            isValid = false;
         }
     }
-    return true;
+    return isValid;
+}
+
+bool Renderer::BindMaterialBuffer(std::shared_ptr<Material> material, const ShaderHandler& shaderHandler) {
+    const UniformBlockLayout& block = shaderHandler.materialBlock;
+    int64_t uuid = material->GetUUID();
+    uint64_t key = HashBytes(&shaderHandler.materialBlockHash, sizeof(uint64_t), HashBytes(&uuid, sizeof(uuid)));
+    MaterialBuffer& materialBuffer = _materialBuffers[key];
+    bool isValid = true;
+    // switching between programs with the same layout keeps the buffer
+    bool isStale = materialBuffer.material.lock() != material
+        || materialBuffer.layoutHash != shaderHandler.materialBlockHash
+        || materialBuffer.version != material->GetVersion();
+    if (isStale) {
+        std::vector<uint8_t> data;
+        isValid = material->PackUniformBlock(block, data);
+        if (materialBuffer.buffer == 0)
+            glGenBuffers(1, &materialBuffer.buffer);
+        _glState.BindBuffer(GL_UNIFORM_BUFFER, materialBuffer.buffer);
+        if (materialBuffer.size != block.size) {
+            glBufferData(GL_UNIFORM_BUFFER, data.size(), data.data(), GL_DYNAMIC_DRAW);
+        } else {
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, data.size(), data.data());
+        }
+        materialBuffer.material = material;
+        materialBuffer.layoutHash = shaderHandler.materialBlockHash;
+        materialBuffer.version = material->GetVersion();
+        materialBuffer.size = block.size;
+        _stats.uniformUploads++;
+        _stats.bytesUploaded += data.size();
+    }
+    _glState.BindBufferRange(GL_UNIFORM_BUFFER, s_materialBinding, materialBuffer.buffer, 0, materialBuffer.size);
+    return isValid;
+}
+
+
+/// --- Debug Info ---
+RenderStats Renderer::GetRenderStats() {
+    _stats.stateCallsSkipped = _glState.GetCallsSkipped();
+    _stats.programBinds = _glState.GetProgramBinds();
+    _stats.vertexArrayBinds = _glState.GetVertexArrayBinds();
+    _stats.textureBinds = _glState.GetTextureBinds();
+    return _stats;
+}
+
+void Renderer::SetFrameTime(double time, double deltaTime) {
+    renderer::Renderer::SetFrameTime(time, deltaTime);
+    _isFrameGlobalsDirty = true;
+}
+
+void Renderer::NextFrame() {
+    renderer::Renderer::NextFrame();
+    _glState.ResetCounters();
+    _gpuProfiler.NextFrame(_stats.frameIndex);
+    PollShaderCompiles(s_compileBudget);
+    CollectHandlers();
+    // transient canvas storage is free for any canvas next frame, freed canvases give theirs back
+    ReleaseCanvasTargets(true);
+    _renderTargetPool.Trim(_stats.frameIndex);
+    UpdateWindowSize();
+    // occluders are submitted per frame
+    _occlusionCuller.ClearOccluders();
+    _isOcclusionDirty = true;
+    if (_instanceStream != nullptr)
+        _instanceStream->NextFrame();
+    if (_uploadStream != nullptr)
+        _uploadStream->NextFrame();
+    if (_uniformStream != nullptr)
+        _uniformStream->NextFrame();
+    if (_indirectStream != nullptr)
+        _indirectStream->NextFrame();
+    // time & frame index changed, uploaded lazily by the first flush of the frame
+    _isFrameGlobalsDirty = true;
+}
+
+/// --- Profiling ---
+void Renderer::BeginGpuZone(const std::string& name) {
+    // draws queued before the zone belong to the enclosing one
+    Flush();
+    _gpuProfiler.BeginZone(name);
+}
+void Renderer::EndGpuZone() {
+    Flush();
+    _gpuProfiler.EndZone();
+}
+std::vector<std::string> Renderer::GetGpuZoneNames() {
+    return _gpuProfiler.GetZoneNames();
+}
+std::vector<GpuZoneSample> Renderer::GetGpuZoneHistory(const std::string& name) {
+    return _gpuProfiler.GetHistory(name);
+}
+bool Renderer::ExportGpuZones(const std::filesystem::path& path) {
+    return _gpuProfiler.Export(path);
+}
+
+// mesh handlers hold a shared_ptr to their resource, so a use count of 1 means only the renderer references it
+// shader handlers are shared so hold weak references to each shader using them
+void Renderer::CollectHandlers() {
+    std::vector<Handle> unused;
+    _meshHandlers.ForEach([&unused](Handle handle, MeshHandler& meshHandler) {
+        if (meshHandler.mesh.use_count() == 1)
+            unused.push_back(handle);
+    });
+    for (Handle handle : unused) {
+        MeshHandler* meshHandler = _meshHandlers.Get(handle);
+        auto it = _meshLookup.find(meshHandler->mesh->GetUUID());
+        if (it != _meshLookup.end() && it->second == handle)
+            _meshLookup.erase(it);
+        DestroyMeshHandler(*meshHandler);
+        _meshHandlers.Remove(handle);
+    }
+
+    unused.clear();
+    // a bound variant keeps its base alive
+    const ShaderHandler* boundHandler = GetBoundShaderHandler();
+    Handle boundBase = boundHandler != nullptr && boundHandler->base.IsValid() ? boundHandler->base : _shaderHandle;
+    _shaderHandlers.ForEach([this, &unused, boundBase](Handle handle, ShaderHandler& shaderHandler) {
+        // variants are collected with their base
+        if (shaderHandler.base.IsValid())
+            return;
+        std::vector<ShaderUser>& users = shaderHandler.users;
+        for (auto it = users.begin(); it != users.end();) {
+            if (!it->shader.expired()) {
+                ++it;
+                continue;
+            }
+            auto lookup = _shaderLookup.find(it->uuid);
+            if (lookup != _shaderLookup.end() && lookup->second == handle)
+                _shaderLookup.erase(lookup);
+            it = users.erase(it);
+        }
+        if (users.empty() && handle != boundBase)
+            unused.push_back(handle);
+    });
+    // variants no longer drawn with, e.g. after a material's feature mask changed, unless bound or pinned
+    _shaderHandlers.ForEach([this](Handle handle, ShaderHandler& shaderHandler) {
+        for (auto it = shaderHandler.variants.begin(); it != shaderHandler.variants.end();) {
+            ShaderHandler* variantHandler = _shaderHandlers.Get(it->second);
+            if (variantHandler == nullptr) {
+                it = shaderHandler.variants.erase(it);
+                continue;
+            }
+            if (_stats.frameIndex - variantHandler->usedFrame <= s_variantLifetime
+                || it->second == _shaderHandle || variantHandler->isPinned) {
+                ++it;
+                continue;
+            }
+            DestroyShaderHandler(*variantHandler);
+            _shaderHandlers.Remove(it->second);
+            it = shaderHandler.variants.erase(it);
+        }
+    });
+    for (Handle handle : unused) {
+        ShaderHandler* shaderHandler = _shaderHandlers.Get(handle);
+        for (const auto& [variantKey, variantHandle] : shaderHandler->variants) {
+            DestroyShaderHandler(*_shaderHandlers.Get(variantHandle));
+            _shaderHandlers.Remove(variantHandle);
+        }
+        auto it = _programLookup.find(shaderHandler->sourceKey);
+        if (it != _programLookup.end() && it->second == handle)
+            _programLookup.erase(it);
+        DestroyShaderHandler(*shaderHandler);
+        _shaderHandlers.Remove(handle);
+    }
+
+    unused.clear();
+    // objects no longer drawn
+    _occlusionQueries.ForEach([this, &unused](Handle handle, OcclusionQueryHandler& query) {
+        if (_stats.frameIndex - query.usedFrame > s_occlusionQueryLifetime)
+            unused.push_back(handle);
+    });
+    for (Handle handle : unused) {
+        OcclusionQueryHandler* query = _occlusionQueries.Get(handle);
+        _occlusionLookup.erase(query->key);
+        glDeleteQueries(1, &query->query);
+        _occlusionQueries.Remove(handle);
+    }
+
+    for (auto it = _materialBuffers.begin(); it != _materialBuffers.end();) {
+        if (it->second.material.expired()) {
+            _glState.OnDeleteBuffer(it->second.buffer);
+            glDeleteBuffers(1, &it->second.buffer);
+            it = _materialBuffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/// --- Canvas Stuff ---
+const RenderTarget* Renderer::FindOrCreateCanvasTarget(std::shared_ptr<Canvas> canvas) {
+    if (_windowWidth <= 0 || _windowHeight <= 0)
+        UpdateWindowSize();
+    RenderTargetDesc desc = RenderTargetDesc();
+    canvas->GetPixelSize(_windowWidth, _windowHeight, desc.width, desc.height);
+    desc.colorFormats = canvas->GetColorFormats();
+    desc.depthFormat = canvas->GetDepthFormat();
+
+    CanvasTarget& canvasTarget = _canvasTargets[canvas->GetUUID()];
+    canvasTarget.canvas = canvas;
+    const RenderTarget* target = _renderTargetPool.Get(canvasTarget.target);
+    if (target != nullptr && target->desc == desc)
+        return target;
+    // resized or formats changed, old storage goes back to the pool
+    _renderTargetPool.Release(canvasTarget.target, _stats.frameIndex);
+    size_t createdCount = _renderTargetPool.GetCreatedCount();
+    canvasTarget.target = _renderTargetPool.Acquire(desc);
+    _stats.handlersCreated += _renderTargetPool.GetCreatedCount() - createdCount;
+    return _renderTargetPool.Get(canvasTarget.target);
+}
+
+void Renderer::ReleaseCanvasTargets(bool transientOnly) {
+    for (auto it = _canvasTargets.begin(); it != _canvasTargets.end();) {
+        std::shared_ptr<Canvas> canvas = it->second.canvas.lock();
+        bool isReleased = canvas == nullptr || (!transientOnly || canvas->GetTransient());
+        if (!isReleased || (canvas != nullptr && canvas == _canvas)) {
+            ++it;
+            continue;
+        }
+        _renderTargetPool.Release(it->second.target, _stats.frameIndex);
+        it = _canvasTargets.erase(it);
+    }
+}
+
+/// TODO: use the drawable size, differs from the window size on high dpi displays
+void Renderer::UpdateWindowSize() {
+    window::Window::Instance().GetWindowSize(_windowWidth, _windowHeight);
 }
 
 
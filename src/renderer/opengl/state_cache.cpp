@@ -0,0 +1,333 @@
+#include "renderer/opengl/state_cache.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace opengl {
+
+StateCache::StateCache() {
+    Invalidate();
+}
+
+int StateCache::BufferTargetIndex(GLenum target) {
+    switch (target) {
+        case GL_ARRAY_BUFFER:           return 0;
+        case GL_ELEMENT_ARRAY_BUFFER:   return 1;
+        case GL_UNIFORM_BUFFER:         return 2;
+        case GL_COPY_READ_BUFFER:       return 3;
+        case GL_COPY_WRITE_BUFFER:      return 4;
+        case GL_DRAW_INDIRECT_BUFFER:   return 5;
+        case GL_PIXEL_UNPACK_BUFFER:    return 6;
+        case GL_PIXEL_PACK_BUFFER:      return 7;
+        default:                        return -1;
+    }
+}
+
+int StateCache::CapabilityIndex(GLenum cap) {
+    switch (cap) {
+        case GL_DEPTH_TEST:     return 0;
+        case GL_CULL_FACE:      return 1;
+        case GL_BLEND:          return 2;
+        case GL_SCISSOR_TEST:   return 3;
+        case GL_STENCIL_TEST:   return 4;
+        case GL_MULTISAMPLE:    return 5;
+        case GL_PROGRAM_POINT_SIZE: return 6;
+        case GL_RASTERIZER_DISCARD: return 7;
+        default:                return -1;
+    }
+}
+
+void StateCache::Invalidate() {
+    _program = s_unknownName;
+    _vertexArray = s_unknownName;
+    _framebuffer = s_unknownName;
+    _buffers.fill(s_unknownName);
+    _activeTexture = -1;
+    _textures.fill(s_unknownName);
+    _capabilities.fill(s_unknownBool);
+    _depthFunc = s_unknownEnum;
+    _depthMask = s_unknownBool;
+    _cullFace = s_unknownEnum;
+    _frontFace = s_unknownEnum;
+    _blendSrc = s_unknownEnum;
+    _blendDst = s_unknownEnum;
+    _polygonMode = s_unknownEnum;
+    _colorMask.fill(s_unknownBool);
+    _clearColor.fill(-1.0f);
+    _viewport.fill(-1);
+    _lineWidth = -1.0f;
+    _pointSize = -1.0f;
+}
+
+/// --- Bound Objects ---
+void StateCache::UseProgram(GLuint program) {
+    if (_program == program) {
+        _callsSkipped++;
+        return;
+    }
+    _program = program;
+    _programBinds++;
+    glUseProgram(program);
+}
+
+void StateCache::BindVertexArray(GLuint vao) {
+    if (_vertexArray == vao) {
+        _callsSkipped++;
+        return;
+    }
+    _vertexArray = vao;
+    _vertexArrayBinds++;
+    glBindVertexArray(vao);
+    // element array binding is vao state
+    _buffers[BufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = s_unknownName;
+}
+
+void StateCache::BindBuffer(GLenum target, GLuint buffer) {
+    int idx = BufferTargetIndex(target);
+    if (idx != -1) {
+        if (_buffers[idx] == buffer) {
+            _callsSkipped++;
+            return;
+        }
+        _buffers[idx] = buffer;
+    }
+    glBindBuffer(target, buffer);
+}
+
+void StateCache::BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    int idx = BufferTargetIndex(target);
+    if (idx != -1)
+        _buffers[idx] = buffer;
+    glBindBufferBase(target, index, buffer);
+}
+
+void StateCache::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    int idx = BufferTargetIndex(target);
+    if (idx != -1)
+        _buffers[idx] = buffer;
+    glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void StateCache::BindTexture(int unit, GLenum target, GLuint texture) {
+    /// NOTE: only tracks the last target bound per unit, binding different targets to the same unit
+    /// will cause redundant binds but never missed ones
+    if (unit >= 0 && unit < s_maxTextureUnits && _textures[unit] == texture) {
+        _callsSkipped++;
+        return;
+    }
+    if (_activeTexture != unit) {
+        _activeTexture = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    if (unit >= 0 && unit < s_maxTextureUnits)
+        _textures[unit] = texture;
+    _textureBinds++;
+    glBindTexture(target, texture);
+}
+
+void StateCache::BindFramebuffer(GLuint framebuffer) {
+    if (_framebuffer == framebuffer) {
+        _callsSkipped++;
+        return;
+    }
+    _framebuffer = framebuffer;
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+GLuint StateCache::GetProgram() const {
+    return _program;
+}
+
+GLuint StateCache::GetVertexArray() const {
+    return _vertexArray;
+}
+
+GLuint StateCache::GetFramebuffer() {
+    if (_framebuffer == s_unknownName) {
+        GLint framebuffer = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+        _framebuffer = (GLuint)framebuffer;
+    }
+    return _framebuffer;
+}
+
+void StateCache::OnDeleteProgram(GLuint program) {
+    /// NOTE: a deleted program stays in use until another is bound so the binding remains valid
+    (void)program;
+}
+
+void StateCache::OnDeleteVertexArray(GLuint vao) {
+    if (_vertexArray == vao)
+        _vertexArray = 0;
+}
+
+void StateCache::OnDeleteBuffer(GLuint buffer) {
+    for (auto& bound : _buffers) {
+        if (bound == buffer)
+            bound = 0;
+    }
+}
+
+void StateCache::OnDeleteTexture(GLuint texture) {
+    for (auto& bound : _textures) {
+        if (bound == texture)
+            bound = 0;
+    }
+}
+
+void StateCache::OnDeleteFramebuffer(GLuint framebuffer) {
+    // reverts to the default framebuffer
+    if (_framebuffer == framebuffer)
+        _framebuffer = 0;
+}
+
+/// --- Fixed Function State ---
+void StateCache::SetCapability(GLenum cap, bool enabled) {
+    int idx = CapabilityIndex(cap);
+    if (idx != -1) {
+        if (_capabilities[idx] == (int)enabled) {
+            _callsSkipped++;
+            return;
+        }
+        _capabilities[idx] = enabled;
+    }
+    if (enabled) glEnable(cap);
+    else glDisable(cap);
+}
+
+void StateCache::DepthFunc(GLenum func) {
+    if (_depthFunc == func) {
+        _callsSkipped++;
+        return;
+    }
+    _depthFunc = func;
+    glDepthFunc(func);
+}
+
+void StateCache::DepthMask(bool enabled) {
+    if (_depthMask == (int)enabled) {
+        _callsSkipped++;
+        return;
+    }
+    _depthMask = enabled;
+    glDepthMask(enabled);
+}
+
+void StateCache::CullFace(GLenum face) {
+    if (_cullFace == face) {
+        _callsSkipped++;
+        return;
+    }
+    _cullFace = face;
+    glCullFace(face);
+}
+
+void StateCache::FrontFace(GLenum winding) {
+    if (_frontFace == winding) {
+        _callsSkipped++;
+        return;
+    }
+    _frontFace = winding;
+    glFrontFace(winding);
+}
+
+void StateCache::BlendFunc(GLenum src, GLenum dst) {
+    if (_blendSrc == src && _blendDst == dst) {
+        _callsSkipped++;
+        return;
+    }
+    _blendSrc = src;
+    _blendDst = dst;
+    glBlendFunc(src, dst);
+}
+
+void StateCache::PolygonMode(GLenum mode) {
+    if (_polygonMode == mode) {
+        _callsSkipped++;
+        return;
+    }
+    _polygonMode = mode;
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void StateCache::ColorMask(bool r, bool g, bool b, bool a) {
+    if (_colorMask[0] == (int)r && _colorMask[1] == (int)g && _colorMask[2] == (int)b && _colorMask[3] == (int)a) {
+        _callsSkipped++;
+        return;
+    }
+    _colorMask = {r, g, b, a};
+    glColorMask(r, g, b, a);
+}
+
+void StateCache::ClearColor(float r, float g, float b, float a) {
+    if (_clearColor[0] == r && _clearColor[1] == g && _clearColor[2] == b && _clearColor[3] == a) {
+        _callsSkipped++;
+        return;
+    }
+    _clearColor = {r, g, b, a};
+    glClearColor(r, g, b, a);
+}
+
+void StateCache::Viewport(GLint x, GLint y, GLint width, GLint height) {
+    if (_viewport[0] == x && _viewport[1] == y && _viewport[2] == width && _viewport[3] == height) {
+        _callsSkipped++;
+        return;
+    }
+    _viewport = {x, y, width, height};
+    glViewport(x, y, width, height);
+}
+
+std::array<GLint, 4> StateCache::GetViewport() {
+    // context creation sets the viewport to the window size without going through the cache
+    if (_viewport[2] < 0)
+        glGetIntegerv(GL_VIEWPORT, _viewport.data());
+    return _viewport;
+}
+
+void StateCache::LineWidth(float width) {
+    if (_lineWidth == width) {
+        _callsSkipped++;
+        return;
+    }
+    _lineWidth = width;
+    glLineWidth(width);
+}
+
+void StateCache::PointSize(float size) {
+    if (_pointSize == size) {
+        _callsSkipped++;
+        return;
+    }
+    _pointSize = size;
+    glPointSize(size);
+}
+
+int StateCache::GetCallsSkipped() const {
+    return _callsSkipped;
+}
+
+int StateCache::GetProgramBinds() const {
+    return _programBinds;
+}
+
+int StateCache::GetVertexArrayBinds() const {
+    return _vertexArrayBinds;
+}
+
+int StateCache::GetTextureBinds() const {
+    return _textureBinds;
+}
+
+void StateCache::ResetCounters() {
+    _callsSkipped = 0;
+    _programBinds = 0;
+    _vertexArrayBinds = 0;
+    _textureBinds = 0;
+}
+
+} // opengl
+
+} // renderer
+
+} // marathon
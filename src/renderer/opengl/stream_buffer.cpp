@@ -0,0 +1,186 @@
+#include "renderer/opengl/stream_buffer.hpp"
+
+#include <cstring>
+
+#include "core/logger.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace opengl {
+
+StreamBuffer::StreamBuffer(StateCache& glState, GLenum target, size_t regionSize)
+    : _glState(glState),
+      _target(target) {
+    _isPersistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    if (!_isPersistent)
+        MT_CORE_WARN("StreamBuffer: buffer storage unsupported, falling back to orphaning");
+    Allocate(regionSize);
+}
+
+StreamBuffer::~StreamBuffer() {
+    Release();
+    for (RetiredBuffer& retired : _retired) {
+        if (retired.fence != nullptr)
+            glDeleteSync(retired.fence);
+        _glState.OnDeleteBuffer(retired.buffer);
+        glDeleteBuffers(1, &retired.buffer);
+    }
+}
+
+void StreamBuffer::Allocate(size_t regionSize) {
+    _regionSize = regionSize;
+    _region = 0;
+    _head = 0;
+    glGenBuffers(1, &_buffer);
+    _glState.BindBuffer(_target, _buffer);
+    if (_isPersistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(_target, _regionSize * s_regionCount, nullptr, flags);
+        _mapped = (uint8_t*)glMapBufferRange(_target, 0, _regionSize * s_regionCount, flags);
+        if (_mapped == nullptr) {
+            MT_CORE_ERROR("StreamBuffer::Allocate: failed to persistently map buffer");
+        }
+    } else {
+        glBufferData(_target, _regionSize, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+/// NOTE: deleting a buffer the gpu is still reading is safe, the driver defers the release
+void StreamBuffer::Release() {
+    for (GLsync& fence : _fences) {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    // deleting a mapped buffer implicitly unmaps it
+    _glState.OnDeleteBuffer(_buffer);
+    glDeleteBuffers(1, &_buffer);
+    _buffer = 0;
+    _mapped = nullptr;
+}
+
+void StreamBuffer::Retire() {
+    // region fences only guard reuse of this buffer's regions
+    for (GLsync& fence : _fences) {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    // persistent mapping stays valid until the buffer is deleted
+    _retired.push_back({ _buffer, nullptr });
+    _buffer = 0;
+    _mapped = nullptr;
+}
+
+void StreamBuffer::CollectRetired() {
+    for (auto it = _retired.begin(); it != _retired.end();) {
+        if (it->fence == nullptr) {
+            it->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            ++it;
+            continue;
+        }
+        GLenum result = glClientWaitSync(it->fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+            ++it;
+            continue;
+        }
+        glDeleteSync(it->fence);
+        _glState.OnDeleteBuffer(it->buffer);
+        glDeleteBuffers(1, &it->buffer);
+        it = _retired.erase(it);
+    }
+}
+
+void StreamBuffer::WaitForRegion(int region) {
+    GLsync& fence = _fences[region];
+    if (fence == nullptr)
+        return;
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, s_fenceTimeout);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        MT_CORE_DEBUG("StreamBuffer::WaitForRegion: cpu is a full ring ahead, stalling");
+        while (result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(fence, 0, s_fenceTimeout);
+    }
+    if (result == GL_WAIT_FAILED) {
+        MT_CORE_ERROR("StreamBuffer::WaitForRegion: fence wait failed");
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void* StreamBuffer::Map(size_t size, size_t alignment, size_t& offset) {
+    size_t start = (_head + alignment - 1) / alignment * alignment;
+    if (start + size > _regionSize) {
+        // region is full, replace buffer with a larger one
+        // data already written this frame stays in the old buffer, which is kept until the gpu is done
+        size_t regionSize = _regionSize * 2;
+        while (regionSize < size)
+            regionSize *= 2;
+        MT_CORE_DEBUG("StreamBuffer::Map: growing regions from {} to {} bytes", _regionSize, regionSize);
+        Retire();
+        Allocate(regionSize);
+        start = 0;
+    }
+    _head = start + size;
+
+    if (_isPersistent) {
+        offset = _region * _regionSize + start;
+        return _mapped + offset;
+    }
+    // unsynchronized is safe as ranges are never rewritten within a frame and the buffer is orphaned between frames
+    offset = start;
+    _glState.BindBuffer(_target, _buffer);
+    return glMapBufferRange(_target, offset, size,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
+void StreamBuffer::Unmap() {
+    // coherent persistent mappings need no flush
+    if (_isPersistent)
+        return;
+    _glState.BindBuffer(_target, _buffer);
+    glUnmapBuffer(_target);
+}
+
+size_t StreamBuffer::Write(const void* data, size_t size, size_t alignment) {
+    size_t offset = 0;
+    void* dst = Map(size, alignment, offset);
+    if (dst != nullptr)
+        std::memcpy(dst, data, size);
+    Unmap();
+    return offset;
+}
+
+void StreamBuffer::NextFrame() {
+    CollectRetired();
+    _head = 0;
+    if (!_isPersistent) {
+        // orphan, driver hands back fresh storage while the gpu finishes with the old
+        _glState.BindBuffer(_target, _buffer);
+        glBufferData(_target, _regionSize, nullptr, GL_STREAM_DRAW);
+        return;
+    }
+    _fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _region = (_region + 1) % s_regionCount;
+    WaitForRegion(_region);
+}
+
+GLuint StreamBuffer::GetBuffer() const {
+    return _buffer;
+}
+
+bool StreamBuffer::IsPersistent() const {
+    return _isPersistent;
+}
+
+size_t StreamBuffer::GetUsed() const {
+    return _head;
+}
+
+} // opengl
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,379 @@
+#include "renderer/render_graph.hpp"
+
+#include <algorithm>
+
+#include "core/logger.hpp"
+#include "renderer/renderer.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+namespace {
+
+bool HasDepth(TexPixelFormat format) {
+    return format == TexPixelFormat::DEPTH_24f_STENCIL_8u || format == TexPixelFormat::DEPTH_16f
+        || format == TexPixelFormat::DEPTH_24f || format == TexPixelFormat::DEPTH_32f;
+}
+
+bool HasStencil(TexPixelFormat format) {
+    return format == TexPixelFormat::DEPTH_24f_STENCIL_8u || format == TexPixelFormat::STENCIL_1u
+        || format == TexPixelFormat::STENCIL_2u || format == TexPixelFormat::STENCIL_8u;
+}
+
+} // namespace
+
+//// PassBuilder ----------------------------------------------------------------
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph& graph, int pass)
+    : _graph(graph),
+      _pass(pass) {}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(ResourceId resource, int attachment) {
+    _graph._passes[_pass].reads.push_back({ resource, attachment });
+    _graph._isCompiled = false;
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(ResourceId resource, LoadOp load) {
+    Pass& pass = _graph._passes[_pass];
+    if (pass.write != -1)
+        MT_CORE_WARN("RenderGraph::PassBuilder::Write: pass '{}' already writes a canvas, replacing it", pass.name);
+    pass.write = resource;
+    pass.load = load;
+    _graph._isCompiled = false;
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetSideEffects(bool hasSideEffects) {
+    _graph._passes[_pass].hasSideEffects = hasSideEffects;
+    _graph._isCompiled = false;
+    return *this;
+}
+
+
+//// RenderGraph ----------------------------------------------------------------
+
+RenderGraph::RenderGraph() {
+    Reset();
+}
+
+RenderGraph::ResourceId RenderGraph::CreateCanvas(const std::string& name, const RenderGraphCanvasDesc& desc) {
+    Resource resource = Resource();
+    resource.name = name;
+    resource.desc = desc;
+    _resources.push_back(resource);
+    _isCompiled = false;
+    return (ResourceId)_resources.size() - 1;
+}
+
+RenderGraph::ResourceId RenderGraph::ImportCanvas(const std::string& name, std::shared_ptr<Canvas> canvas) {
+    if (canvas == nullptr) {
+        MT_CORE_WARN("RenderGraph::ImportCanvas: canvas '{}' is null, using the window", name);
+        return WINDOW;
+    }
+    Resource resource = Resource();
+    resource.name = name;
+    resource.canvas = canvas;
+    resource.isImported = true;
+    _resources.push_back(resource);
+    _isCompiled = false;
+    return (ResourceId)_resources.size() - 1;
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const std::string& name, ExecuteFn execute) {
+    Pass pass = Pass();
+    pass.name = name;
+    pass.execute = execute;
+    _passes.push_back(pass);
+    _isCompiled = false;
+    return PassBuilder(*this, (int)_passes.size() - 1);
+}
+
+void RenderGraph::Reset() {
+    _resources.clear();
+    _passes.clear();
+    _steps.clear();
+    _culledPasses.clear();
+    Resource window = Resource();
+    window.name = "window";
+    window.isImported = true;
+    _resources.push_back(window);
+    _isCompiled = false;
+}
+
+/// NOTE: edges always point to earlier declared passes so the graph is acyclic by construction
+void RenderGraph::BuildEdges(std::vector<std::vector<int>>& dataEdges, std::vector<std::vector<int>>& orderEdges) const {
+    dataEdges.assign(_passes.size(), {});
+    orderEdges.assign(_passes.size(), {});
+    std::vector<int> lastWriter(_resources.size(), -1);
+    // readers of the current contents, must finish before the next write
+    std::vector<std::vector<int>> readers(_resources.size());
+    for (int p = 0; p < (int)_passes.size(); p++) {
+        const Pass& pass = _passes[p];
+        for (const ReadAccess& read : pass.reads) {
+            if (lastWriter[read.resource] != -1)
+                dataEdges[p].push_back(lastWriter[read.resource]);
+            readers[read.resource].push_back(p);
+        }
+        int previous = lastWriter[pass.write];
+        if (previous != -1) {
+            // cleared or overwritten contents are only ordered after, not needed
+            if (pass.load == LoadOp::LOAD)
+                dataEdges[p].push_back(previous);
+            else
+                orderEdges[p].push_back(previous);
+        }
+        for (int reader : readers[pass.write]) {
+            if (reader != p)
+                orderEdges[p].push_back(reader);
+        }
+        readers[pass.write].clear();
+        lastWriter[pass.write] = p;
+    }
+}
+
+std::vector<bool> RenderGraph::FindLivePasses(const std::vector<std::vector<int>>& dataEdges) const {
+    // outputs are the final contents of the window & imported canvases
+    std::vector<int> lastWriter(_resources.size(), -1);
+    for (int p = 0; p < (int)_passes.size(); p++)
+        lastWriter[_passes[p].write] = p;
+    std::vector<int> stack;
+    for (ResourceId r = 0; r < (ResourceId)_resources.size(); r++) {
+        if (_resources[r].isImported && lastWriter[r] != -1)
+            stack.push_back(lastWriter[r]);
+    }
+    for (int p = 0; p < (int)_passes.size(); p++) {
+        if (_passes[p].hasSideEffects)
+            stack.push_back(p);
+    }
+
+    std::vector<bool> isLive(_passes.size(), false);
+    while (!stack.empty()) {
+        int p = stack.back();
+        stack.pop_back();
+        if (isLive[p])
+            continue;
+        isLive[p] = true;
+        for (int dependency : dataEdges[p])
+            stack.push_back(dependency);
+    }
+    return isLive;
+}
+
+/// NOTE: Kahn's algorithm, ties go to a pass writing the canvas just written so it isn't rebound,
+/// then to declaration order so the result is deterministic
+bool RenderGraph::SortPasses(const std::vector<bool>& isLive, const std::vector<std::vector<int>>& dataEdges,
+    const std::vector<std::vector<int>>& orderEdges, std::vector<int>& order) const {
+    std::vector<int> remaining(_passes.size(), 0);
+    std::vector<std::vector<int>> dependents(_passes.size());
+    size_t liveCount = 0;
+    for (int p = 0; p < (int)_passes.size(); p++) {
+        if (!isLive[p])
+            continue;
+        liveCount++;
+        for (const auto* edges : { &dataEdges[p], &orderEdges[p] }) {
+            for (int dependency : *edges) {
+                if (!isLive[dependency])
+                    continue;
+                remaining[p]++;
+                dependents[dependency].push_back(p);
+            }
+        }
+    }
+
+    std::vector<int> ready;
+    for (int p = 0; p < (int)_passes.size(); p++) {
+        if (isLive[p] && remaining[p] == 0)
+            ready.push_back(p);
+    }
+    order.clear();
+    ResourceId boundTarget = -1;
+    while (!ready.empty()) {
+        auto next = std::min_element(ready.begin(), ready.end(), [this, boundTarget](int a, int b) {
+            bool aBound = _passes[a].write == boundTarget;
+            bool bBound = _passes[b].write == boundTarget;
+            return aBound != bBound ? aBound : a < b;
+        });
+        int p = *next;
+        ready.erase(next);
+        order.push_back(p);
+        boundTarget = _passes[p].write;
+        for (int dependent : dependents[p]) {
+            if (--remaining[dependent] == 0)
+                ready.push_back(dependent);
+        }
+    }
+    return order.size() == liveCount;
+}
+
+/// NOTE: greedy interval assignment, a graph canvas reuses the first physical canvas of the same description
+/// whose last use is before its first use, the first write clears so stale contents are never seen
+void RenderGraph::AssignCanvases(const std::vector<int>& order) {
+    std::vector<int> firstUse(_resources.size(), -1);
+    std::vector<int> lastUse(_resources.size(), -1);
+    for (int step = 0; step < (int)order.size(); step++) {
+        const Pass& pass = _passes[order[step]];
+        std::vector<ResourceId> used = { pass.write };
+        for (const ReadAccess& read : pass.reads)
+            used.push_back(read.resource);
+        for (ResourceId r : used) {
+            if (firstUse[r] == -1)
+                firstUse[r] = step;
+            lastUse[r] = step;
+        }
+    }
+
+    std::vector<ResourceId> transients;
+    for (ResourceId r = 0; r < (ResourceId)_resources.size(); r++) {
+        if (_resources[r].isImported)
+            continue;
+        _resources[r].canvas = nullptr;
+        if (firstUse[r] != -1)
+            transients.push_back(r);
+    }
+    std::sort(transients.begin(), transients.end(), [&firstUse](ResourceId a, ResourceId b) {
+        return firstUse[a] < firstUse[b];
+    });
+
+    for (PhysicalCanvas& physical : _physicalCanvases)
+        physical.lastUse = -1;
+    for (ResourceId r : transients) {
+        Resource& resource = _resources[r];
+        auto it = std::find_if(_physicalCanvases.begin(), _physicalCanvases.end(), [&](const PhysicalCanvas& physical) {
+            return physical.desc == resource.desc && physical.lastUse < firstUse[r];
+        });
+        if (it == _physicalCanvases.end()) {
+            PhysicalCanvas physical = PhysicalCanvas();
+            physical.desc = resource.desc;
+            if (resource.desc.windowScale > 0.0f) {
+                physical.canvas = std::make_shared<Canvas>();
+                physical.canvas->SetWindowScale(resource.desc.windowScale);
+            } else {
+                physical.canvas = std::make_shared<Canvas>(resource.desc.width, resource.desc.height);
+            }
+            physical.canvas->SetColorFormats(resource.desc.colorFormats);
+            physical.canvas->SetDepthFormat(resource.desc.depthFormat);
+            // storage is only needed within the frame, so the backend may share it further
+            physical.canvas->SetTransient(true);
+            _physicalCanvases.push_back(physical);
+            it = _physicalCanvases.end() - 1;
+        }
+        it->lastUse = lastUse[r];
+        resource.canvas = it->canvas;
+    }
+}
+
+void RenderGraph::BuildSteps(const std::vector<int>& order) {
+    _steps.clear();
+    std::vector<bool> hasContents(_resources.size(), false);
+    for (int p : order) {
+        const Pass& pass = _passes[p];
+        const Resource& resource = _resources[pass.write];
+        Step step = Step();
+        step.pass = p;
+        step.target = pass.write == WINDOW ? nullptr : resource.canvas;
+
+        // graph canvases have no contents before their first write, possibly another canvas' leftovers
+        bool isCleared = pass.load == LoadOp::CLEAR
+            || (pass.load == LoadOp::LOAD && !resource.isImported && !hasContents[pass.write]);
+        if (isCleared) {
+            TexPixelFormat depthFormat = pass.write == WINDOW ? TexPixelFormat::DEPTH_24f_STENCIL_8u
+                : resource.canvas->GetDepthFormat();
+            step.clearColor = true;
+            step.clearDepth = HasDepth(depthFormat);
+            step.clearStencil = HasStencil(depthFormat);
+        }
+        hasContents[pass.write] = true;
+        _steps.push_back(step);
+    }
+}
+
+bool RenderGraph::Compile() {
+    _steps.clear();
+    _culledPasses.clear();
+    _isCompiled = false;
+    for (const Pass& pass : _passes) {
+        if (pass.write < 0 || pass.write >= (ResourceId)_resources.size()) {
+            MT_CORE_WARN("RenderGraph::Compile: pass '{}' has no valid canvas to write", pass.name);
+            return false;
+        }
+        for (const ReadAccess& read : pass.reads) {
+            if (read.resource <= WINDOW || read.resource >= (ResourceId)_resources.size()) {
+                MT_CORE_WARN("RenderGraph::Compile: pass '{}' reads an invalid canvas, the window can't be sampled", pass.name);
+                return false;
+            }
+            if (read.resource == pass.write) {
+                MT_CORE_WARN("RenderGraph::Compile: pass '{}' reads the canvas it writes", pass.name);
+                return false;
+            }
+        }
+    }
+
+    std::vector<std::vector<int>> dataEdges;
+    std::vector<std::vector<int>> orderEdges;
+    BuildEdges(dataEdges, orderEdges);
+    std::vector<bool> isLive = FindLivePasses(dataEdges);
+    std::vector<int> order;
+    if (!SortPasses(isLive, dataEdges, orderEdges, order)) {
+        MT_CORE_WARN("RenderGraph::Compile: passes have a circular dependency");
+        return false;
+    }
+    for (int p = 0; p < (int)_passes.size(); p++) {
+        if (!isLive[p])
+            _culledPasses.push_back(_passes[p].name);
+    }
+    AssignCanvases(order);
+    BuildSteps(order);
+    _isCompiled = true;
+    MT_CORE_DEBUG("RenderGraph::Compile: {} passes, {} culled, {} physical canvases",
+        _steps.size(), _culledPasses.size(), _physicalCanvases.size());
+    return true;
+}
+
+void RenderGraph::Execute(Renderer& renderer) {
+    if (!_isCompiled && !Compile())
+        return;
+    std::shared_ptr<Canvas> previous = renderer.GetCanvas();
+    for (const Step& step : _steps) {
+        const Pass& pass = _passes[step.pass];
+        // binding the canvas flushes draws queued by the previous pass, a no-op if already bound
+        renderer.SetCanvas(step.target);
+        if (step.clearColor || step.clearDepth || step.clearStencil)
+            renderer.Clear(step.clearColor, step.clearStencil, step.clearDepth);
+        for (size_t unit = 0; unit < pass.reads.size(); unit++) {
+            const ReadAccess& read = pass.reads[unit];
+            std::shared_ptr<Canvas> canvas = _resources[read.resource].canvas;
+            if (canvas != nullptr)
+                renderer.BindCanvasTexture(canvas, read.attachment, (int)unit);
+        }
+        if (pass.execute != nullptr)
+            pass.execute(renderer);
+    }
+    renderer.SetCanvas(previous);
+}
+
+std::vector<std::string> RenderGraph::GetExecutionOrder() const {
+    std::vector<std::string> names;
+    for (const Step& step : _steps)
+        names.push_back(_passes[step.pass].name);
+    return names;
+}
+
+const std::vector<std::string>& RenderGraph::GetCulledPasses() const {
+    return _culledPasses;
+}
+
+size_t RenderGraph::GetPhysicalCanvasCount() const {
+    return _physicalCanvases.size();
+}
+
+std::shared_ptr<Canvas> RenderGraph::GetCanvas(ResourceId resource) const {
+    if (resource <= WINDOW || resource >= (ResourceId)_resources.size())
+        return nullptr;
+    return _resources[resource].canvas;
+}
+
+} // renderer
+
+} // marathon
@@ -0,0 +1,171 @@
+#include "renderer/render_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include <nlohmann/json.hpp>
+
+#include "core/logger.hpp"
+
+namespace marathon {
+
+namespace renderer {
+
+int CountTriangles(PrimitiveType primitive, int count) {
+    switch (primitive) {
+        case PrimitiveType::TRIANGLES:
+            return count / 3;
+        case PrimitiveType::FAN:
+        case PrimitiveType::STRIP:
+            return std::max(count - 2, 0);
+        default:
+            return 0;
+    }
+}
+
+namespace {
+
+struct StatField {
+    std::string name;
+    double (*get)(const RenderStats&);
+};
+
+// frameIndex is excluded as summarising it is meaningless, it is still exported per frame
+const std::vector<StatField> s_statFields = {
+    { "drawCalls",            [](const RenderStats& s) { return (double)s.drawCalls; } },
+    { "drawsCulled",          [](const RenderStats& s) { return (double)s.drawsCulled; } },
+    { "drawsOccluded",        [](const RenderStats& s) { return (double)s.drawsOccluded; } },
+    { "occlusionQueries",     [](const RenderStats& s) { return (double)s.occlusionQueries; } },
+    { "occlusionQueryHits",   [](const RenderStats& s) { return (double)s.occlusionQueryHits; } },
+    { "occlusionQueryMisses", [](const RenderStats& s) { return (double)s.occlusionQueryMisses; } },
+    { "trianglesRendered",    [](const RenderStats& s) { return (double)s.trianglesRendered; } },
+    { "verticesRendered",     [](const RenderStats& s) { return (double)s.verticesRendered; } },
+    { "stateChangesSaved",    [](const RenderStats& s) { return (double)s.stateChangesSaved; } },
+    { "stateCallsSkipped",    [](const RenderStats& s) { return (double)s.stateCallsSkipped; } },
+    { "programBinds",         [](const RenderStats& s) { return (double)s.programBinds; } },
+    { "vertexArrayBinds",     [](const RenderStats& s) { return (double)s.vertexArrayBinds; } },
+    { "textureBinds",         [](const RenderStats& s) { return (double)s.textureBinds; } },
+    { "uniformUploads",       [](const RenderStats& s) { return (double)s.uniformUploads; } },
+    { "bytesUploaded",        [](const RenderStats& s) { return (double)s.bytesUploaded; } },
+    { "handlersCreated",      [](const RenderStats& s) { return (double)s.handlersCreated; } }
+};
+
+} // namespace
+
+RenderStatsHistory::RenderStatsHistory(size_t capacity)
+    : _frames(std::max(capacity, (size_t)1)) {}
+
+void RenderStatsHistory::Push(const RenderStats& stats) {
+    if (_size < _frames.size()) {
+        _frames[(_head + _size) % _frames.size()] = stats;
+        _size++;
+        return;
+    }
+    // full, overwrite oldest
+    _frames[_head] = stats;
+    _head = (_head + 1) % _frames.size();
+}
+
+void RenderStatsHistory::Clear() {
+    _head = 0;
+    _size = 0;
+}
+
+size_t RenderStatsHistory::Size() const {
+    return _size;
+}
+
+size_t RenderStatsHistory::Capacity() const {
+    return _frames.size();
+}
+
+const RenderStats& RenderStatsHistory::Get(size_t index) const {
+    return _frames[(_head + index) % _frames.size()];
+}
+
+const std::vector<std::string>& RenderStatsHistory::GetFieldNames() {
+    static const std::vector<std::string> names = [] {
+        std::vector<std::string> names;
+        for (const StatField& field : s_statFields)
+            names.push_back(field.name);
+        return names;
+    }();
+    return names;
+}
+
+RenderStatsSummary RenderStatsHistory::Summarize(const std::string& name) const {
+    auto field = std::find_if(s_statFields.begin(), s_statFields.end(),
+        [&name](const StatField& f) { return f.name == name; });
+    if (field == s_statFields.end() || _size == 0)
+        return RenderStatsSummary();
+
+    std::vector<double> values(_size);
+    double sum = 0.0;
+    for (size_t i = 0; i < _size; i++) {
+        values[i] = field->get(Get(i));
+        sum += values[i];
+    }
+    std::sort(values.begin(), values.end());
+    // nearest rank
+    size_t p95Rank = (size_t)std::ceil(0.95 * _size);
+    return RenderStatsSummary {
+        .min = values.front(),
+        .avg = sum / _size,
+        .p95 = values[std::max(p95Rank, (size_t)1) - 1],
+        .max = values.back()
+    };
+}
+
+bool RenderStatsHistory::ExportCsv(const std::filesystem::path& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        MT_CORE_WARN("RenderStatsHistory::ExportCsv: failed to open {}", path.string());
+        return false;
+    }
+    file << "frameIndex";
+    for (const StatField& field : s_statFields)
+        file << "," << field.name;
+    file << "\n";
+    for (size_t i = 0; i < _size; i++) {
+        const RenderStats& stats = Get(i);
+        file << stats.frameIndex;
+        for (const StatField& field : s_statFields)
+            file << "," << (int64_t)field.get(stats);
+        file << "\n";
+    }
+    return file.good();
+}
+
+bool RenderStatsHistory::ExportJson(const std::filesystem::path& path) const {
+    nlohmann::json frames = nlohmann::json::array();
+    for (size_t i = 0; i < _size; i++) {
+        const RenderStats& stats = Get(i);
+        nlohmann::json frame = { { "frameIndex", stats.frameIndex } };
+        for (const StatField& field : s_statFields)
+            frame[field.name] = (int64_t)field.get(stats);
+        frames.push_back(frame);
+    }
+    nlohmann::json summary = nlohmann::json::object();
+    for (const StatField& field : s_statFields) {
+        RenderStatsSummary s = Summarize(field.name);
+        summary[field.name] = { { "min", s.min }, { "avg", s.avg }, { "p95", s.p95 }, { "max", s.max } };
+    }
+    nlohmann::json root = {
+        { "capacity", Capacity() },
+        { "frames", frames },
+        { "summary", summary }
+    };
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        MT_CORE_WARN("RenderStatsHistory::ExportJson: failed to open {}", path.string());
+        return false;
+    }
+    file << root.dump(4);
+    return file.good();
+}
+
+} // renderer
+
+} // marathon
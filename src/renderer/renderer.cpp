@@ -1,5 +1,10 @@
 #include "renderer/renderer.hpp"
+
+#include <cstdlib>
+
 #include "renderer/opengl/renderer.hpp"
+#include "renderer/headless/renderer.hpp"
+#include "core/logger.hpp"
 
 namespace marathon {
 
@@ -8,11 +13,37 @@ namespace renderer {
 Renderer::Renderer(const std::string& name)
     : marathon::Module(ModuleType::RENDERER, name) {}
 
+namespace {
+
+Renderer* s_instance = nullptr;
+bool s_hasBackend = false;
+RendererBackend s_backend = RendererBackend::OPENGL;
+
+} // namespace
+
 Renderer& Renderer::Instance() {
-    static Renderer* instance;
-    if (!instance)
-        instance = new marathon::renderer::opengl::Renderer();
-    return *instance;
+    if (!s_instance) {
+        if (!s_hasBackend) {
+            const char* env = std::getenv("MARATHON_RENDERER");
+            if (env != nullptr && std::string(env) == "headless")
+                s_backend = RendererBackend::HEADLESS;
+        }
+        if (s_backend == RendererBackend::HEADLESS)
+            s_instance = new marathon::renderer::headless::Renderer();
+        else
+            s_instance = new marathon::renderer::opengl::Renderer();
+    }
+    return *s_instance;
+}
+
+bool Renderer::SetBackend(RendererBackend backend) {
+    if (s_instance) {
+        MT_CORE_WARN("Renderer::SetBackend: renderer already created, backend can't change");
+        return false;
+    }
+    s_backend = backend;
+    s_hasBackend = true;
+    return true;
 }
 
 
@@ -63,14 +94,62 @@ void Renderer::PushScale(LA::vec3 scale) {
     PushTransform(LA::Scale(scale));
 }
 
+UniformId Renderer::GetUniformId(const std::string& key) {
+    auto it = _uniformIds.find(key);
+    if (it != _uniformIds.end())
+        return it->second;
+    UniformId id = _uniformNames.size();
+    _uniformIds[key] = id;
+    _uniformNames.push_back(key);
+    return id;
+}
+UniformId Renderer::FindUniformId(const std::string& key) const {
+    auto it = _uniformIds.find(key);
+    if (it == _uniformIds.end())
+        return -1;
+    return it->second;
+}
+const std::string& Renderer::GetUniformName(UniformId id) const {
+    static const std::string empty = "";
+    if (id < 0 || id >= _uniformNames.size())
+        return empty;
+    return _uniformNames[id];
+}
+
 RenderStats Renderer::GetRenderStats() {
     return _stats;
 }
 
+const RenderStatsHistory& Renderer::GetRenderStatsHistory() const {
+    return _statsHistory;
+}
+
 void Renderer::NextFrame() {
-    _stats.frameIndex++;
-    _stats.drawCalls = 0;
-    _stats.trianglesRendered = 0;
+    // backends fill in their counters in GetRenderStats
+    _statsHistory.Push(GetRenderStats());
+    _stats = RenderStats {
+        .frameIndex = _stats.frameIndex + 1
+    };
+    _hasFrameTime = false;
+}
+
+void Renderer::SetFrameTime(double time, double deltaTime) {
+    _hasFrameTime = true;
+    _frameTime = time;
+    _frameDeltaTime = deltaTime;
+}
+
+void Renderer::SubmitFrame(const FramePacket& packet) {
+    SetFrameTime(packet.time, packet.deltaTime);
+    if (packet.hasCamera) {
+        SetView(packet.view);
+        SetProjection(packet.projection);
+    }
+    if (packet.clear) {
+        SetClearColor(packet.clearColor);
+        Clear();
+    }
+    Submit(packet.lists);
 }
 
 } // renderer
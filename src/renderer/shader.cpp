@@ -1,5 +1,7 @@
 #include "renderer/shader.hpp"
 
+#include "core/logger.hpp"
+
 namespace marathon {
 
 namespace renderer {
@@ -46,6 +48,27 @@ void Shader::SetSources(const std::string& vSrc, const std::string& fSrc) {
     _dirty = ShaderDirty::DIRTY_COMPILE;
 }
 
+const std::vector<std::string>& Shader::GetFeatures() const {
+    return _features;
+}
+
+int Shader::GetFeatureIndex(const std::string& feature) const {
+    for (size_t i = 0; i < _features.size(); i++) {
+        if (_features[i] == feature)
+            return i;
+    }
+    return -1;
+}
+
+void Shader::SetFeatures(const std::vector<std::string>& features) {
+    _features = features;
+    if (_features.size() > MAX_FEATURES) {
+        MT_CORE_WARN("Shader::SetFeatures: only {} features supported, ignoring the rest", MAX_FEATURES);
+        _features.resize(MAX_FEATURES);
+    }
+    _dirty = ShaderDirty::DIRTY_COMPILE;
+}
+
 } // namespace renderer
 
 } // namespace marathon
\ No newline at end of file
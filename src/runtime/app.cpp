@@ -1,10 +1,13 @@
 #include "runtime/app.hpp"
 
+#include <algorithm>
+
 #include "marathon.hpp"
 #include "window/window.hpp"
 #include "events/events.hpp"
 #include "time/time.hpp"
 #include "core/logger.hpp"
+#include "renderer/renderer.hpp"
 
 namespace marathon {
 
@@ -39,6 +42,12 @@ void App::Run() {
     // user defined start
     Start();
 
+    // falls back to rendering on this thread if the context can't be moved
+    bool isPipelined = _mFrameLatency > 0 && _mPipeline.Start(_mFrameLatency, [](const renderer::FramePacket& packet) {
+        renderer::Renderer::Instance().SubmitFrame(packet);
+        window::Window::Instance().SwapFrame();
+    });
+
     // main game loop
     while (!_mQuit) {
         // fetch events from backend ready for polling
@@ -46,13 +55,35 @@ void App::Run() {
         
         // interactive tick
         double dt = time::Time::Instance().Tick();
+
+        // blocks if the render thread has fallen too far behind
+        if (isPipelined) {
+            _mFramePacket = &_mPipeline.BeginFrame();
+        } else {
+            _mPacket.Reset(std::max<size_t>(_mPacket.lists.size(), 1));
+            _mFramePacket = &_mPacket;
+        }
+        _mFramePacket->time = time::Time::Instance().GetTime();
+        _mFramePacket->deltaTime = dt;
+
         // user defined update
         Update(dt);
         
-        // swap frame shown
-        window::Window::Instance().SwapFrame();
+        if (isPipelined) {
+            _mPipeline.EndFrame();
+        } else {
+            // packet camera & clear apply from here, draws made directly in Update were issued before them
+            renderer::Renderer::Instance().SubmitFrame(_mPacket);
+            // swap frame shown
+            window::Window::Instance().SwapFrame();
+            _mPacket.frameIndex++;
+        }
+        _mFramePacket = nullptr;
     }
 
+    // finish rendering recorded frames & take back the context
+    _mPipeline.Stop();
+
     // internal shutdown safely
     Shutdown();
     if (_mFailed) {
@@ -64,5 +95,36 @@ void App::Quit() {
     _mQuit = true;
 }
 
+void App::SetFrameLatency(int latency) {
+    if (latency < 0 || latency > FramePipeline::MAX_LATENCY) {
+        MT_ENGINE_WARN("App::SetFrameLatency: latency {} out of range [0, {}]", latency, FramePipeline::MAX_LATENCY);
+        return;
+    }
+#ifdef __APPLE__
+    if (latency > 0) {
+        MT_ENGINE_WARN("App::SetFrameLatency: macOS can only present from the main thread, latency stays 0");
+        return;
+    }
+#endif
+    _mFrameLatency = latency;
+}
+
+int App::GetFrameLatency() const {
+    return _mFrameLatency;
+}
+
+void App::WaitFrameSubmitted(int frameIndex) {
+    if (_mPipeline.IsRunning())
+        _mPipeline.WaitSubmitted(frameIndex);
+}
+
+renderer::FramePacket& App::GetFramePacket() {
+    if (_mFramePacket == nullptr) {
+        MT_ENGINE_WARN("App::GetFramePacket: no frame is being updated");
+        return _mPacket;
+    }
+    return *_mFramePacket;
+}
+
 
 } // namespace marathon
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "runtime/frame_pipeline.hpp"
+
+#include <algorithm>
+
+#include "window/window.hpp"
+#include "core/logger.hpp"
+
+namespace marathon {
+
+FramePipeline::~FramePipeline() {
+    Stop();
+}
+
+bool FramePipeline::Start(int latency, SubmitFn submit) {
+    if (IsRunning()) {
+        MT_CORE_WARN("FramePipeline::Start: already running");
+        return false;
+    }
+    if (latency < 1 || latency > MAX_LATENCY) {
+        MT_CORE_WARN("FramePipeline::Start: latency {} out of range [1, {}]", latency, MAX_LATENCY);
+        return false;
+    }
+    if (!window::Window::Instance().ReleaseContext())
+        return false;
+
+    _latency = latency;
+    _submit = submit;
+    _packets.resize(latency + 1);
+    _recorded = 0;
+    _submitted = 0;
+    _isRecording = false;
+    _isStopping = false;
+    _contextState = -1;
+    _thread = std::thread(&FramePipeline::RenderLoop, this);
+
+    // wait for the render thread to own the context before anything else is drawn
+    std::unique_lock<std::mutex> lock(_mutex);
+    _condition.wait(lock, [this]() { return _contextState != -1; });
+    if (_contextState == 0) {
+        lock.unlock();
+        _thread.join();
+        window::Window::Instance().AcquireContext();
+        MT_CORE_WARN("FramePipeline::Start: render thread couldn't acquire the context");
+        return false;
+    }
+    MT_CORE_INFO("FramePipeline::Start: rendering on a separate thread, {} frame latency", latency);
+    return true;
+}
+
+void FramePipeline::Stop() {
+    if (!_thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isStopping = true;
+    }
+    _condition.notify_all();
+    _thread.join();
+    window::Window::Instance().AcquireContext();
+}
+
+bool FramePipeline::IsRunning() const {
+    return _thread.joinable();
+}
+
+int FramePipeline::GetLatency() const {
+    return _latency;
+}
+
+renderer::FramePacket& FramePipeline::BeginFrame() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    // the slot for this frame was last used latency + 1 frames ago
+    _condition.wait(lock, [this]() { return _recorded - _submitted <= _latency; });
+    _isRecording = true;
+    int frameIndex = _recorded;
+    lock.unlock();
+    renderer::FramePacket& packet = _packets[frameIndex % _packets.size()];
+    packet.Reset(std::max<size_t>(packet.lists.size(), 1));
+    packet.frameIndex = frameIndex;
+    return packet;
+}
+
+void FramePipeline::EndFrame() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_isRecording) {
+            MT_CORE_WARN("FramePipeline::EndFrame: no frame begun");
+            return;
+        }
+        _isRecording = false;
+        _recorded++;
+    }
+    _condition.notify_all();
+}
+
+int FramePipeline::GetSubmittedCount() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _submitted;
+}
+
+bool FramePipeline::WaitSubmitted(int frameIndex) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    // the frame being recorded isn't handed over until EndFrame so waiting on it would never return
+    if (frameIndex < 0 || frameIndex >= _recorded) {
+        MT_CORE_WARN("FramePipeline::WaitSubmitted: frame {} hasn't been handed to the render thread", frameIndex);
+        return false;
+    }
+    _condition.wait(lock, [this, frameIndex]() { return _submitted > frameIndex; });
+    return true;
+}
+
+void FramePipeline::RenderLoop() {
+    bool isAcquired = window::Window::Instance().AcquireContext();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _contextState = isAcquired ? 1 : 0;
+    }
+    _condition.notify_all();
+    if (!isAcquired)
+        return;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _condition.wait(lock, [this]() { return _submitted < _recorded || _isStopping; });
+        // recorded frames are still submitted when stopping
+        if (_submitted == _recorded)
+            break;
+        const renderer::FramePacket& packet = _packets[_submitted % _packets.size()];
+        lock.unlock();
+        _submit(packet);
+        lock.lock();
+        _submitted++;
+        _condition.notify_all();
+    }
+    lock.unlock();
+    window::Window::Instance().ReleaseContext();
+}
+
+} // marathon
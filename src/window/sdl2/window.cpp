@@ -1,5 +1,6 @@
 #include "window/sdl2/window.hpp"
 #include "renderer/renderer.hpp"
+#include "core/logger.hpp"
 
 namespace marathon {
 
@@ -95,10 +96,27 @@ SDL_Window* Window::GetWindow() {
 
 // call at the end of the frame to swap displayed buffer
 void Window::SwapFrame() {
+    renderer::Renderer::Instance().Flush();
     renderer::Renderer::Instance().NextFrame();
     SDL_GL_SwapWindow(_window);
 }
 
+/// NOTE: some platforms e.g. macOS only allow swapping on the main thread
+bool Window::AcquireContext() {
+    if (SDL_GL_MakeCurrent(_window, (SDL_GLContext)GetGLContext()) != 0) {
+        MT_CORE_ERROR("Window::AcquireContext: failed to make context current, {}", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+bool Window::ReleaseContext() {
+    if (SDL_GL_MakeCurrent(_window, nullptr) != 0) {
+        MT_CORE_ERROR("Window::ReleaseContext: failed to release context, {}", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
 bool Window::IsOpen() {
     return _isOpen;
 }
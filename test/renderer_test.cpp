@@ -0,0 +1,385 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/slot_map.hpp"
+#include "renderer/draw_queue.hpp"
+#include "renderer/mesh.hpp"
+#include "renderer/frustum.hpp"
+#include "renderer/render_stats.hpp"
+#include "renderer/occlusion_culler.hpp"
+#include "renderer/render_graph.hpp"
+#include "renderer/command_list.hpp"
+#include "renderer/headless/renderer.hpp"
+
+using namespace marathon;
+using namespace marathon::renderer;
+
+// behaviour checks of the backend independent renderer pieces & the headless backend
+// returns the number of failed checks so ctest reports any failure
+
+static int s_failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+            s_failures++; \
+        } \
+    } while (0)
+
+static Bounds MakeBounds(LA::vec3 min, LA::vec3 max) {
+    Bounds bounds = Bounds();
+    bounds.min = min;
+    bounds.max = max;
+    bounds.center = {(min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f};
+    bounds.isValid = true;
+    return bounds;
+}
+
+static bool IsEqual(const LA::mat4& a, const LA::mat4& b) {
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++)
+            if (a[c][r] != b[c][r])
+                return false;
+    return true;
+}
+
+static std::shared_ptr<Shader> MakeShader(const std::string& name) {
+    std::shared_ptr<Shader> shader = std::make_shared<Shader>();
+    shader->SetName(name);
+    shader->SetVertexSource("#version 330 core\nuniform mat4 u_model;\nvoid main() {}\n");
+    shader->SetFragmentSource("#version 330 core\nuniform vec4 u_colour;\nvoid main() {}\n");
+    return shader;
+}
+
+void test_slot_map() {
+    SlotMap<int> map;
+    Handle a = map.Insert(1);
+    Handle b = map.Insert(2);
+    CHECK(a.IsValid() && b.IsValid());
+    CHECK(map.Size() == 2);
+    CHECK(*map.Get(b) == 2);
+
+    CHECK(map.Remove(a));
+    CHECK(!map.Remove(a));
+    CHECK(map.Get(a) == nullptr);
+    // reused slot gets a new generation so the old handle stays stale
+    Handle c = map.Insert(3);
+    CHECK(c.index == a.index);
+    CHECK(c.generation != a.generation);
+    CHECK(!map.Contains(a));
+    CHECK(*map.Get(c) == 3);
+    CHECK(!map.Contains(Handle()));
+}
+
+void test_draw_queue_sort() {
+    // program outranks material, material outranks geometry, geometry outranks depth
+    CHECK(DrawQueue::MakeSortKey(1, 0, 0, 0.0f) > DrawQueue::MakeSortKey(0, 9, 9, 100.0f));
+    CHECK(DrawQueue::MakeSortKey(0, 1, 0, 0.0f) > DrawQueue::MakeSortKey(0, 0, 9, 100.0f));
+    CHECK(DrawQueue::MakeSortKey(0, 0, 1, 0.0f) > DrawQueue::MakeSortKey(0, 0, 0, 100.0f));
+    CHECK(DrawQueue::MakeSortKey(0, 0, 0, 2.0f) > DrawQueue::MakeSortKey(0, 0, 0, 1.0f));
+
+    DrawQueue queue;
+    uint32_t programs[] = {2, 1, 2, 1};
+    for (uint32_t i = 0; i < 4; i++) {
+        DrawCommand cmd = DrawCommand();
+        cmd.shader = Handle{programs[i], 1};
+        cmd.mesh = Handle{i + 1, 1};
+        cmd.sortKey = DrawQueue::MakeSortKey(programs[i], 0, 0, 1.0f);
+        queue.Push(cmd);
+    }
+    int unsortedChanges = queue.CountStateChanges(false);
+    queue.Sort();
+    CHECK(queue.Size() == 4);
+    // sort is stable so equal keys keep submission order
+    CHECK(queue.GetSorted(0).mesh.index == 2);
+    CHECK(queue.GetSorted(1).mesh.index == 4);
+    CHECK(queue.GetSorted(2).mesh.index == 1);
+    CHECK(queue.GetSorted(3).mesh.index == 3);
+    CHECK(queue.CountStateChanges(true) < unsortedChanges);
+
+    queue.Clear();
+    CHECK(queue.Empty());
+}
+
+void test_dirty_range_set() {
+    DirtyRangeSet ranges;
+    CHECK(ranges.Empty());
+    ranges.Add(0, 4);
+    ranges.Add(4, 4);
+    // touching ranges merge
+    CHECK(ranges.GetRanges().size() == 1);
+    CHECK(ranges.GetRanges()[0].offset == 0 && ranges.GetRanges()[0].size == 8);
+
+    ranges.Add(20, 2);
+    ranges.Add(6, 10);
+    CHECK(ranges.GetRanges().size() == 2);
+    CHECK(ranges.GetRanges()[0].size == 16);
+    CHECK(ranges.GetSize() == 18);
+
+    // over capacity the smallest gaps are closed, everything stays covered
+    ranges.Clear();
+    for (size_t i = 0; i < 12; i++)
+        ranges.Add(i * 10, 2);
+    CHECK(ranges.GetRanges().size() <= 8);
+    CHECK(ranges.GetRanges().front().offset == 0);
+    CHECK(ranges.GetRanges().back().offset + ranges.GetRanges().back().size == 112);
+}
+
+void test_render_stats_history() {
+    RenderStatsHistory history(3);
+    for (int i = 0; i < 5; i++) {
+        RenderStats stats = RenderStats();
+        stats.frameIndex = i;
+        stats.drawCalls = i * 10;
+        history.Push(stats);
+    }
+    // oldest frames are overwritten once full
+    CHECK(history.Size() == 3);
+    CHECK(history.Capacity() == 3);
+    CHECK(history.Get(0).frameIndex == 2);
+    CHECK(history.Get(2).frameIndex == 4);
+
+    RenderStatsSummary summary = history.Summarize("drawCalls");
+    CHECK(summary.min == 20);
+    CHECK(summary.max == 40);
+    CHECK(summary.avg == 30);
+
+    history.Clear();
+    CHECK(history.Size() == 0);
+}
+
+void test_frustum() {
+    // identity view projection is the [-1, 1] clip cube
+    Frustum frustum = Frustum(LA::mat4());
+    const Plane& left = frustum.GetPlanes()[0];
+    CHECK(left.a == 1.0f && left.b == 0.0f && left.c == 0.0f && left.d == 1.0f);
+
+    CHECK(frustum.IsVisible(MakeBounds({-0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, 0.5f}), LA::mat4()));
+    CHECK(!frustum.IsVisible(MakeBounds({4.0f, -0.5f, -0.5f}, {5.0f, 0.5f, 0.5f}), LA::mat4()));
+    // straddling a plane is visible
+    CHECK(frustum.IsVisible(MakeBounds({0.5f, -0.5f, -0.5f}, {1.5f, 0.5f, 0.5f}), LA::mat4()));
+    // invalid bounds are never culled
+    CHECK(frustum.IsVisible(Bounds(), LA::mat4()));
+    // default frustum reports everything visible
+    CHECK(Frustum().IsVisible(MakeBounds({4.0f, 4.0f, 4.0f}, {5.0f, 5.0f, 5.0f}), LA::mat4()));
+}
+
+void test_uniform_block_hash() {
+    UniformBlockLayout a;
+    a.name = "MaterialProperties";
+    a.size = 32;
+    a.members = {{.name = "u_colour", .offset = 0, .rows = 4}, {.name = "u_gloss", .offset = 16}};
+    UniformBlockLayout b = a;
+    // layouts packing identically share material buffers
+    CHECK(a.Hash() == b.Hash());
+    b.members[1].offset = 20;
+    CHECK(a.Hash() != b.Hash());
+}
+
+void test_mesh_bounds() {
+    // position then colour, 7 floats per vertex
+    RawMesh mesh;
+    float vertices[] = {
+        -1.0f, -1.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+        1.0f, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f
+    };
+    mesh.SetVertexParams(2, {
+        {VertexAttribute::POSITION, 3, VertexAttributeFormat::FLOAT},
+        {VertexAttribute::COLOUR, 4, VertexAttributeFormat::FLOAT}
+    });
+    mesh.SetVertexData(vertices, sizeof(vertices), 0, 0);
+    mesh.UpdateBounds();
+    CHECK(mesh.GetBounds().max.x == 1.0f);
+
+    // colour edits leave bounds alone
+    float colour[] = {0.0f, 0.0f, 0.0f, 0.0f};
+    mesh.SetVertexData(colour, sizeof(colour), 0, sizeof(float) * 10);
+    float moved[] = {4.0f, 1.0f, 0.0f};
+    mesh.SetVertexData(moved, sizeof(moved), 0, sizeof(float) * 7);
+    // position edits are applied on the next update only
+    CHECK(mesh.GetBounds().max.x == 1.0f);
+    mesh.UpdateBounds();
+    CHECK(mesh.GetBounds().max.x == 4.0f);
+}
+
+void test_occlusion_culler() {
+    RawMesh quad;
+    float vertices[] = {-0.5f, -0.5f, 0.0f, 0.5f, -0.5f, 0.0f, 0.5f, 0.5f, 0.0f, -0.5f, 0.5f, 0.0f};
+    uint16_t indices[] = {0, 1, 2, 0, 2, 3};
+    quad.SetVertexParams(4, {{VertexAttribute::POSITION, 3, VertexAttributeFormat::FLOAT}});
+    quad.SetVertexData(vertices, sizeof(vertices), 0, 0);
+    quad.SetIndexParams(6, IndexFormat::UINT16, PrimitiveType::TRIANGLES);
+    quad.SetIndexData(indices, sizeof(indices), 0, 0);
+    // bounds are only recalculated on update
+    CHECK(!quad.GetBounds().isValid);
+    quad.UpdateBounds();
+    CHECK(quad.GetBounds().isValid);
+    CHECK(quad.GetBounds().max.x == 0.5f);
+
+    // single threaded & banded across the worker pool must agree
+    for (int threadCount : {1, 4}) {
+        OcclusionCuller culler;
+        culler.SetThreadCount(threadCount);
+        CHECK(culler.IsVisible(MakeBounds({-0.2f, -0.2f, 0.2f}, {0.2f, 0.2f, 0.4f}), LA::mat4()));
+        // enough triangles to take the threaded path
+        int occluderCount = threadCount == 1 ? 1 : 200;
+        for (int i = 0; i < occluderCount; i++)
+            CHECK(culler.AddOccluder(quad, LA::mat4()));
+        for (int i = 0; i < 3; i++)
+            culler.Rasterise(LA::mat4());
+
+        // behind, in front of & partially outside the occluder
+        CHECK(!culler.IsVisible(MakeBounds({-0.2f, -0.2f, 0.2f}, {0.2f, 0.2f, 0.4f}), LA::mat4()));
+        CHECK(culler.IsVisible(MakeBounds({-0.2f, -0.2f, -0.6f}, {0.2f, 0.2f, -0.4f}), LA::mat4()));
+        CHECK(culler.IsVisible(MakeBounds({0.3f, 0.3f, 0.2f}, {0.7f, 0.7f, 0.4f}), LA::mat4()));
+        CHECK(culler.IsVisible(Bounds(), LA::mat4()));
+
+        culler.ClearOccluders();
+        CHECK(!culler.HasOccluders());
+    }
+}
+
+void test_render_graph() {
+    RenderGraph graph;
+    RenderGraphCanvasDesc hdr;
+    hdr.colorFormats = {TexPixelFormat::RGBA_16f};
+    RenderGraphCanvasDesc post;
+    post.depthFormat = TexPixelFormat::NONE;
+    RenderGraph::ResourceId scene = graph.CreateCanvas("scene", hdr);
+    RenderGraph::ResourceId bloomA = graph.CreateCanvas("bloomA", post);
+    RenderGraph::ResourceId bloomB = graph.CreateCanvas("bloomB", post);
+    RenderGraph::ResourceId debug = graph.CreateCanvas("debug", post);
+    RenderGraph::ResourceId tone = graph.CreateCanvas("tone", post);
+    graph.AddPass("opaque", nullptr).Write(scene, LoadOp::CLEAR);
+    graph.AddPass("debug", nullptr).Read(scene).Write(debug);
+    graph.AddPass("transparent", nullptr).Write(scene);
+    graph.AddPass("bright", nullptr).Read(scene).Write(bloomA, LoadOp::DONT_CARE);
+    graph.AddPass("blur", nullptr).Read(bloomA).Write(bloomB, LoadOp::DONT_CARE);
+    graph.AddPass("tonemap", nullptr).Read(scene).Read(bloomB).Write(tone);
+    graph.AddPass("final", nullptr).Read(tone).Write(RenderGraph::WINDOW);
+    CHECK(graph.Compile());
+
+    // passes not contributing to the window are culled
+    std::vector<std::string> order = {"opaque", "transparent", "bright", "blur", "tonemap", "final"};
+    CHECK(graph.GetExecutionOrder() == order);
+    CHECK(graph.GetCulledPasses() == std::vector<std::string>({"debug"}));
+    // bloomA is dead once blurred so tone can reuse its storage
+    CHECK(graph.GetPhysicalCanvasCount() == 3);
+    CHECK(graph.GetCanvas(bloomA) == graph.GetCanvas(tone));
+    CHECK(graph.GetCanvas(scene) != graph.GetCanvas(tone));
+}
+
+void test_command_list() {
+    std::shared_ptr<Material> material = std::make_shared<Material>();
+    material->SetUniform("u_tint", 1.0f);
+    std::shared_ptr<Mesh> mesh = std::make_shared<BoxMesh>();
+    mesh->SetMaterial(material);
+
+    CommandList list;
+    list.PushTranslate(1.0f, 2.0f, 3.0f);
+    LA::mat4 model = list.GetModel();
+    list.Draw(mesh, 7);
+    list.SetUniform("u_tint", 2.0f);
+    list.Draw(mesh);
+    list.Draw(mesh);
+    const std::vector<CommandList::Entry>& entries = list.GetEntries();
+    CHECK(entries.size() == 3);
+    CHECK(entries[0].material == material);
+    CHECK(entries[0].occlusionId == 7);
+    CHECK(IsEqual(entries[0].model, model));
+    // one override material shared by draws with equal overrides
+    CHECK(entries[1].material != material);
+    CHECK(entries[1].material == entries[2].material);
+    CHECK(std::get<float>(entries[1].material->GetUniform("u_tint")) == 2.0f);
+
+    // override materials are reused between recordings
+    std::shared_ptr<Material> overridden = entries[1].material;
+    list.Reset();
+    list.SetUniform("u_tint", 2.0f);
+    list.Draw(mesh);
+    CHECK(list.GetEntries().size() == 1);
+    CHECK(list.GetEntries()[0].material == overridden);
+
+    LA::mat4 transforms[3];
+    list.DrawInstanced(mesh, transforms);
+    CHECK(list.GetEntries()[1].instanceCount == 3);
+    CHECK(list.GetEntries()[1].instanceSize == sizeof(transforms));
+}
+
+void test_headless_sorted_flush() {
+    headless::Renderer renderer;
+    renderer.Boot();
+
+    std::shared_ptr<Material> materialA = std::make_shared<Material>();
+    materialA->SetShader(MakeShader("shader_a"));
+    std::shared_ptr<Material> materialB = std::make_shared<Material>();
+    materialB->SetShader(MakeShader("shader_b"));
+    std::shared_ptr<Mesh> meshA = std::make_shared<BoxMesh>();
+    meshA->SetName("mesh_a");
+    meshA->SetMaterial(materialA);
+    std::shared_ptr<Mesh> meshB = std::make_shared<BoxMesh>();
+    meshB->SetName("mesh_b");
+    meshB->SetMaterial(materialB);
+
+    // interleaved submission is grouped by shader then mesh on flush
+    renderer.Draw(meshA);
+    renderer.Draw(meshB);
+    renderer.Draw(meshA);
+    renderer.Draw(meshB);
+    headless::CommandLog& log = renderer.GetCommandLog();
+    log.Clear();
+    renderer.Flush();
+
+    std::vector<std::string> sequence;
+    for (const headless::RecordedCall& call : log.GetCalls()) {
+        if (call.type == headless::CallType::BIND_SHADER)
+            sequence.push_back("shader");
+        else if (call.type == headless::CallType::BIND_MESH)
+            sequence.push_back("mesh");
+        else if (call.type == headless::CallType::DRAW)
+            sequence.push_back(call.label);
+    }
+    std::vector<std::string> expected = {
+        "shader", "mesh", "mesh_a", "mesh_a",
+        "shader", "mesh", "mesh_b", "mesh_b"
+    };
+    CHECK(sequence == expected);
+    CHECK(log.GetCount(headless::CallType::DRAW) == 4);
+    CHECK(renderer.GetRenderStats().drawCalls == 4);
+    CHECK(renderer.GetRenderStats().programBinds == 2);
+
+    // flushing again with nothing queued records nothing
+    log.Clear();
+    renderer.Flush();
+    CHECK(log.GetTotalCount() == 0);
+
+    // precompiling by material & mesh leaves nothing compiling
+    std::shared_ptr<Material> materialC = std::make_shared<Material>();
+    materialC->SetShader(MakeShader("shader_c"));
+    CHECK(renderer.PrecompileMaterials({{materialC, meshA}, {nullptr, meshA}}) == 0);
+    CHECK(renderer.GetMaterialStatus(materialC, meshA) == ShaderStatus::READY);
+    CHECK(renderer.GetMaterialStatus(materialC, nullptr) == ShaderStatus::INVALID);
+}
+
+int main() {
+    test_slot_map();
+    test_draw_queue_sort();
+    test_dirty_range_set();
+    test_render_stats_history();
+    test_frustum();
+    test_uniform_block_hash();
+    test_mesh_bounds();
+    test_occlusion_culler();
+    test_render_graph();
+    test_command_list();
+    test_headless_sorted_flush();
+
+    if (s_failures > 0)
+        std::cout << s_failures << " checks failed" << std::endl;
+    else
+        std::cout << "all checks passed" << std::endl;
+    return s_failures > 0 ? 1 : 0;
+}